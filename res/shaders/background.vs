@@ -3,8 +3,7 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
+#include "frame_data.glsl"
 
 out vec3 WorldPos;
 
@@ -12,8 +11,8 @@ void main()
 {
     WorldPos = aPos;
 
-	mat4 rotView = mat4(mat3(view));
-	vec4 clipPos = projection * rotView * vec4(WorldPos, 1.0);
+	mat4 rotView = mat4(mat3(frame.view));
+	vec4 clipPos = frame.projection * rotView * vec4(WorldPos, 1.0);
 
 	gl_Position = clipPos.xyww; // this can ensure the depth value is 1.0f so as the background color
 }
\ No newline at end of file
@@ -3,12 +3,11 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
-uniform mat4 projection;
-uniform mat4 model;
-uniform mat4 view;
+#include "frame_data.glsl"
+#include "draw_data.glsl"
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+    gl_Position = frame.projection * frame.view * draw.model * vec4(aPos, 1.0f);
     gl_PointSize = 10.0f;
 }
\ No newline at end of file
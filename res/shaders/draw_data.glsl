@@ -0,0 +1,8 @@
+// Per-draw data, one slice of the DrawUniformRing bound with glBindBufferRange before every draw
+// (DrawData in draw_uniforms.h, keep both layouts in sync).
+layout (std140) uniform DrawData
+{
+    mat4 model;
+    mat4 normalMatrix; // upper 3x3 is the normal matrix
+    vec4 material;     // x: metallic, y: roughness
+} draw;
\ No newline at end of file
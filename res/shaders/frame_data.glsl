@@ -0,0 +1,12 @@
+// Per-frame data shared by every program, uploaded once per frame into one std140 uniform buffer
+// (FrameData / FrameUniformBuffer in frame_uniforms.h, keep both layouts in sync).
+#define MAX_FRAME_LIGHTS 8
+
+layout (std140) uniform FrameData
+{
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;                          // xyz: camera(eye) position
+    vec4 lightPositions[MAX_FRAME_LIGHTS]; // xyz: world position
+    vec4 lightColors[MAX_FRAME_LIGHTS];    // rgb: radiance
+} frame;
\ No newline at end of file
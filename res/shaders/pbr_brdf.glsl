@@ -0,0 +1,81 @@
+// Cook-Torrance BRDF shared by the PBR fragment shaders, pulled in with #include "pbr_brdf.glsl".
+
+const float PI = 3.14159265359;
+
+// Calculating how the microfacets are oriented relative to the normal N and H
+float DistributionGGX(vec3 N, vec3 H, float roughness)
+{
+    float a = roughness*roughness;
+    float a2 = a * a;
+    float NdotH = max(dot(N, H), 0.0);
+    float NdotH2 = NdotH * NdotH;
+
+    float nom   = a2;
+    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
+    denom = PI * denom * denom;
+
+    return nom / denom;
+}
+
+float GeometrySchlickGGX(float NdotV, float roughness)
+{
+    float r = (roughness + 1.0);
+    float k = ( r* r) / 8.0;
+
+    float nom   = NdotV;
+    float denom = NdotV * (1.0 - k) + k;
+
+    return nom / denom;
+}
+
+// Calculate the possibility that occlussion each other in microfacets
+// We calculate them both with V and L
+float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness)
+{
+    float NdotV = max(dot(N, V), 0.0);
+    float NdotL = max(dot(N, L), 0.0);
+    float ggx2 = GeometrySchlickGGX(NdotV, roughness);
+    float ggx1 = GeometrySchlickGGX(NdotL, roughness);
+
+    return ggx1 * ggx2;
+}
+
+// cosTheta: cosine between H and V
+// F0: base reflectance when angle degree is 0, non-metal is usually vec3(0.04f), metal F0 represents its base color.
+//
+// Notice: we use vec3 as return type because material itself reflects different kinds of light color differently.
+vec3 fresnelSchlick(float cosTheta, vec3 F0)
+{
+    return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
+
+// Outgoing radiance towards V from a single point light, the Cook-Torrance specular plus Lambert diffuse
+vec3 PointLightRadiance(vec3 N, vec3 V, vec3 F0, vec3 albedo, float metallic, float roughness,
+    vec3 worldPos, vec3 lightPosition, vec3 lightColor)
+{
+    // calculate per-light radiance
+    vec3 L = normalize(lightPosition - worldPos);
+    vec3 H = normalize(V + L);
+    float distance = length(lightPosition - worldPos);
+    float attenuation = 1.0 / (distance * distance);
+    vec3 radiance = lightColor * attenuation;
+
+    // Cook-Torrance BRDF
+    float NDF = DistributionGGX(N, H, roughness);   
+    float G   = GeometrySmith(N, V, L, roughness);    
+    vec3 F    = fresnelSchlick(max(dot(H, V), 0.0), F0);        
+    
+    vec3 numerator    = NDF * G * F;
+    float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001; // + 0.0001 to prevent divide by zero
+    vec3 specular = numerator / denominator;
+    
+     // kS is equal to Fresnel
+    vec3 kS = F;
+    vec3 kD = vec3(1.0) - kS; // energy conservation
+    kD *= 1.0 - metallic;	// scaling by multiplying kd                 
+        
+    // scale light by NdotL
+    float NdotL = max(dot(N, L), 0.0);        
+
+    return (kD * albedo / PI + specular) * radiance * NdotL; // already multiplied the BRDF by the Fresnel (kS)
+}
\ No newline at end of file
@@ -1,22 +1,58 @@
 #version 330 core
+// PACKED_VERTEX 1: the mesh uploads PackedVertex (mesh.h), aPos is unorm16 over the mesh AABB and
+// is decoded with positionOffset + aPos * positionScale, the normal arrives as 10:10:10 snorm.
+// NORMAL_MAP_SOURCE NORMAL_SOURCE_VERTEX_TANGENT: tangent frame passed on from the vertex tangent
+// (location 3, w: bitangent sign when there is no bitangent) and bitangent (location 4, Vertex only).
+#define NORMAL_SOURCE_VERTEX_TANGENT 2
+
+#ifndef PACKED_VERTEX
+#define PACKED_VERTEX 0
+#endif
+#ifndef NORMAL_MAP_SOURCE
+#define NORMAL_MAP_SOURCE 0
+#endif
+
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+#if NORMAL_MAP_SOURCE == NORMAL_SOURCE_VERTEX_TANGENT
+layout (location = 3) in vec4 aTangent;   // w defaults to 1 for 3-component tangents
+layout (location = 4) in vec3 aBitangent; // (0, 0, 0) when the attribute is disabled
+#endif
 
 out vec2 TexCoords;
 out vec3 WorldPos;
 out vec3 Normal;
+#if NORMAL_MAP_SOURCE == NORMAL_SOURCE_VERTEX_TANGENT
+out vec3 Tangent;
+out vec3 Bitangent;
+#endif
+
+#include "frame_data.glsl"
+#include "draw_data.glsl"
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
-uniform mat3 normalMatrix;
+#if PACKED_VERTEX
+uniform vec3 positionScale;  // mesh AABB extent (model AABB in a MeshArena)
+uniform vec3 positionOffset; // mesh AABB min (model AABB in a MeshArena)
+#endif
 
 void main()
 {
+#if PACKED_VERTEX
+    vec3 position = positionOffset + aPos * positionScale;
+#else
+    vec3 position = aPos;
+#endif
     TexCoords = aTexCoords;
-    WorldPos = vec3(model * vec4(aPos, 1.0));
-    Normal = normalMatrix * aNormal;   
+    WorldPos = vec3(draw.model * vec4(position, 1.0));
+    Normal = mat3(draw.normalMatrix) * aNormal;   
+#if NORMAL_MAP_SOURCE == NORMAL_SOURCE_VERTEX_TANGENT
+    // MikkTSpace: only the handedness of the bitangent is taken from the vertex, the vector itself
+    // is cross(normal, tangent)
+    float bitangentSign = dot(aBitangent, aBitangent) > 0.0 ? sign(dot(cross(aNormal, aTangent.xyz), aBitangent)) : aTangent.w;
+    Tangent = mat3(draw.model) * aTangent.xyz;
+    Bitangent = cross(Normal, Tangent) * (bitangentSign < 0.0 ? -1.0 : 1.0);
+#endif
 
-    gl_Position =  projection * view * vec4(WorldPos, 1.0);
+    gl_Position =  frame.projection * frame.view * vec4(WorldPos, 1.0);
 }
\ No newline at end of file
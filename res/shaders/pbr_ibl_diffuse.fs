@@ -1,122 +1,151 @@
 #version 330 core
+// PBR with diffuse IBL. One source, several variants selected by defines that Shader injects
+// after the #version line (see PbrPermutation in shader_permutations.h):
+//   NR_LIGHTS          number of point lights, at most MAX_FRAME_LIGHTS (frame_data.glsl)
+//   TEXTURED           1: material read from the albedo/normal/metallic/roughness/ao maps
+//                      0: albedo/ao uniforms, metallic/roughness from the per-draw DrawData block
+//   NORMAL_MAP_SOURCE  NORMAL_SOURCE_VERTEX: interpolated vertex normal
+//                      NORMAL_SOURCE_MAP_DERIVATIVES: normal map, TBN rebuilt from screen-space derivatives
+//                      NORMAL_SOURCE_VERTEX_TANGENT: normal map, TBN interpolated from the vertex tangents
+//   IBL_DIFFUSE        1: ambient from irradianceMap, 0: constant ambient term
+//   METALLIC_ROUGHNESS_PACKED  1: metallic from B and roughness from G of their maps (glTF layout,
+//                      both samplers see the same texture), 0: both from R
+#define NORMAL_SOURCE_VERTEX 0
+#define NORMAL_SOURCE_MAP_DERIVATIVES 1
+#define NORMAL_SOURCE_VERTEX_TANGENT 2
+
+#ifndef NR_LIGHTS
+#define NR_LIGHTS 4
+#endif
+#ifndef TEXTURED
+#define TEXTURED 0
+#endif
+#ifndef NORMAL_MAP_SOURCE
+#define NORMAL_MAP_SOURCE NORMAL_SOURCE_VERTEX
+#endif
+#ifndef IBL_DIFFUSE
+#define IBL_DIFFUSE 1
+#endif
+#ifndef METALLIC_ROUGHNESS_PACKED
+#define METALLIC_ROUGHNESS_PACKED 0
+#endif
+
 out vec4 FragColor;
 in vec2 TexCoords;
 in vec3 WorldPos; // Representing p in rendering equation
 in vec3 Normal;
+#if NORMAL_MAP_SOURCE == NORMAL_SOURCE_VERTEX_TANGENT
+in vec3 Tangent;
+in vec3 Bitangent;
+#endif
 
 // material parameters
+#if TEXTURED
+uniform sampler2D albedoMap;
+uniform sampler2D normalMap;
+uniform sampler2D metallicMap;
+uniform sampler2D roughnessMap;
+uniform sampler2D aoMap;
+
+// Scaling factors
+uniform float roughnessScale;
+uniform float metallicScale;
+uniform vec3 albedoScale;
+#else
 uniform vec3 albedo;
-uniform float metallic;
-uniform float roughness;
 uniform float ao;
+#include "draw_data.glsl" // metallic and roughness change per draw
+#endif
 
 // IBL
+#if IBL_DIFFUSE
 uniform samplerCube irradianceMap;
+#endif
 
-// lighting infos
-uniform vec3 lightPositions[4];
-uniform vec3 lightColors[4];
-
-uniform vec3 viewPos; // camera(eye) position
+// camera(eye) position and lighting infos
+#include "frame_data.glsl"
+#if NR_LIGHTS > MAX_FRAME_LIGHTS
+#error NR_LIGHTS exceeds the lights available in FrameData
+#endif
 
-const float PI = 3.14159265359;
+#include "pbr_brdf.glsl"
 
-// Calculating how the microfacets are oriented relative to the normal N and H
-float DistributionGGX(vec3 N, vec3 H, float roughness)
+#if TEXTURED && NORMAL_MAP_SOURCE == NORMAL_SOURCE_MAP_DERIVATIVES
+// Calculate the corresponding normal in world space
+vec3 getNormalFromMap()
 {
-    float a = roughness*roughness;
-    float a2 = a * a;
-    float NdotH = max(dot(N, H), 0.0);
-    float NdotH2 = NdotH * NdotH;
-
-    float nom   = a2;
-    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
-    denom = PI * denom * denom;
+    vec3 tangentNormal = texture(normalMap, TexCoords).xyz * 2.0 - 1.0;
 
-    return nom / denom;
-}
-
-float GeometrySchlickGGX(float NdotV, float roughness)
-{
-    float r = (roughness + 1.0);
-    float k = ( r* r) / 8.0;
+ 	// dFdx(p) calculates the derivative of p with respect to the x-coordinate of the screen space.
+    // dFdy(p) calculates the derivative of p with respect to the y-coordinate of the screen space.
+    vec3 Q1  = dFdx(WorldPos);
+    vec3 Q2  = dFdy(WorldPos);
+    vec2 st1 = dFdx(TexCoords);
+    vec2 st2 = dFdy(TexCoords);
 
-    float nom   = NdotV;
-    float denom = NdotV * (1.0 - k) + k;
+    vec3 N   = normalize(Normal);
+    vec3 T  = normalize(Q1 * st2.t - Q2 * st1.t);
+    vec3 B  = -normalize(cross(N, T));
+    mat3 TBN = mat3(T, B, N);
 
-    return nom / denom;
+    return normalize(TBN * tangentNormal);
 }
-
-// Calculate the possibility that occlussion each other in microfacets
-// We calculate them both with V and L
-float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness)
-{
-    float NdotV = max(dot(N, V), 0.0);
-    float NdotL = max(dot(N, L), 0.0);
-    float ggx2 = GeometrySchlickGGX(NdotV, roughness);
-    float ggx1 = GeometrySchlickGGX(NdotL, roughness);
-
-    return ggx1 * ggx2;
-}
-
-// cosTheta: cosine between H and V
-// F0: base reflectance when angle degree is 0, non-metal is usually vec3(0.04f), metal F0 represents its base color.
-//
-// Notice: we use vec3 as return type because material itself reflects different kinds of light color differently.
-vec3 fresnelSchlick(float cosTheta, vec3 F0)
+#elif TEXTURED && NORMAL_MAP_SOURCE == NORMAL_SOURCE_VERTEX_TANGENT
+// Tangent frame interpolated from the vertices, not renormalized (MikkTSpace), only the result is.
+// Green runs along -Bitangent, as with the derivative frame above.
+vec3 getNormalFromMap()
 {
-    return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+    vec3 tangentNormal = texture(normalMap, TexCoords).xyz * 2.0 - 1.0;
+    return normalize(tangentNormal.x * Tangent - tangentNormal.y * Bitangent + tangentNormal.z * Normal);
 }
+#endif
 
 void main()
 {		
-    vec3 N = Normal;
-    vec3 V = normalize(viewPos - WorldPos);
-    vec3 R = reflect(-V, N); 
+#if TEXTURED
+	// Retrive data from maps
+    vec3 albedo     = pow(texture(albedoMap, TexCoords).rgb, vec3(2.2)) * albedoScale;
+#if METALLIC_ROUGHNESS_PACKED
+    float metallic  = texture(metallicMap, TexCoords).b * metallicScale;
+    float roughness = texture(roughnessMap, TexCoords).g * roughnessScale;
+#else
+    float metallic  = texture(metallicMap, TexCoords).r * metallicScale;
+    float roughness = texture(roughnessMap, TexCoords).r * roughnessScale;
+#endif
+    float ao        = texture(aoMap, TexCoords).r;
+#else
+    float metallic  = draw.material.x;
+    float roughness = draw.material.y;
+#endif
+
+#if TEXTURED && NORMAL_MAP_SOURCE != NORMAL_SOURCE_VERTEX
+    vec3 N = getNormalFromMap();
+#else
+    vec3 N = normalize(Normal);
+#endif
+    vec3 V = normalize(frame.viewPos.xyz - WorldPos);
 
     // calculate reflectance at normal incidence; if dia-electric (like plastic) use F0 
     // of 0.04 and if it's a metal, use the albedo color as F0 (metallic workflow)    
     vec3 F0 = vec3(0.04); 
     F0 = mix(F0, albedo, metallic);
 
-    // reflectance equation
+    // reflectance equation, NR_LIGHTS is a compile-time constant so the loop can be unrolled
     vec3 Lo = vec3(0.0);
-    for(int i = 0; i < 4; ++i)  {
-        // calculate per-light radiance
-        vec3 L = normalize(lightPositions[i] - WorldPos);
-        vec3 H = normalize(V + L);
-        float distance = length(lightPositions[i] - WorldPos);
-        float attenuation = 1.0 / (distance * distance);
-        vec3 radiance = lightColors[i] * attenuation;
-
-        // Cook-Torrance BRDF
-        float NDF = DistributionGGX(N, H, roughness);   
-        float G   = GeometrySmith(N, V, L, roughness);    
-        vec3 F    = fresnelSchlick(max(dot(H, V), 0.0), F0);        
-        
-        vec3 numerator    = NDF * G * F;
-        float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001; // + 0.0001 to prevent divide by zero
-        vec3 specular = numerator / denominator;
-        
-         // kS is equal to Fresnel
-        vec3 kS = F;
-        vec3 kD = vec3(1.0) - kS; // energy conservation
-        kD *= 1.0 - metallic;	// scaling by multiplying kd                 
-            
-        // scale light by NdotL
-        float NdotL = max(dot(N, L), 0.0);        
-
-        // add to outgoing radiance Lo
-        Lo += (kD * albedo / PI + specular) * radiance * NdotL; // already multiplied the BRDF by the Fresnel (kS)
-    }   
+    for(int i = 0; i < NR_LIGHTS; ++i)
+        Lo += PointLightRadiance(N, V, F0, albedo, metallic, roughness, WorldPos, frame.lightPositions[i].xyz, frame.lightColors[i].rgb);
     
     // ambient lighting
+#if IBL_DIFFUSE
     vec3 kS = fresnelSchlick(max(dot(N, V), 0.0), F0);
     vec3 kD = 1.0 - kS;
     kD *= 1.0 - metallic;	  
     vec3 irradiance = texture(irradianceMap, N).rgb;
     vec3 diffuse = irradiance * albedo;
     vec3 ambient = (kD * diffuse) * ao;
+#else
+    vec3 ambient = vec3(0.03) * albedo * ao;
+#endif
     
     vec3 color = ambient + Lo;
 
@@ -1,11 +1,26 @@
 #version 330 core
+// NORMAL_MAP_SOURCE  NORMAL_SOURCE_MAP_DERIVATIVES (default): TBN rebuilt from screen-space derivatives
+//                    NORMAL_SOURCE_VERTEX_TANGENT: TBN interpolated from the vertex tangents, pbr_ibl.vert
+//                    needs the same define
+#define NORMAL_SOURCE_MAP_DERIVATIVES 1
+#define NORMAL_SOURCE_VERTEX_TANGENT 2
+
+#ifndef NORMAL_MAP_SOURCE
+#define NORMAL_MAP_SOURCE NORMAL_SOURCE_MAP_DERIVATIVES
+#endif
+
 out vec4 FragColor;
 
 in vec3 WorldPos; // Representing p in rendering equation
 in vec2 TexCoords;
 in vec3 Normal;
+#if NORMAL_MAP_SOURCE == NORMAL_SOURCE_VERTEX_TANGENT
+in vec3 Tangent;
+in vec3 Bitangent;
+#endif
 
-uniform vec3 viewPos; // camera(eye) position
+// camera(eye) position and lighting infos
+#include "frame_data.glsl"
 
 // material parameters
 uniform sampler2D albedoMap;
@@ -14,10 +29,6 @@ uniform sampler2D metallicMap;
 uniform sampler2D roughnessMap;
 uniform sampler2D aoMap;
 
-// lighting infos
-uniform vec3 lightPosition;
-uniform vec3 lightColor;
-
 // Scaling factors
 uniform float roughnessScale;
 uniform float metallicScale;
@@ -25,6 +36,15 @@ uniform vec3 albedoScale;
 
 const float PI = 3.1415926;
 
+#if NORMAL_MAP_SOURCE == NORMAL_SOURCE_VERTEX_TANGENT
+// Tangent frame interpolated from the vertices, not renormalized (MikkTSpace), only the result is.
+// Green runs along -Bitangent, as with the derivative frame below.
+vec3 getNormalFromMap()
+{
+    vec3 tangentNormal = texture(normalMap, TexCoords).xyz * 2.0 - 1.0;
+    return normalize(tangentNormal.x * Tangent - tangentNormal.y * Bitangent + tangentNormal.z * Normal);
+}
+#else
 // Calculate the corresponding normal in world space
 vec3 getNormalFromMap()
 {
@@ -44,6 +64,7 @@ vec3 getNormalFromMap()
 
     return normalize(TBN * tangentNormal);
 }
+#endif
 
 // Calculating how the microfacets are oriented relative to the normal N and H
 float DistributionGGX(vec3 N, vec3 H, float roughness)
@@ -102,7 +123,7 @@ void main()
 
 	// Both N & V is in world space
 	vec3 N = getNormalFromMap(); // Normal
-	vec3 V = normalize(viewPos - WorldPos); // View direction, representing w_o
+	vec3 V = normalize(frame.viewPos.xyz - WorldPos); // View direction, representing w_o
 
 	vec3 F0 = vec3(0.04f); // For non-metal material, we simply use vec3(0.04f)
 	F0 = mix(F0, albedo, metallic); // For metal material, we interpolate F0 to albedo based on the metallic coefficient
@@ -110,11 +131,11 @@ void main()
 	vec3 Lo = vec3(0.0f);
 	for(int i = 0; i < 1; i++) {
 		// Calculate per-light radiance
-		vec3 L = normalize(lightPosition - WorldPos); // Light direction, representing w_i
+		vec3 L = normalize(frame.lightPositions[i].xyz - WorldPos); // Light direction, representing w_i
 		vec3 H = normalize(V + L); // HalfwayVector
-		float distance = length(lightPosition - WorldPos);
+		float distance = length(frame.lightPositions[i].xyz - WorldPos);
 		float attenuation = 1.0f / (distance * distance); // Simple attenuation, may use linear and quadratic coefficient later
-		vec3 incomingRadiance = lightColor * attenuation;
+		vec3 incomingRadiance = frame.lightColors[i].rgb * attenuation;
 		float NdotL = max(dot(N, L), 0.0f);
         vec3 scaledIncomingRadiance = incomingRadiance * NdotL; 
 
@@ -10,7 +10,10 @@
 #include <GLFW/glfw3.h>
 
 #include "camera.h"
+#include "draw_uniforms.h"
+#include "frame_uniforms.h"
 #include "geometry_renderers.h"
+#include "gl_state_cache.h"
 #include "model.h"
 #include "scene_manager.h"
 #include "shader.h"
@@ -81,7 +84,7 @@ int main()
 	glGenVertexArrays(1, &VAO);
 
 	// Bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex attributes(s).
-	glBindVertexArray(VAO);
+	GLStateCache::Get().BindVertexArray(VAO);
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 	glBufferData(GL_ARRAY_BUFFER, bezierCurvePoints.size() * sizeof(glm::vec3), &bezierCurvePoints[0], GL_STATIC_DRAW);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
@@ -90,7 +93,7 @@ int main()
 	unsigned int pointsVAO, pointsVBO;
 	glGenBuffers(1, &pointsVBO);
 	glGenVertexArrays(1, &pointsVAO);
-	glBindVertexArray(pointsVAO);
+	GLStateCache::Get().BindVertexArray(pointsVAO);
 	glBindBuffer(GL_ARRAY_BUFFER, pointsVBO);
 	glBufferData(GL_ARRAY_BUFFER, controlPoints.size() * sizeof(glm::vec3), &controlPoints[0], GL_STATIC_DRAW);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
@@ -108,6 +111,11 @@ int main()
 
 	// shader configs
 	Shader shader("res/shaders/debug_light.vs", "res/shaders/debug_light.fs");
+	FrameUniformBuffer frameUniforms; // projection and view
+	frameUniforms.Attach(shader);
+	DrawUniformRing drawUniforms(1); // model
+	drawUniforms.Attach(shader);
+	FrameData frameData;
 
 	// Imgui configs
 	// ----------------
@@ -134,21 +142,24 @@ int main()
 		glm::mat4 view = camera->GetViewMatrix();
 		glm::mat4 model = glm::mat4(1.0f);
 		model = glm::scale(model, glm::vec3(0.5f));
-		shader.SetMat4("projection", projection);
-		shader.SetMat4("view", view);
-		shader.SetMat4("model", model);
+		frameData.projection = projection;
+		frameData.view = view;
+		frameUniforms.Update(frameData);
+		drawUniforms.BeginFrame();
+		drawUniforms.Push(DrawData(model));
 		shader.SetInt("use_orange_color", 1);
 		shader.SetInt("use_red_color", 0);
-		glBindVertexArray(VAO);
+		GLStateCache::Get().BindVertexArray(VAO);
 		glDrawArrays(GL_LINE_STRIP, 0, bezierCurvePoints.size());
-		glBindVertexArray(0);
+		GLStateCache::Get().BindVertexArray(0);
 
 		glPointSize(10.0f);
 		shader.SetInt("use_orange_color", 0);
 		shader.SetInt("use_red_color", 1);
-		glBindVertexArray(pointsVAO); 
+		GLStateCache::Get().BindVertexArray(pointsVAO); 
 		glDrawArrays(GL_POINTS, 0, 4); 
-		glBindVertexArray(0); 
+		GLStateCache::Get().BindVertexArray(0); 
+		drawUniforms.EndFrame();
 
 		if (firstTimeOutputPosition) {
 			for (size_t i = 0; i < controlPoints.size(); i++) {
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "shader.h"
+
+// CPU mirror of the std140 "DrawData" uniform block (res/shaders/draw_data.glsl).
+// normalMatrix is stored as a mat4 (std140 pads every mat3 column to a vec4 anyway), the shaders
+// use its upper 3x3.
+struct DrawData
+{
+	glm::mat4 model = glm::mat4(1.0f);
+	glm::mat4 normalMatrix = glm::mat4(1.0f);
+	glm::vec4 material = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f); // x: metallic, y: roughness
+
+	DrawData() = default;
+	DrawData(const glm::mat4& _model)
+		: model(_model), normalMatrix(glm::transpose(glm::inverse(glm::mat3(_model)))) {}
+};
+
+static_assert(sizeof(DrawData) == 2 * 64 + 16, "DrawData must match the std140 layout");
+
+// Ring buffer of per-draw uniform data. Each draw writes its DrawData into the next slice and
+// binds that slice with glBindBufferRange, instead of one glUniform* call per per-object uniform.
+//
+// The buffer is split into kFrameRegions regions, one per frame in flight. A region is only
+// written again after the fence placed at the end of the frame that last used it has signaled,
+// so writes never need the driver to synchronize with the GPU:
+//  - ARB_buffer_storage: mapped once, persistent + coherent, writes are plain memcpy
+//  - otherwise: every slice is mapped with glMapBufferRange(UNSYNCHRONIZED | INVALIDATE_RANGE)
+// A frame with more draws than maxDrawsPerFrame spills into a separate buffer and the ring grows
+// to fit before the next frame, slices that may still be in flight are never overwritten.
+//
+// Usage:
+//   DrawUniformRing drawUniforms(maxDrawsPerFrame);
+//   drawUniforms.Attach(shader);    // once, after the shader is built
+//   drawUniforms.BeginFrame();
+//   drawUniforms.Push(DrawData(model)); object.Render();
+//   drawUniforms.EndFrame();
+class DrawUniformRing
+{
+public:
+	static constexpr unsigned int kBindingPoint = 1; // FrameData uses 0
+	static constexpr int kFrameRegions = 3;
+
+	explicit DrawUniformRing(unsigned int _maxDrawsPerFrame)
+		: maxDrawsPerFrame(std::max(1u, _maxDrawsPerFrame))
+	{
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		stride = ((GLsizeiptr)sizeof(DrawData) + alignment - 1) / alignment * alignment;
+		Allocate();
+	}
+
+	~DrawUniformRing()
+	{
+		Release();
+		if (overflowUbo)
+			glDeleteBuffers(1, &overflowUbo);
+	}
+
+	DrawUniformRing(const DrawUniformRing&) = delete;
+	DrawUniformRing& operator=(const DrawUniformRing&) = delete;
+
+	// Points the shader's DrawData block at kBindingPoint
+	void Attach(Shader& _shader)
+	{
+		_shader.WaitUntilReady();
+		_shader.SetUniformBlock("DrawData", kBindingPoint);
+	}
+
+	// Waits until the GPU is done with this frame's region (normally it already is)
+	void BeginFrame()
+	{
+		GLsync& fence = fences[region];
+		if (fence) {
+			GLenum result = glClientWaitSync(fence, 0, 0);
+			if (result == GL_TIMEOUT_EXPIRED) {
+				stalls++;
+				while (result == GL_TIMEOUT_EXPIRED)
+					result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+			}
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+		drawsThisFrame = 0;
+		overflow.clear();
+
+		// Last frame spilled, make room for all of its draws in the ring itself
+		if (requiredDraws > maxDrawsPerFrame) {
+			WaitForAllFrames();
+			Release();
+			maxDrawsPerFrame = requiredDraws;
+			Allocate();
+			region = 0;
+		}
+	}
+
+	// Writes _data into the next slice of this frame's region and binds it to kBindingPoint
+	void Push(const DrawData& _data)
+	{
+		BindSlice(Write(_data));
+	}
+
+	// Writes _data into the next slice without binding it, returns the slice offset for BindSlice().
+	// Lets a render queue write all draws up front and bind them later in its own order.
+	GLintptr Write(const DrawData& _data)
+	{
+		if (drawsThisFrame >= maxDrawsPerFrame)
+			return WriteOverflow(_data);
+
+		GLintptr offset = region * regionSize + drawsThisFrame * stride;
+		if (persistent) {
+			std::memcpy(mapped + offset, &_data, sizeof(DrawData));
+		}
+		else {
+			glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+			void* slice = glMapBufferRange(GL_UNIFORM_BUFFER, offset, sizeof(DrawData),
+				GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			if (slice) {
+				std::memcpy(slice, &_data, sizeof(DrawData));
+				glUnmapBuffer(GL_UNIFORM_BUFFER);
+			}
+		}
+		drawsThisFrame++;
+		return offset;
+	}
+
+	void BindSlice(GLintptr _offset)
+	{
+		if (_offset >= regionSize * kFrameRegions)
+			glBindBufferRange(GL_UNIFORM_BUFFER, kBindingPoint, overflowUbo, _offset - regionSize * kFrameRegions, sizeof(DrawData));
+		else
+			glBindBufferRange(GL_UNIFORM_BUFFER, kBindingPoint, ubo, _offset, sizeof(DrawData));
+	}
+
+	// Fences this frame's region and moves on to the next one
+	void EndFrame()
+	{
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		region = (region + 1) % kFrameRegions;
+		lastFrameDraws = drawsThisFrame + (unsigned int)overflow.size();
+		requiredDraws = std::max(requiredDraws, lastFrameDraws);
+	}
+
+	bool IsPersistent() const { return persistent; }
+	unsigned int GetDrawsLastFrame() const { return lastFrameDraws; }
+	unsigned int GetMaxDrawsPerFrame() const { return maxDrawsPerFrame; }
+	// Frames whose BeginFrame() had to wait for the GPU, should stay 0 with kFrameRegions regions
+	unsigned int GetStallCount() const { return stalls; }
+
+private:
+	void Allocate()
+	{
+		regionSize = stride * maxDrawsPerFrame;
+		GLsizeiptr size = regionSize * kFrameRegions;
+
+		glGenBuffers(1, &ubo);
+		glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+		persistent = GLEW_ARB_buffer_storage || GLEW_VERSION_4_4;
+		if (persistent) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+			mapped = static_cast<char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags));
+			if (!mapped) {
+#ifdef _DEBUG
+				std::cerr << "DrawUniformRing: persistent mapping failed, falling back to glMapBufferRange per draw.\n";
+#endif
+				glDeleteBuffers(1, &ubo);
+				glGenBuffers(1, &ubo);
+				glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+				persistent = false;
+			}
+		}
+		if (!persistent)
+			glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	void Release()
+	{
+		for (GLsync& fence : fences) {
+			if (fence)
+				glDeleteSync(fence);
+			fence = nullptr;
+		}
+		if (mapped) {
+			glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+			glUnmapBuffer(GL_UNIFORM_BUFFER);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+			mapped = nullptr;
+		}
+		glDeleteBuffers(1, &ubo);
+		ubo = 0;
+	}
+
+	void WaitForAllFrames()
+	{
+		for (GLsync& fence : fences) {
+			if (fence)
+				glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		}
+	}
+
+	// The region is full: the draw goes to a separate buffer through glBufferSubData, which the
+	// driver orders after any pending reads, instead of reusing a slice that may still be in flight.
+	// The ring grows to fit at the next BeginFrame(). Offsets past the ring address this buffer.
+	GLintptr WriteOverflow(const DrawData& _data)
+	{
+#ifdef _DEBUG
+		if (overflow.empty())
+			std::cerr << "DrawUniformRing: more than " << maxDrawsPerFrame << " draws this frame, growing the ring.\n";
+#endif
+		const size_t index = overflow.size();
+		overflow.push_back(_data);
+
+		if (!overflowUbo)
+			glGenBuffers(1, &overflowUbo);
+		glBindBuffer(GL_UNIFORM_BUFFER, overflowUbo);
+		if (overflow.size() > overflowCapacity) {
+			// Fresh storage, slices written earlier this frame but not drawn yet are copied over
+			overflowCapacity = std::max<size_t>(16, overflowCapacity * 2);
+			glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)overflowCapacity * stride, nullptr, GL_STREAM_DRAW);
+			for (size_t i = 0; i < overflow.size(); i++)
+				glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr)i * stride, sizeof(DrawData), &overflow[i]);
+		}
+		else {
+			glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr)index * stride, sizeof(DrawData), &_data);
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		return regionSize * kFrameRegions + (GLintptr)index * stride;
+	}
+
+	unsigned int ubo = 0;
+	char* mapped = nullptr; // whole buffer, persistent mode only
+	bool persistent = false;
+	GLsizeiptr stride = 0;     // sizeof(DrawData) rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	GLsizeiptr regionSize = 0; // stride * maxDrawsPerFrame
+	unsigned int maxDrawsPerFrame = 0;
+	unsigned int drawsThisFrame = 0;
+	unsigned int lastFrameDraws = 0;
+	unsigned int stalls = 0;
+	unsigned int requiredDraws = 0; // most draws any frame wanted, the ring grows to it
+	int region = 0;
+	GLsync fences[kFrameRegions] = {};
+
+	unsigned int overflowUbo = 0;      // draws past maxDrawsPerFrame in the current frame
+	size_t overflowCapacity = 0;       // in slices
+	std::vector<DrawData> overflow;    // CPU copy, re-uploaded when overflowUbo grows
+};
\ No newline at end of file
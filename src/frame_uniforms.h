@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "shader.h"
+
+// Upper bound of lights in FrameData, must match MAX_FRAME_LIGHTS in res/shaders/frame_data.glsl
+constexpr int kMaxFrameLights = 8;
+
+// CPU mirror of the std140 "FrameData" uniform block (res/shaders/frame_data.glsl).
+// Only mat4 and vec4 members, so the C++ layout is the std140 layout without any padding fields.
+struct FrameData
+{
+	glm::mat4 projection = glm::mat4(1.0f);
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::vec4 viewPos = glm::vec4(0.0f);            // xyz: camera position
+	glm::vec4 lightPositions[kMaxFrameLights] = {}; // xyz: world position
+	glm::vec4 lightColors[kMaxFrameLights] = {};    // rgb: radiance
+};
+
+static_assert(sizeof(FrameData) == 2 * 64 + 16 + 2 * kMaxFrameLights * 16, "FrameData must match the std140 layout");
+
+// Per-frame uniform buffer shared by all programs. The camera and lights are written once per frame
+// with a single glBufferSubData instead of one glUniform* call per program and uniform.
+//
+// Usage:
+//   FrameUniformBuffer frameUniforms;
+//   frameUniforms.Attach(shader);   // once, after the shader is built
+//   ...
+//   frameUniforms.Update(frameData); // once per frame, before the first draw
+class FrameUniformBuffer
+{
+public:
+	static constexpr unsigned int kBindingPoint = 0; // fixed, every program's FrameData block points here
+
+	FrameUniformBuffer()
+	{
+		glGenBuffers(1, &ubo);
+		glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, kBindingPoint, ubo);
+	}
+
+	~FrameUniformBuffer() { glDeleteBuffers(1, &ubo); }
+
+	FrameUniformBuffer(const FrameUniformBuffer&) = delete;
+	FrameUniformBuffer& operator=(const FrameUniformBuffer&) = delete;
+
+	// Points the shader's FrameData block at kBindingPoint. Also counts how many glUniform* calls
+	// the block replaces per frame (one per active member, array elements counted separately).
+	void Attach(Shader& _shader)
+	{
+		_shader.WaitUntilReady();
+		_shader.SetUniformBlock("FrameData", kBindingPoint);
+
+		GLuint blockIndex = glGetUniformBlockIndex(_shader.GetID(), "FrameData");
+		if (blockIndex == GL_INVALID_INDEX)
+			return;
+
+		GLint memberCount = 0;
+		glGetActiveUniformBlockiv(_shader.GetID(), blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &memberCount);
+		if (memberCount <= 0)
+			return;
+
+		std::vector<GLint> members(memberCount);
+		glGetActiveUniformBlockiv(_shader.GetID(), blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, members.data());
+		std::vector<GLint> sizes(memberCount);
+		glGetActiveUniformsiv(_shader.GetID(), memberCount, reinterpret_cast<const GLuint*>(members.data()), GL_UNIFORM_SIZE, sizes.data());
+		for (GLint size : sizes)
+			replacedUniformCalls += (unsigned int)size;
+	}
+
+	void Update(const FrameData& _data)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &_data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		updateCount++;
+	}
+
+	// Buffer updates since the last ResetUpdateCount(), 1 per frame when used as intended
+	unsigned int GetUpdateCount() const { return updateCount; }
+	void ResetUpdateCount() { updateCount = 0; }
+
+	// glUniform* calls per frame the attached programs would need without the block
+	unsigned int GetReplacedUniformCalls() const { return replacedUniformCalls; }
+
+private:
+	unsigned int ubo = 0;
+	unsigned int updateCount = 0;
+	unsigned int replacedUniformCalls = 0;
+};
\ No newline at end of file
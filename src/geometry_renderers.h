@@ -2,6 +2,8 @@
 // 
 // Note: Each function includes vertex attributes by position, normal, and texture coordinates, which means:
 // You have to specify layout(location = x) in glsl code by this order as well! 
+// Cube, Sphere and Quad also carry a generated tangent (location 3) and bitangent (location 4) for
+// normal mapping, in the layout of Vertex (mesh.h), see TangentGenerator.
 //
 // 
 // Author: Zhenhuan Yu
@@ -9,13 +11,46 @@
 
 #pragma once
 
+#include <algorithm>
 #include <vector>
 #include <cmath>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "gl_state_cache.h"
+#include "index_buffer.h"
+#include "tangent_generator.h"
+
 namespace yzh {
 
+	// Position, normal, texture coordinates (8 floats per vertex) expanded with the tangent and
+	// bitangent TangentGenerator computes over _triangles
+	inline std::vector<float> AddTangents(const float* _vertices, size_t _vertexCount, const std::vector<unsigned int>& _triangles)
+	{
+		const size_t stride = TangentGenerator::kMinStride;
+		std::vector<float> expanded(_vertexCount * stride, 0.0f);
+		for (size_t i = 0; i < _vertexCount; i++)
+			std::copy(_vertices + i * 8, _vertices + i * 8 + 8, expanded.begin() + i * stride);
+		TangentGenerator::Generate(expanded.data(), stride, _vertexCount, _triangles);
+		return expanded;
+	}
+
+	// Attribute pointers of AddTangents() vertices for the bound VAO and GL_ARRAY_BUFFER
+	inline void SetupTangentVertexAttributes()
+	{
+		const GLsizei stride = (GLsizei)(TangentGenerator::kMinStride * sizeof(float));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(TangentGenerator::kNormalOffset * sizeof(float)));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(TangentGenerator::kTexCoordsOffset * sizeof(float)));
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)(TangentGenerator::kTangentOffset * sizeof(float)));
+		glEnableVertexAttribArray(4);
+		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (void*)(TangentGenerator::kBitangentOffset * sizeof(float)));
+	}
+
 	// Base class for all shapes with pure virual functions
 	class GeometryShape
 	{
@@ -29,7 +64,7 @@ namespace yzh {
 	};
 
 	// This class provides a cube using OpenGL with dimensions of 2 * 2 * 2 units
-	// The cube's vertex attributes include position, normal, and texture coordinates.
+	// The cube's vertex attributes include position, normal, texture coordinates, tangent and bitangent.
 	// Note: This function does not use an Index Buffer Object (IBO).
 	class Cube: public GeometryShape
 	{
@@ -82,21 +117,22 @@ namespace yzh {
 					 -1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f      
 				};
 
+				// Non-indexed, every three vertices are a triangle
+				std::vector<unsigned int> triangles(36);
+				for (unsigned int i = 0; i < 36; i++)
+					triangles[i] = i;
+				std::vector<float> withTangents = AddTangents(vertices, 36, triangles);
+
 				glGenVertexArrays(1, &this->VAO);
 				glGenBuffers(1, &this->VBO);
 				// fill buffer
 				glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-				glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+				glBufferData(GL_ARRAY_BUFFER, withTangents.size() * sizeof(float), withTangents.data(), GL_STATIC_DRAW);
 				// link vertex attributes
-				glBindVertexArray(this->VAO);
-				glEnableVertexAttribArray(0);
-				glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-				glEnableVertexAttribArray(1);
-				glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-				glEnableVertexAttribArray(2);
-				glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+				GLStateCache::Get().BindVertexArray(this->VAO);
+				SetupTangentVertexAttributes();
 				glBindBuffer(GL_ARRAY_BUFFER, 0);
-				glBindVertexArray(0);
+				GLStateCache::Get().BindVertexArray(0);
 			}
 		}
 
@@ -106,6 +142,7 @@ namespace yzh {
 		~Cube() override
 		{
 			if (this->VAO != 0) {
+				GLStateCache::Get().ForgetVertexArray(this->VAO);
 				glDeleteVertexArrays(1, &this->VAO);
 				glDeleteBuffers(1, &this->VBO);
 				this->VAO = 0;
@@ -115,9 +152,8 @@ namespace yzh {
 		void Render() override
 		{
 			if (this->VAO != 0) {
-				glBindVertexArray(this->VAO);
+				GLStateCache::Get().BindVertexArray(this->VAO);
 				glDrawArrays(GL_TRIANGLES, 0, 36);
-				glBindVertexArray(0);
 			}
 		}
 
@@ -126,7 +162,7 @@ namespace yzh {
 	};
 
 	// This class provides a sphere in OpenGL with a radius of 2.0 units.
-	// Vertex attributes include position, normal, and texture coordinates.
+	// Vertex attributes include position, normal, texture coordinates, tangent and bitangent.
 	// The sphere is detailed with 64 segments along both the X and Y axes, resulting in a highly detailed mesh.
 	// he function allows for customization of the sphere's detail level through x_segments and y_segments.
 	class Sphere: public GeometryShape
@@ -189,18 +225,17 @@ namespace yzh {
 					oddRow = !oddRow;
 				}
 
-				glBindVertexArray(this->VAO);
+				std::vector<float> withTangents = AddTangents(vertices.data(), vertices.size() / 8, TangentGenerator::StripToTriangles(indices));
+
+				GLStateCache::Get().BindVertexArray(this->VAO);
 				glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-				glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+				glBufferData(GL_ARRAY_BUFFER, withTangents.size() * sizeof(float), withTangents.data(), GL_STATIC_DRAW);
 				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->IBO);
-				glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-				glEnableVertexAttribArray(0);
-				glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-				glEnableVertexAttribArray(1);
-				glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-				glEnableVertexAttribArray(2);
-				glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-				glBindVertexArray(0);
+				this->indexType = IndexTypeFor(vertices.size() / 8);
+				this->indexCount = (GLsizei)indices.size();
+				UploadIndices(this->indexType, indices.data(), indices.size());
+				SetupTangentVertexAttributes();
+				GLStateCache::Get().BindVertexArray(0);
 			}
 		}
 
@@ -208,6 +243,7 @@ namespace yzh {
 		{
 			// Prevent multiple de-allocation
 			if (this->VAO != 0) {
+				GLStateCache::Get().ForgetVertexArray(this->VAO);
 				glDeleteVertexArrays(1, &this->VAO);
 				glDeleteBuffers(1, &this->VBO);
 				glDeleteBuffers(1, &this->IBO);
@@ -221,20 +257,22 @@ namespace yzh {
 		void Render() override
 		{
 			if (this->VAO != 0) {
-				glBindVertexArray(this->VAO);
-				glDrawElements(GL_TRIANGLE_STRIP, (64 + 1) * 64 * 2, GL_UNSIGNED_INT, 0);
-				glBindVertexArray(0);
+				GLStateCache::Get().BindVertexArray(this->VAO);
+				glDrawElements(GL_TRIANGLE_STRIP, this->indexCount, this->indexType, 0);
 			}
 		}
 
 		const unsigned int GetVAO() const { return VAO; }
+		size_t GetIndexBufferBytes() const { return (size_t)indexCount * IndexTypeSize(indexType); }
 
 	private:
 		unsigned int VAO = 0, VBO = 0, IBO = 0;
+		GLsizei indexCount = 0;
+		GLenum indexType = GL_UNSIGNED_INT;
 	};
 
 	// This class provides a 2D quad in OpenGL with dimensions of 2 * 2 units.
-    // Vertex attributes include position, normal, and texture coordinates.
+    // Vertex attributes include position, normal, texture coordinates, tangent and bitangent.
     // The quad is rendered using GL_TRIANGLE_STRIP for optimized rendering.
 	class Quad: public GeometryShape
 	{
@@ -250,31 +288,25 @@ namespace yzh {
 					 1.0f, -1.0f, 0.0f,  0.0f, 0.0f, 1.0f,  1.0f, 0.0f,
 				};
 
+				std::vector<float> withTangents = AddTangents(quadVertices, 4, TangentGenerator::StripToTriangles({ 0, 1, 2, 3 }));
+
 				glGenVertexArrays(1, &this->VAO);
 				glGenBuffers(1, &this->VBO);
-				glBindVertexArray(this->VAO);
+				GLStateCache::Get().BindVertexArray(this->VAO);
 				glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-				glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
-
-				// Position attribute
-				glEnableVertexAttribArray(0);
-				glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-
-				// Normal attribute
-				glEnableVertexAttribArray(1);
-				glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+				glBufferData(GL_ARRAY_BUFFER, withTangents.size() * sizeof(float), withTangents.data(), GL_STATIC_DRAW);
 
-				// Texture coordinate attribute
-				glEnableVertexAttribArray(2);
-				glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+				// Position, normal, texture coordinate, tangent and bitangent attributes
+				SetupTangentVertexAttributes();
 
-				glBindVertexArray(0);
+				GLStateCache::Get().BindVertexArray(0);
 			}
 		}
 
 		~Quad() override
 		{
 			if (VAO != 0) {
+				GLStateCache::Get().ForgetVertexArray(this->VAO);
 				glDeleteVertexArrays(1, &this->VAO);
 				glDeleteBuffers(1, &this->VBO);
 				this->VAO = 0;
@@ -284,9 +316,8 @@ namespace yzh {
 		void Render() override
 		{
 			if (VAO != 0) {
-				glBindVertexArray(this->VAO);
+				GLStateCache::Get().BindVertexArray(this->VAO);
 				glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-				glBindVertexArray(0);
 			}
 		}
 	    
@@ -313,6 +344,7 @@ namespace yzh {
 		~Circle() override
 		{
 			if (this->VAO != 0) {
+				GLStateCache::Get().ForgetVertexArray(this->VAO);
 				glDeleteVertexArrays(1, &this->VAO);
 				glDeleteBuffers(1, &this->VBO);
 			}
@@ -321,10 +353,9 @@ namespace yzh {
 		void Render() override
 		{
 			if (this->VAO != 0) {
-				glBindVertexArray(this->VAO);
+				GLStateCache::Get().BindVertexArray(this->VAO);
 				// Render the circle
 				glDrawArrays(GL_TRIANGLE_FAN, 0, nrSegments + 2); // +2 for the center and the duplicate first vertex at the end
-				glBindVertexArray(0);
 			}
 		}
 
@@ -355,7 +386,7 @@ namespace yzh {
 			glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
 			glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
 
-			glBindVertexArray(this->VAO);
+			GLStateCache::Get().BindVertexArray(this->VAO);
 			glEnableVertexAttribArray(0);
 			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
 			glEnableVertexAttribArray(1);
@@ -363,7 +394,7 @@ namespace yzh {
 			glEnableVertexAttribArray(2);
 			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
 			glBindBuffer(GL_ARRAY_BUFFER, 0);
-			glBindVertexArray(0);
+			GLStateCache::Get().BindVertexArray(0);
 		}
 
 		unsigned int VAO = 0, VBO = 0;
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <GL/glew.h>
+
+// Shadow copy of the GL state that the renderer changes most often: current program, VAO,
+// per-unit 2D / cube map texture bindings, draw framebuffer, viewport and a few enable bits.
+// A call that would set the value that is already current is dropped before it reaches the driver.
+//
+// The cache only knows what goes through it. Code that changes these states with raw gl* calls
+// has to call Invalidate() afterwards, objects that are deleted while bound have to be forgotten
+// (ForgetProgram / ForgetVertexArray / ForgetTexture / ForgetFramebuffer).
+//
+// Usage:
+//   GLStateCache& state = GLStateCache::Get();
+//   state.UseProgram(program);
+//   state.BindTexture(0, GL_TEXTURE_2D, albedo);
+//   state.BindVertexArray(VAO);
+//   ...
+//   state.GetStats(); state.ResetStats(); // once per frame
+class GLStateCache
+{
+public:
+	struct Stats
+	{
+		unsigned int issued = 0;  // state changes passed to the driver
+		unsigned int skipped = 0; // redundant state changes dropped
+	};
+
+	static GLStateCache& Get()
+	{
+		static GLStateCache cache;
+		return cache;
+	}
+
+	GLStateCache(const GLStateCache&) = delete;
+	GLStateCache& operator=(const GLStateCache&) = delete;
+
+	void UseProgram(GLuint _program)
+	{
+		if (Skip(program == _program))
+			return;
+		program = _program;
+		glUseProgram(_program);
+	}
+
+	void BindVertexArray(GLuint _vao)
+	{
+		if (Skip(vertexArray == _vao))
+			return;
+		vertexArray = _vao;
+		glBindVertexArray(_vao);
+	}
+
+	// Binds _texture to _target on texture unit _unit, switching the active unit only when needed.
+	// Targets other than GL_TEXTURE_2D and GL_TEXTURE_CUBE_MAP (or units past kMaxTextureUnits)
+	// are passed through untracked.
+	void BindTexture(unsigned int _unit, GLenum _target, GLuint _texture)
+	{
+		int target = TargetIndex(_target);
+		if (target < 0 || _unit >= kMaxTextureUnits) {
+			ActiveTexture(_unit);
+			stats.issued++;
+			glBindTexture(_target, _texture);
+			return;
+		}
+
+		GLuint& bound = textures[_unit][target];
+		if (Skip(bound == _texture))
+			return;
+		ActiveTexture(_unit);
+		bound = _texture;
+		glBindTexture(_target, _texture);
+	}
+
+	// Binds on whichever unit is active, for texture creation and uploads
+	void BindTexture(GLenum _target, GLuint _texture)
+	{
+		BindTexture(activeUnit == kUnknown ? 0 : activeUnit, _target, _texture);
+	}
+
+	void BindFramebuffer(GLuint _framebuffer)
+	{
+		if (Skip(framebuffer == _framebuffer))
+			return;
+		framebuffer = _framebuffer;
+		glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+	}
+
+	void Viewport(GLint _x, GLint _y, GLsizei _width, GLsizei _height)
+	{
+		if (Skip(viewportValid && viewport[0] == _x && viewport[1] == _y && viewport[2] == _width && viewport[3] == _height))
+			return;
+		viewportValid = true;
+		viewport[0] = _x;
+		viewport[1] = _y;
+		viewport[2] = _width;
+		viewport[3] = _height;
+		glViewport(_x, _y, _width, _height);
+	}
+
+	void Enable(GLenum _capability) { SetEnabled(_capability, true); }
+	void Disable(GLenum _capability) { SetEnabled(_capability, false); }
+
+	void SetEnabled(GLenum _capability, bool _enabled)
+	{
+		int index = CapabilityIndex(_capability);
+		if (index >= 0) {
+			if (Skip(capabilities[index] == (_enabled ? 1 : 0)))
+				return;
+			capabilities[index] = _enabled ? 1 : 0;
+		}
+		else {
+			stats.issued++;
+		}
+		if (_enabled)
+			glEnable(_capability);
+		else
+			glDisable(_capability);
+	}
+
+	// Forgets everything, the next call of every kind reaches the driver
+	void Invalidate()
+	{
+		program = vertexArray = framebuffer = activeUnit = kUnknown;
+		for (auto& unit : textures)
+			unit[0] = unit[1] = kUnknown;
+		for (int& capability : capabilities)
+			capability = -1;
+		viewportValid = false;
+	}
+
+	// Deleting a bound object resets that binding to 0 in GL, keep the cache in line
+	void ForgetProgram(GLuint _program) { if (program == _program) program = kUnknown; }
+	void ForgetVertexArray(GLuint _vao) { if (vertexArray == _vao) vertexArray = 0; }
+	void ForgetFramebuffer(GLuint _framebuffer) { if (framebuffer == _framebuffer) framebuffer = 0; }
+	void ForgetTexture(GLuint _texture)
+	{
+		for (auto& unit : textures) {
+			for (GLuint& bound : unit) {
+				if (bound == _texture)
+					bound = 0;
+			}
+		}
+	}
+
+	const Stats& GetStats() const { return stats; }
+	void ResetStats() { stats = Stats(); }
+
+private:
+	GLStateCache() { Invalidate(); }
+
+	static constexpr GLuint kUnknown = ~0u;
+	static constexpr unsigned int kMaxTextureUnits = 16;
+	static constexpr GLenum kCapabilities[] = {
+		GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND, GL_SCISSOR_TEST, GL_STENCIL_TEST,
+		GL_TEXTURE_CUBE_MAP_SEAMLESS, GL_PROGRAM_POINT_SIZE, GL_MULTISAMPLE
+	};
+	static constexpr int kCapabilityCount = sizeof(kCapabilities) / sizeof(kCapabilities[0]);
+
+	// Counts the call and returns true when it is redundant
+	bool Skip(bool _redundant)
+	{
+		if (_redundant)
+			stats.skipped++;
+		else
+			stats.issued++;
+		return _redundant;
+	}
+
+	void ActiveTexture(unsigned int _unit)
+	{
+		if (Skip(activeUnit == _unit))
+			return;
+		activeUnit = _unit;
+		glActiveTexture(GL_TEXTURE0 + _unit);
+	}
+
+	static int TargetIndex(GLenum _target)
+	{
+		if (_target == GL_TEXTURE_2D)
+			return 0;
+		if (_target == GL_TEXTURE_CUBE_MAP)
+			return 1;
+		return -1;
+	}
+
+	static int CapabilityIndex(GLenum _capability)
+	{
+		for (int i = 0; i < kCapabilityCount; i++) {
+			if (kCapabilities[i] == _capability)
+				return i;
+		}
+		return -1;
+	}
+
+private:
+	GLuint program = kUnknown;
+	GLuint vertexArray = kUnknown;
+	GLuint framebuffer = kUnknown;
+	GLuint activeUnit = kUnknown;
+	GLuint textures[kMaxTextureUnits][2] = {}; // [unit][0: GL_TEXTURE_2D, 1: GL_TEXTURE_CUBE_MAP]
+	int capabilities[kCapabilityCount] = {};   // -1 unknown, 0 disabled, 1 enabled
+	GLint viewport[4] = {};
+	bool viewportValid = false;
+	Stats stats;
+};
\ No newline at end of file
@@ -0,0 +1,671 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "draw_uniforms.h"
+#include "gl_state_cache.h"
+#include "json.h"
+#include "mesh_cache.h"
+#include "shader.h"
+#include "texture_decoder.h"
+#include "texture_manager.h"
+
+// glTF 2.0 model (.gltf with external or data: buffers, or binary .glb) loaded without Assimp.
+//
+// Buffer files are memory-mapped and every bufferView a primitive reads goes to one GL buffer with
+// a single glBufferData straight from the mapping. Accessors become vertex attribute pointers with
+// their own component type, normalization, stride and offset, so no vertex is converted or copied
+// on the CPU. Attributes use the Vertex locations: POSITION 0, NORMAL 1, TEXCOORD_0 2 and
+// TANGENT 3 (xyz, w: bitangent sign, as in PackedVertex).
+//
+// pbrMetallicRoughness materials bind to the PBR sampler conventions (units as in lighting_textured.cpp):
+//   albedoMap     baseColorTexture                 albedoScale     baseColorFactor.rgb
+//   normalMap     normalTexture
+//   metallicMap   metallicRoughnessTexture (B)     metallicScale   metallicFactor
+//   roughnessMap  metallicRoughnessTexture (G)     roughnessScale  roughnessFactor
+//   aoMap         occlusionTexture (R)
+// The shader reads both factors from one texture with PbrPermutation::metallicRoughnessPacked.
+// Missing maps bind 1x1 defaults (white, flat normal). Images are decoded on the TextureDecodePool
+// with the current stbi flip state, glTF expects it off.
+//
+// Skipped: sparse accessors, morph targets, skins, primitives other than triangle lists, texture
+// coordinate sets other than 0 and sampler states (textures repeat with trilinear filtering).
+//
+// Usage:
+//   GltfModel helmet("res/models/helmet/DamagedHelmet.glb");
+//   PbrPermutation permutation;
+//   permutation.textured = true;
+//   permutation.metallicRoughnessPacked = true;
+//   helmet.Render(pbrShaders.Get(permutation), drawUniforms, model); // one DrawData per node instance
+class GltfModel
+{
+public:
+	// Texture units of the material maps
+	static constexpr int kAlbedoUnit = 0;
+	static constexpr int kNormalUnit = 1;
+	static constexpr int kMetallicUnit = 2;
+	static constexpr int kRoughnessUnit = 3;
+	static constexpr int kAoUnit = 4;
+
+	GltfModel() = delete;
+
+	// With _waitForTextures false the constructor returns before the textures have their pixels,
+	// they are uploaded by later TextureDecodePool::UploadReady() calls
+	explicit GltfModel(const std::string& _filePath, bool _waitForTextures = true)
+	{
+		loaded = Load(_filePath);
+		if (_waitForTextures)
+			TextureDecodePool::Get().Finish();
+	}
+
+	~GltfModel()
+	{
+		GLStateCache& state = GLStateCache::Get();
+		for (const Primitive& primitive : primitives) {
+			state.ForgetVertexArray(primitive.VAO);
+			glDeleteVertexArrays(1, &primitive.VAO);
+		}
+		for (unsigned int buffer : viewBuffers) {
+			if (buffer != 0)
+				glDeleteBuffers(1, &buffer);
+		}
+		for (unsigned int texture : managedTextures)
+			TextureManager::Get().Release(texture);
+		if (!ownedTextures.empty()) {
+			// Embedded images may still be queued (_waitForTextures false), finish them so no upload
+			// lands in a deleted or reused name
+			TextureDecodePool& decoder = TextureDecodePool::Get();
+			if (decoder.GetPendingCount() > 0)
+				decoder.Finish();
+			for (unsigned int texture : ownedTextures)
+				state.ForgetTexture(texture);
+			glDeleteTextures((GLsizei)ownedTextures.size(), ownedTextures.data());
+		}
+	}
+
+	GltfModel(const GltfModel&) = delete;
+	GltfModel& operator=(const GltfModel&) = delete;
+
+	// False when the file could not be read or parsed, the model then draws nothing
+	bool IsLoaded() const { return loaded; }
+
+	// Draws every node instance with the DrawData bound by the caller, node transforms are ignored
+	// (as Model does with the Assimp node tree)
+	void Render(Shader& _shader) { Draw(_shader, nullptr, glm::mat4(1.0f)); }
+
+	// Pushes DrawData(_model * node transform) with the material's metallic / roughness factors
+	// for every node instance, _drawUniforms needs GetDrawCount() slices per call
+	void Render(Shader& _shader, DrawUniformRing& _drawUniforms, const glm::mat4& _model)
+	{
+		Draw(_shader, &_drawUniforms, _model);
+	}
+
+	// Bounds of all node instances in model space, from the POSITION accessors' min / max
+	std::pair<glm::vec3, glm::vec3> CalculateAABB() const
+	{
+		glm::vec3 minPos(FLT_MAX), maxPos(-FLT_MAX);
+		for (const DrawItem& item : drawItems) {
+			const Primitive& primitive = primitives[item.primitive];
+			for (int corner = 0; corner < 8; corner++) {
+				glm::vec3 local((corner & 1) ? primitive.boundsMax.x : primitive.boundsMin.x,
+					(corner & 2) ? primitive.boundsMax.y : primitive.boundsMin.y,
+					(corner & 4) ? primitive.boundsMax.z : primitive.boundsMin.z);
+				glm::vec3 world = glm::vec3(item.transform * glm::vec4(local, 1.0f));
+				minPos = glm::min(minPos, world);
+				maxPos = glm::max(maxPos, world);
+			}
+		}
+		if (drawItems.empty())
+			minPos = maxPos = glm::vec3(0.0f);
+		return { minPos, maxPos };
+	}
+
+	size_t GetPrimitiveCount() const { return primitives.size(); }
+	size_t GetDrawCount() const { return drawItems.size(); }
+
+	// Vertices and triangles over all primitives, each counted once however many nodes use it
+	size_t GetVertexCount() const
+	{
+		size_t count = 0;
+		for (const Primitive& primitive : primitives)
+			count += primitive.vertexCount;
+		return count;
+	}
+
+	size_t GetTriangleCount() const
+	{
+		size_t count = 0;
+		for (const Primitive& primitive : primitives)
+			count += (size_t)primitive.count / 3;
+		return count;
+	}
+
+	// Bytes uploaded to GL buffers, the bufferViews the primitives read
+	size_t GetBufferBytes() const { return bufferBytes; }
+
+private:
+	enum MapSlot { kAlbedoMap, kNormalMap, kMetallicRoughnessMap, kAoMap, kMapCount };
+
+	struct Primitive
+	{
+		unsigned int VAO = 0;
+		GLenum indexType = 0; // 0: glDrawArrays
+		size_t indexOffset = 0;
+		GLsizei count = 0;    // indices, or vertices without indices
+		size_t vertexCount = 0;
+		int material = -1;
+		glm::vec3 boundsMin = glm::vec3(0.0f);
+		glm::vec3 boundsMax = glm::vec3(0.0f);
+	};
+
+	struct Material
+	{
+		unsigned int maps[kMapCount] = {};
+		glm::vec3 baseColorFactor = glm::vec3(1.0f);
+		float metallicFactor = 1.0f;
+		float roughnessFactor = 1.0f;
+	};
+
+	struct DrawItem
+	{
+		size_t primitive;
+		int material;
+		glm::mat4 transform;
+	};
+
+	// CPU view of a glTF buffer, valid while loading
+	struct BufferData
+	{
+		const char* data = nullptr;
+		size_t size = 0;
+	};
+
+	// Resolved accessor, offset is relative to the GL buffer of its bufferView
+	struct Accessor
+	{
+		int view = -1;
+		size_t offset = 0;
+		GLint components = 0;
+		GLenum componentType = 0;
+		GLboolean normalized = GL_FALSE;
+		GLsizei stride = 0;
+		size_t count = 0;
+	};
+
+	static constexpr uint32_t kGlbMagic = 0x46546C67; // "glTF"
+	static constexpr uint32_t kGlbJsonChunk = 0x4E4F534A;
+	static constexpr uint32_t kGlbBinChunk = 0x004E4942;
+
+	bool Load(const std::string& _filePath)
+	{
+		directory = _filePath.substr(0, _filePath.find_last_of('/'));
+
+		MappedFile file(_filePath);
+		if (!file.IsOpen()) {
+			std::cerr << "glTF: failed to open " << _filePath << "\n";
+			return false;
+		}
+
+		// .glb: 12-byte header, JSON chunk, optional BIN chunk. Anything else is read as .gltf JSON.
+		const char* json = file.Data();
+		size_t jsonLength = file.Size();
+		BufferData glbBin;
+		uint32_t magic = 0;
+		if (file.Size() >= 12)
+			std::memcpy(&magic, file.Data(), 4);
+		if (magic == kGlbMagic) {
+			uint32_t header[3];
+			std::memcpy(header, file.Data(), sizeof(header));
+			size_t length = std::min<size_t>(header[2], file.Size());
+			size_t offset = 12;
+			bool firstChunk = true;
+			while (offset + 8 <= length) {
+				uint32_t chunk[2];
+				std::memcpy(chunk, file.Data() + offset, sizeof(chunk));
+				offset += 8;
+				if (offset + chunk[0] > length)
+					break;
+				if (firstChunk && chunk[1] == kGlbJsonChunk) {
+					json = file.Data() + offset;
+					jsonLength = chunk[0];
+				}
+				else if (chunk[1] == kGlbBinChunk && !glbBin.data) {
+					glbBin.data = file.Data() + offset;
+					glbBin.size = chunk[0];
+				}
+				firstChunk = false;
+				offset += (chunk[0] + 3) & ~3u;
+			}
+			if (header[1] != 2 || json == file.Data()) {
+				std::cerr << "glTF: " << _filePath << " is not a version 2 .glb\n";
+				return false;
+			}
+		}
+
+		JsonValue document;
+		std::string error;
+		if (!JsonValue::Parse(json, jsonLength, document, &error)) {
+			std::cerr << "glTF: " << _filePath << ": " << error << "\n";
+			return false;
+		}
+
+		// Buffers: the .glb BIN chunk, mapped files or decoded data: URIs. The mappings only live
+		// until the views are uploaded.
+		std::vector<std::unique_ptr<MappedFile>> bufferFiles;
+		std::vector<std::vector<char>> embedded;
+		std::vector<BufferData> buffers(document["buffers"].Size());
+		for (size_t i = 0; i < buffers.size(); i++) {
+			const JsonValue& buffer = document["buffers"][i];
+			const std::string& uri = buffer["uri"].AsString();
+			if (uri.empty())
+				buffers[i] = glbBin;
+			else if (uri.compare(0, 5, "data:") == 0) {
+				embedded.push_back(DecodeDataUri(uri));
+				buffers[i] = { embedded.back().data(), embedded.back().size() };
+			}
+			else {
+				bufferFiles.push_back(std::make_unique<MappedFile>(directory + '/' + DecodeUri(uri)));
+				if (bufferFiles.back()->IsOpen())
+					buffers[i] = { bufferFiles.back()->Data(), bufferFiles.back()->Size() };
+			}
+			if (buffers[i].size < buffer["byteLength"].AsSize()) {
+				std::cerr << "glTF: buffer " << i << " of " << _filePath << " is missing or truncated\n";
+				buffers[i] = BufferData();
+			}
+		}
+
+		viewBuffers.assign(document["bufferViews"].Size(), 0);
+		textureIds.assign(document["textures"].Size(), 0);
+		textureResolved.assign(textureIds.size(), false);
+		CreateDefaultTextures();
+
+		for (const JsonValue& material : document["materials"].Elements())
+			materials.push_back(LoadMaterial(document, buffers, material));
+
+		std::vector<std::vector<size_t>> meshPrimitives;
+		for (const JsonValue& mesh : document["meshes"].Elements()) {
+			meshPrimitives.emplace_back();
+			for (const JsonValue& primitive : mesh["primitives"].Elements()) {
+				Primitive created;
+				if (CreatePrimitive(document, buffers, primitive, created)) {
+					meshPrimitives.back().push_back(primitives.size());
+					primitives.push_back(created);
+				}
+			}
+		}
+		GLStateCache::Get().BindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		// Node instances of the default scene, every mesh once when the file has no scene
+		const JsonValue& scenes = document["scenes"];
+		if (scenes.Size() > 0) {
+			const JsonValue& scene = scenes[document["scene"].AsSize(0)];
+			for (const JsonValue& root : scene["nodes"].Elements())
+				AddNode(document, meshPrimitives, root.AsSize(SIZE_MAX), glm::mat4(1.0f), 0);
+		}
+		else {
+			for (const std::vector<size_t>& mesh : meshPrimitives) {
+				for (size_t primitive : mesh)
+					drawItems.push_back({ primitive, primitives[primitive].material, glm::mat4(1.0f) });
+			}
+		}
+
+		// Consecutive draws with the same material skip the rebinds
+		std::stable_sort(drawItems.begin(), drawItems.end(), [](const DrawItem& a, const DrawItem& b) {
+			return a.material < b.material;
+		});
+		return true;
+	}
+
+	void AddNode(const JsonValue& _document, const std::vector<std::vector<size_t>>& _meshPrimitives,
+		size_t _node, const glm::mat4& _parent, int _depth)
+	{
+		const JsonValue& node = _document["nodes"][_node];
+		if (!node.IsObject() || _depth > 64) // cyclic or broken hierarchy
+			return;
+
+		glm::mat4 local(1.0f);
+		const JsonValue& matrix = node["matrix"];
+		if (matrix.Size() == 16) {
+			for (int i = 0; i < 16; i++)
+				glm::value_ptr(local)[i] = matrix[i].AsFloat(); // column-major, as glm
+		}
+		else {
+			const JsonValue& t = node["translation"];
+			const JsonValue& r = node["rotation"];
+			const JsonValue& s = node["scale"];
+			glm::quat rotation(r[3].AsFloat(1.0f), r[0].AsFloat(), r[1].AsFloat(), r[2].AsFloat()); // glTF stores xyzw
+			local = glm::translate(glm::mat4(1.0f), glm::vec3(t[0].AsFloat(), t[1].AsFloat(), t[2].AsFloat())) *
+				glm::mat4_cast(rotation) *
+				glm::scale(glm::mat4(1.0f), glm::vec3(s[0].AsFloat(1.0f), s[1].AsFloat(1.0f), s[2].AsFloat(1.0f)));
+		}
+		glm::mat4 world = _parent * local;
+
+		size_t mesh = node["mesh"].AsSize(SIZE_MAX);
+		if (mesh < _meshPrimitives.size()) {
+			for (size_t primitive : _meshPrimitives[mesh])
+				drawItems.push_back({ primitive, primitives[primitive].material, world });
+		}
+		for (const JsonValue& child : node["children"].Elements())
+			AddNode(_document, _meshPrimitives, child.AsSize(SIZE_MAX), world, _depth + 1);
+	}
+
+	static GLint ComponentCount(const std::string& _type)
+	{
+		if (_type == "SCALAR") return 1;
+		if (_type == "VEC2") return 2;
+		if (_type == "VEC3") return 3;
+		if (_type == "VEC4") return 4;
+		return 0; // matrices are not vertex attributes here
+	}
+
+	// glTF component types are the GL enums
+	static size_t ComponentSize(GLenum _type)
+	{
+		switch (_type) {
+		case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+		case GL_SHORT: case GL_UNSIGNED_SHORT: return 2;
+		case GL_UNSIGNED_INT: case GL_FLOAT: return 4;
+		default: return 0;
+		}
+	}
+
+	// Checks the accessor against its bufferView and buffer, uploads the view on first use
+	bool ResolveAccessor(const JsonValue& _document, const std::vector<BufferData>& _buffers, size_t _index, Accessor& _accessor)
+	{
+		const JsonValue& accessor = _document["accessors"][_index];
+		size_t view = accessor["bufferView"].AsSize(SIZE_MAX);
+		if (!accessor.IsObject() || accessor.Has("sparse") || view >= viewBuffers.size())
+			return false;
+
+		const JsonValue& bufferView = _document["bufferViews"][view];
+		size_t buffer = bufferView["buffer"].AsSize(SIZE_MAX);
+		size_t viewOffset = bufferView["byteOffset"].AsSize(0);
+		size_t viewLength = bufferView["byteLength"].AsSize(0);
+		if (buffer >= _buffers.size() || !_buffers[buffer].data || viewOffset + viewLength > _buffers[buffer].size)
+			return false;
+
+		_accessor.view = (int)view;
+		_accessor.offset = accessor["byteOffset"].AsSize(0);
+		_accessor.components = ComponentCount(accessor["type"].AsString());
+		_accessor.componentType = (GLenum)accessor["componentType"].AsInt();
+		_accessor.normalized = accessor["normalized"].AsBool() ? GL_TRUE : GL_FALSE;
+		_accessor.count = accessor["count"].AsSize(0);
+		size_t elementSize = _accessor.components * ComponentSize(_accessor.componentType);
+		size_t stride = bufferView["byteStride"].AsSize(0);
+		_accessor.stride = (GLsizei)stride; // 0: tightly packed, for GL too
+		if (elementSize == 0 || _accessor.count == 0 ||
+			_accessor.offset + (_accessor.count - 1) * (stride ? stride : elementSize) + elementSize > viewLength)
+			return false;
+
+		if (viewBuffers[view] == 0) {
+			// Straight from the mapping, no staging copy
+			glGenBuffers(1, &viewBuffers[view]);
+			glBindBuffer(GL_ARRAY_BUFFER, viewBuffers[view]);
+			glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)viewLength, _buffers[buffer].data + viewOffset, GL_STATIC_DRAW);
+			bufferBytes += viewLength;
+		}
+		return true;
+	}
+
+	bool CreatePrimitive(const JsonValue& _document, const std::vector<BufferData>& _buffers, const JsonValue& _primitive, Primitive& _created)
+	{
+		const JsonValue& attributes = _primitive["attributes"];
+		Accessor position;
+		if (_primitive["mode"].AsInt(4) != 4 || !attributes.Has("POSITION") ||
+			!ResolveAccessor(_document, _buffers, attributes["POSITION"].AsSize(SIZE_MAX), position)) {
+#ifdef _DEBUG
+			std::cerr << "glTF: skipped a primitive (not a triangle list or no valid POSITION)\n";
+#endif
+			return false;
+		}
+
+		Accessor indices;
+		bool indexed = _primitive.Has("indices");
+		if (indexed && (!ResolveAccessor(_document, _buffers, _primitive["indices"].AsSize(SIZE_MAX), indices) ||
+			indices.components != 1 || indices.stride != 0 || ComponentSize(indices.componentType) == 0 ||
+			indices.componentType == GL_BYTE || indices.componentType == GL_SHORT || indices.componentType == GL_FLOAT)) {
+#ifdef _DEBUG
+			std::cerr << "glTF: skipped a primitive with invalid indices\n";
+#endif
+			return false;
+		}
+
+		GLStateCache& state = GLStateCache::Get();
+		glGenVertexArrays(1, &_created.VAO);
+		state.BindVertexArray(_created.VAO);
+
+		static const char* const kAttributes[] = { "POSITION", "NORMAL", "TEXCOORD_0", "TANGENT" };
+		for (GLuint location = 0; location < 4; location++) {
+			Accessor attribute;
+			if (location == 0)
+				attribute = position;
+			else if (!attributes.Has(kAttributes[location]) ||
+				!ResolveAccessor(_document, _buffers, attributes[kAttributes[location]].AsSize(SIZE_MAX), attribute))
+				continue;
+			glBindBuffer(GL_ARRAY_BUFFER, viewBuffers[attribute.view]);
+			glEnableVertexAttribArray(location);
+			glVertexAttribPointer(location, attribute.components, attribute.componentType, attribute.normalized,
+				attribute.stride, reinterpret_cast<const void*>(attribute.offset));
+		}
+
+		_created.vertexCount = position.count;
+		if (indexed) {
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, viewBuffers[indices.view]); // VAO state
+			_created.indexType = indices.componentType;
+			_created.indexOffset = indices.offset;
+			_created.count = (GLsizei)indices.count;
+		}
+		else
+			_created.count = (GLsizei)position.count;
+
+		size_t material = _primitive["material"].AsSize(SIZE_MAX);
+		_created.material = material < materials.size() ? (int)material : -1;
+
+		const JsonValue& accessor = _document["accessors"][attributes["POSITION"].AsSize()];
+		for (int axis = 0; axis < 3; axis++) {
+			_created.boundsMin[axis] = accessor["min"][axis].AsFloat();
+			_created.boundsMax[axis] = accessor["max"][axis].AsFloat();
+		}
+		return true;
+	}
+
+	Material LoadMaterial(const JsonValue& _document, const std::vector<BufferData>& _buffers, const JsonValue& _material)
+	{
+		const JsonValue& pbr = _material["pbrMetallicRoughness"];
+		Material material = defaultMaterial;
+		const JsonValue& factor = pbr["baseColorFactor"];
+		material.baseColorFactor = glm::vec3(factor[0].AsFloat(1.0f), factor[1].AsFloat(1.0f), factor[2].AsFloat(1.0f));
+		material.metallicFactor = pbr["metallicFactor"].AsFloat(1.0f);
+		material.roughnessFactor = pbr["roughnessFactor"].AsFloat(1.0f);
+
+		// Base color is sRGB, its mips are averaged in linear light, normal maps are renormalized
+		auto map = [&](const JsonValue& _textureInfo, unsigned int _fallback, MipFilter _filter) {
+			unsigned int id = TextureFor(_document, _buffers, _textureInfo["index"].AsSize(SIZE_MAX), _filter);
+			return id != 0 ? id : _fallback;
+		};
+		material.maps[kAlbedoMap] = map(pbr["baseColorTexture"], whiteTexture, MipFilter::Srgb);
+		material.maps[kMetallicRoughnessMap] = map(pbr["metallicRoughnessTexture"], whiteTexture, MipFilter::Linear);
+		material.maps[kNormalMap] = map(_material["normalTexture"], flatNormalTexture, MipFilter::Normal);
+		material.maps[kAoMap] = map(_material["occlusionTexture"], whiteTexture, MipFilter::Linear);
+		return material;
+	}
+
+	// GL texture of a glTF texture, loaded once however many materials use it. Image files go
+	// through the TextureManager, embedded images (bufferView or data: URI) are decoded into
+	// textures the model owns.
+	unsigned int TextureFor(const JsonValue& _document, const std::vector<BufferData>& _buffers, size_t _texture, MipFilter _filter)
+	{
+		if (_texture >= textureIds.size())
+			return 0;
+		if (textureResolved[_texture])
+			return textureIds[_texture];
+		textureResolved[_texture] = true;
+
+		const JsonValue& image = _document["images"][_document["textures"][_texture]["source"].AsSize(SIZE_MAX)];
+		const std::string& uri = image["uri"].AsString();
+		std::vector<unsigned char> encoded;
+		if (!uri.empty() && uri.compare(0, 5, "data:") != 0) {
+			unsigned int id = TextureManager::Get().AcquireAsync(directory + '/' + DecodeUri(uri), _filter);
+			if (id != 0)
+				managedTextures.push_back(id);
+			return textureIds[_texture] = id;
+		}
+		if (!uri.empty()) {
+			std::vector<char> bytes = DecodeDataUri(uri);
+			encoded.assign(bytes.begin(), bytes.end());
+		}
+		else {
+			const JsonValue& bufferView = _document["bufferViews"][image["bufferView"].AsSize(SIZE_MAX)];
+			size_t buffer = bufferView["buffer"].AsSize(SIZE_MAX);
+			size_t offset = bufferView["byteOffset"].AsSize(0);
+			size_t length = bufferView["byteLength"].AsSize(0);
+			if (buffer < _buffers.size() && _buffers[buffer].data && offset + length <= _buffers[buffer].size)
+				encoded.assign(_buffers[buffer].data + offset, _buffers[buffer].data + offset + length);
+		}
+		if (encoded.empty())
+			return 0;
+
+		unsigned int id;
+		glGenTextures(1, &id);
+		ownedTextures.push_back(id);
+		TextureDecodePool::Get().Enqueue(id, directory + "/<embedded image " + std::to_string(_texture) + ">", std::move(encoded), _filter);
+		return textureIds[_texture] = id;
+	}
+
+	void CreateDefaultTextures()
+	{
+		static const unsigned char white[4] = { 255, 255, 255, 255 };
+		static const unsigned char flatNormal[4] = { 128, 128, 255, 255 };
+		glGenTextures(1, &whiteTexture);
+		UploadTexture2D(whiteTexture, 1, 1, 4, white);
+		glGenTextures(1, &flatNormalTexture);
+		UploadTexture2D(flatNormalTexture, 1, 1, 4, flatNormal);
+		ownedTextures.push_back(whiteTexture);
+		ownedTextures.push_back(flatNormalTexture);
+
+		for (unsigned int& map : defaultMaterial.maps)
+			map = whiteTexture;
+		defaultMaterial.maps[kNormalMap] = flatNormalTexture;
+	}
+
+	void Draw(Shader& _shader, DrawUniformRing* _drawUniforms, const glm::mat4& _model)
+	{
+		GLStateCache& state = GLStateCache::Get();
+		_shader.SetInt("albedoMap", kAlbedoUnit);
+		_shader.SetInt("normalMap", kNormalUnit);
+		_shader.SetInt("metallicMap", kMetallicUnit);
+		_shader.SetInt("roughnessMap", kRoughnessUnit);
+		_shader.SetInt("aoMap", kAoUnit);
+		const GLint albedoScale = _shader.GetUniformLocation("albedoScale");
+		const GLint metallicScale = _shader.GetUniformLocation("metallicScale");
+		const GLint roughnessScale = _shader.GetUniformLocation("roughnessScale");
+
+		int boundMaterial = INT_MIN;
+		for (const DrawItem& item : drawItems) {
+			const Primitive& primitive = primitives[item.primitive];
+			const Material& material = item.material >= 0 ? materials[item.material] : defaultMaterial;
+			if (_drawUniforms) {
+				DrawData data(_model * item.transform);
+				data.material = glm::vec4(material.metallicFactor, material.roughnessFactor, 0.0f, 0.0f);
+				_drawUniforms->Push(data);
+			}
+			if (item.material != boundMaterial) {
+				state.BindTexture(kAlbedoUnit, GL_TEXTURE_2D, material.maps[kAlbedoMap]);
+				state.BindTexture(kNormalUnit, GL_TEXTURE_2D, material.maps[kNormalMap]);
+				state.BindTexture(kMetallicUnit, GL_TEXTURE_2D, material.maps[kMetallicRoughnessMap]);
+				state.BindTexture(kRoughnessUnit, GL_TEXTURE_2D, material.maps[kMetallicRoughnessMap]);
+				state.BindTexture(kAoUnit, GL_TEXTURE_2D, material.maps[kAoMap]);
+				if (albedoScale != -1) _shader.SetVec3(albedoScale, material.baseColorFactor);
+				if (metallicScale != -1) _shader.SetFloat(metallicScale, material.metallicFactor);
+				if (roughnessScale != -1) _shader.SetFloat(roughnessScale, material.roughnessFactor);
+				boundMaterial = item.material;
+			}
+
+			state.BindVertexArray(primitive.VAO);
+			if (primitive.indexType != 0)
+				glDrawElements(GL_TRIANGLES, primitive.count, primitive.indexType, reinterpret_cast<const void*>(primitive.indexOffset));
+			else
+				glDrawArrays(GL_TRIANGLES, 0, primitive.count);
+		}
+	}
+
+	// Relative URIs may be percent-encoded
+	static std::string DecodeUri(const std::string& _uri)
+	{
+		std::string decoded;
+		for (size_t i = 0; i < _uri.size(); i++) {
+			if (_uri[i] == '%' && i + 2 < _uri.size() && std::isxdigit((unsigned char)_uri[i + 1]) && std::isxdigit((unsigned char)_uri[i + 2])) {
+				decoded += (char)std::stoi(_uri.substr(i + 1, 2), nullptr, 16);
+				i += 2;
+			}
+			else
+				decoded += _uri[i];
+		}
+		return decoded;
+	}
+
+	// Payload of a base64 "data:...;base64,..." URI, empty if it is not base64
+	static std::vector<char> DecodeDataUri(const std::string& _uri)
+	{
+		std::vector<char> bytes;
+		size_t comma = _uri.find(',');
+		if (comma == std::string::npos || _uri.rfind(";base64", comma) == std::string::npos)
+			return bytes;
+
+		bytes.reserve((_uri.size() - comma) * 3 / 4);
+		uint32_t bits = 0;
+		int bitCount = 0;
+		for (size_t i = comma + 1; i < _uri.size(); i++) {
+			char c = _uri[i];
+			int value;
+			if (c >= 'A' && c <= 'Z') value = c - 'A';
+			else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+			else if (c >= '0' && c <= '9') value = c - '0' + 52;
+			else if (c == '+') value = 62;
+			else if (c == '/') value = 63;
+			else break; // '=' padding
+			bits = (bits << 6) | (uint32_t)value;
+			bitCount += 6;
+			if (bitCount >= 8) {
+				bitCount -= 8;
+				bytes.push_back((char)((bits >> bitCount) & 0xFF));
+			}
+		}
+		return bytes;
+	}
+
+private:
+	std::string directory;
+	bool loaded = false;
+
+	std::vector<Primitive> primitives;
+	std::vector<Material> materials;
+	Material defaultMaterial; // primitives without a material
+	std::vector<DrawItem> drawItems; // sorted by material
+
+	std::vector<unsigned int> viewBuffers; // GL buffer per bufferView, 0 when no primitive reads it
+	size_t bufferBytes = 0;
+
+	std::vector<unsigned int> textureIds; // per glTF texture, 0 when it failed to load
+	std::vector<bool> textureResolved;
+	std::vector<unsigned int> managedTextures; // TextureManager references
+	std::vector<unsigned int> ownedTextures;   // embedded images and the defaults
+	unsigned int whiteTexture = 0;
+	unsigned int flatNormalTexture = 0;
+};
@@ -20,6 +20,8 @@
 #include <GLFW/glfw3.h>
 
 #include "camera.h"
+#include "draw_uniforms.h"
+#include "frame_uniforms.h"
 #include "geometry_renderers.h"
 #include "model.h"
 #include "scene_manager.h"
@@ -74,6 +76,11 @@ int main()
 
 	// shader configs
 	Shader shader("res/shaders/debug_light.vs", "res/shaders/debug_light.fs");
+	FrameUniformBuffer frameUniforms; // projection and view
+	frameUniforms.Attach(shader);
+	DrawUniformRing drawUniforms(1); // model
+	drawUniforms.Attach(shader);
+	FrameData frameData;
 
 	// Imgui configs
     // ----------------
@@ -98,12 +105,15 @@ int main()
 		glm::mat4 view = camera->GetViewMatrix();
 		glm::mat4 model = glm::mat4(1.0f);
 		model = glm::scale(model, glm::vec3(0.5f));
-		shader.SetMat4("projection", projection);
-		shader.SetMat4("view", view);
-		shader.SetMat4("model", model);
+		frameData.projection = projection;
+		frameData.view = view;
+		frameUniforms.Update(frameData);
+		drawUniforms.BeginFrame();
+		drawUniforms.Push(DrawData(model));
 		//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 		sphere.Render();
 		//glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		drawUniforms.EndFrame();
 
 		// ImGui code
 		// ----------
@@ -21,9 +21,15 @@
 #include <GLFW/glfw3.h>
 
 #include "camera.h"
+#include "draw_uniforms.h"
+#include "frame_uniforms.h"
 #include "geometry_renderers.h"
+#include "gl_state_cache.h"
 #include "model.h"
+#include "render_queue.h"
 #include "shader.h"
+#include "shader_permutations.h"
+#include "texture_manager.h"
 #include "timer.h"
 
 #include "imgui/imgui.h"
@@ -36,7 +42,6 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void ProcessInput(GLFWwindow* window);
-unsigned int LoadTexture(const std::string& path, bool isHDR = false);
 void CheckFramebufferStatus(unsigned int fbo, const std::string& framebufferName);
 
 // Scene settings
@@ -79,7 +84,7 @@ int main()
 
 		// OpenGL global settings
 		// ----------------------
-		glEnable(GL_DEPTH_TEST);
+		GLStateCache::Get().Enable(GL_DEPTH_TEST);
 		glDepthFunc(GL_LEQUAL); // set depth function to less than AND equal for skybox depth trick.
 	}
 	catch (const std::runtime_error& e) {
@@ -104,24 +109,31 @@ int main()
 	yzh::Sphere sphere(64, 64);
 
 	// Shader(s) build & compile
+	// Submitted asynchronously: the driver compiles them while textures load and the IBL maps bake,
+	// each program is only waited for when it is first bound.
 	// -------------------------
-	Shader pbr_ibl_diffuse_textured("res/shaders/pbr_ibl.vs", "res/shaders/pbr_ibl_diffuse_textured.fs"); // used for final rendering
-	Shader pbr_ibl_diffuse("res/shaders/pbr_ibl.vs", "res/shaders/pbr_ibl_diffuse.fs");
+	Shader::SetAsyncBuild(true);
+	ShaderPermutationTable pbrShaders("res/shaders/pbr_ibl.vert", "res/shaders/pbr_ibl_diffuse.fs"); // variants of the PBR shader
+	PbrPermutation texturedPermutation; // 4 lights, material maps, normal map, diffuse IBL
+	texturedPermutation.textured = true;
+	texturedPermutation.normalSource = NormalSource::VertexTangent; // the yzh shapes carry tangents
+	PbrPermutation constantPermutation; // 4 lights, material from uniforms, diffuse IBL
+	Shader& pbr_ibl_diffuse_textured = pbrShaders.Get(texturedPermutation); // used for final rendering
+	Shader& pbr_ibl_diffuse = pbrShaders.Get(constantPermutation);
 	Shader equirectangular_to_cubemap_shader("res/shaders/cubemap.vs", "res/shaders/equirectangular_to_cubemap.fs"); // used for converting to cubemap
 	Shader irradiance_shader("res/shaders/cubemap.vs", "res/shaders/irradiance_convolution.fs"); // used for generating irradiance map
 	Shader background_shader("res/shaders/background.vs", "res/shaders/background.fs"); // used for rendering background
 	Shader debug_light_shader("res/shaders/debug_light.vs", "res/shaders/debug_light.fs"); // used for rendering lighting sources
-
-	background_shader.Bind();
-	background_shader.SetInt("environmentMap", 0);
+	Shader::SetAsyncBuild(false);
 
 	// load PBR material textures
     // --------------------------
-	unsigned int albedo = LoadTexture("res/textures/pbr/rusted_iron/albedo.png");
-	unsigned int normal = LoadTexture("res/textures/pbr/rusted_iron/normal.png");
-	unsigned int metallic = LoadTexture("res/textures/pbr/rusted_iron/metallic.png");
-	unsigned int roughness = LoadTexture("res/textures/pbr/rusted_iron/roughness.png");
-	unsigned int ao = LoadTexture("res/textures/pbr/rusted_iron/ao.png");
+	TextureManager& textures = TextureManager::Get();
+	unsigned int albedo = textures.Acquire("res/textures/pbr/rusted_iron/albedo.png");
+	unsigned int normal = textures.Acquire("res/textures/pbr/rusted_iron/normal.png");
+	unsigned int metallic = textures.Acquire("res/textures/pbr/rusted_iron/metallic.png");
+	unsigned int roughness = textures.Acquire("res/textures/pbr/rusted_iron/roughness.png");
+	unsigned int ao = textures.Acquire("res/textures/pbr/rusted_iron/ao.png");
 
 	// Scaling factors (control them in UI panal)
 	float metallicScale = 1.0f; // Scale factor for metallic
@@ -146,12 +158,15 @@ int main()
 	int nrColumns = 7;
 	float spacing = 5.0f;
 
+	// All program, VAO, texture, framebuffer and viewport changes below go through the state cache
+	GLStateCache& state = GLStateCache::Get();
+
 	// Set up framebuffer for generating environment cube map
 	// ------------------------------------------------------
 	unsigned int captureFBO, captureRBO;
 	glGenFramebuffers(1, &captureFBO);
 	glGenRenderbuffers(1, &captureRBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+	state.BindFramebuffer(captureFBO);
 	glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
 	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512); // 512 * 512 used for environmentCubemap
 	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
@@ -164,7 +179,7 @@ int main()
 	unsigned int hdrTexture;
 	if (data) {
 		glGenTextures(1, &hdrTexture);
-		glBindTexture(GL_TEXTURE_2D, hdrTexture);
+		state.BindTexture(GL_TEXTURE_2D, hdrTexture);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data); // note how we specify the texture's data value to be float
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -181,7 +196,7 @@ int main()
 	// -----------------------------------------------------
 	unsigned int environmentCubemap;
 	glGenTextures(1, &environmentCubemap);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, environmentCubemap); // Notice we use GL_TEXTURE_CUBE_MAP
+	state.BindTexture(GL_TEXTURE_CUBE_MAP, environmentCubemap); // Notice we use GL_TEXTURE_CUBE_MAP
 	for (int i = 0; i < 6; i++) {
 		// Notice we use GL_RGB16F, GL_RGB, GL_FLOAT, which are all the same as hdrTexture
 		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 512, 512, 0, GL_RGB, GL_FLOAT, nullptr);
@@ -208,11 +223,10 @@ int main()
 	equirectangular_to_cubemap_shader.Bind();
 	equirectangular_to_cubemap_shader.SetInt("equirectangularMap", 0);
 	equirectangular_to_cubemap_shader.SetMat4("projection", captureProjection);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, hdrTexture);
+	state.BindTexture(0, GL_TEXTURE_2D, hdrTexture);
 
-	glViewport(0, 0, 512, 512);
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+	state.Viewport(0, 0, 512, 512);
+	state.BindFramebuffer(captureFBO);
 	for (int i = 0; i < 6; i++) {
 		equirectangular_to_cubemap_shader.SetMat4("view", captureViews[i]);
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, environmentCubemap, 0);
@@ -223,13 +237,13 @@ int main()
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		cube.Render(); // renders 1 * 1
 	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	state.BindFramebuffer(0);
 
 	// Generating an irradiance cubemap, and re-scale capture FBO to irradiance scale
 	// ------------------------------------------------------------------------------
 	unsigned int irradianceMap;
 	glGenTextures(1, &irradianceMap);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
+	state.BindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
 	for (int i = 0; i < 6; ++i) {
 		// Notice we change the size from 512 * 512 to 32 * 32
 		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 32, 32, 0, GL_RGB, GL_FLOAT, nullptr);
@@ -240,7 +254,7 @@ int main()
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+	state.BindFramebuffer(captureFBO);
 	glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
 	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32); // Change the size of renderbuffer accordingly
 
@@ -249,11 +263,10 @@ int main()
 	irradiance_shader.Bind();
 	irradiance_shader.SetInt("environmentMap", 0);
 	irradiance_shader.SetMat4("projection", captureProjection);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, environmentCubemap);
+	state.BindTexture(0, GL_TEXTURE_CUBE_MAP, environmentCubemap);
 
-	glViewport(0, 0, 32, 32); // Change the size of viewport accordingly
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+	state.Viewport(0, 0, 32, 32); // Change the size of viewport accordingly
+	state.BindFramebuffer(captureFBO);
 	for (int i = 0; i < 6; ++i) {
 		irradiance_shader.SetMat4("view", captureViews[i]);
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, irradianceMap, 0);
@@ -264,12 +277,41 @@ int main()
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		cube.Render(); // renders 1 * 1
 	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	state.BindFramebuffer(0);
 	
+	// Remaining programs finish compiling here at the latest
+	// ------------------------------------------------------
+	background_shader.Bind();
+	background_shader.SetInt("environmentMap", 0);
+
+	// Camera and lights of every program come from one per-frame uniform buffer
+	FrameUniformBuffer frameUniforms;
+	frameUniforms.Attach(pbr_ibl_diffuse_textured);
+	frameUniforms.Attach(pbr_ibl_diffuse);
+	frameUniforms.Attach(debug_light_shader);
+	frameUniforms.Attach(background_shader);
+	FrameData frameData;
+	unsigned int uniformCallsPerFrame = 0, frameDataUpdatesPerFrame = 0;
+
+	// Per-draw model/normal matrix and material come from a fenced ring buffer, one slice per draw
+	DrawUniformRing drawUniforms(nrRows * nrColumns + (unsigned int)lightPositions.size());
+	drawUniforms.Attach(pbr_ibl_diffuse_textured);
+	drawUniforms.Attach(pbr_ibl_diffuse);
+	drawUniforms.Attach(debug_light_shader);
+	float averageDrawDataMicrosecondsPerDraw = 0.0f;
+
+	// Sphere grid, light markers and skybox go through a sorted render queue
+	RenderQueue renderQueue;
+	TextureSet irradianceTextures{ 1, { { 0, GL_TEXTURE_CUBE_MAP, irradianceMap } } };
+	TextureSet environmentTextures{ 2, { { 0, GL_TEXTURE_CUBE_MAP, environmentCubemap } } };
+	//TextureSet environmentTextures{ 2, { { 0, GL_TEXTURE_CUBE_MAP, irradianceMap } } }; // display irradiance map
+	constexpr uint32_t kOpaquePass = 0, kSkyboxPass = 1;
+	constexpr float kFarPlane = 100.0f;
+
 	// config the viewport to the original framebuffer's screen dimensions before rendering
 	int scrWidth, scrHeight;
 	glfwGetFramebufferSize(window, &scrWidth, &scrHeight);
-	glViewport(0, 0, scrWidth, scrHeight);
+	state.Viewport(0, 0, scrWidth, scrHeight);
 	
 	// Imgui settings
 	// --------------
@@ -278,6 +320,7 @@ int main()
 	unsigned char pixel[4];
 
 	timer.stop(); // Timer stops
+	ProgramBinaryCache::Get().PrintStats(); // per program binary cache hits and misses of the init above
 
 	// Render loop
 	// -----------
@@ -299,6 +342,21 @@ int main()
 		glm::mat4 projection = glm::perspective(glm::radians(camera.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
 		glm::mat4 view = camera.GetViewMatrix();
 		glm::mat4 model = glm::mat4(1.0f);
+
+		// Per-frame uniforms, one buffer update shared by all programs
+		Shader::ResetUniformCallCount();
+		state.ResetStats();
+		frameUniforms.ResetUpdateCount();
+		drawUniforms.BeginFrame();
+		frameData.projection = projection;
+		frameData.view = view;
+		frameData.viewPos = glm::vec4(camera.position, 1.0f);
+		for (size_t i = 0; i < lightPositions.size(); ++i) {
+			frameData.lightPositions[i] = glm::vec4(lightPositions[i], 1.0f);
+			frameData.lightColors[i] = glm::vec4(lightColors[i], 0.0f);
+		}
+		frameUniforms.Update(frameData);
+
 		pbr_ibl_diffuse_textured.Bind();
 		
 		// texture units uniforms
@@ -308,106 +366,70 @@ int main()
 		pbr_ibl_diffuse_textured.SetInt("roughnessMap", 3);
 		pbr_ibl_diffuse_textured.SetInt("aoMap", 4);
 		pbr_ibl_diffuse_textured.SetInt("irradianceMap", 5);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, albedo);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, normal);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, metallic);
-		glActiveTexture(GL_TEXTURE3);
-		glBindTexture(GL_TEXTURE_2D, roughness);
-		glActiveTexture(GL_TEXTURE4);
-		glBindTexture(GL_TEXTURE_2D, ao);
-		glActiveTexture(GL_TEXTURE5);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
-
-		// Lighting uniforms
-		for (int i = 0; i < lightPositions.size(); ++i) {
-			std::string posName = "lightPositions[" + std::to_string(i) + "]";
-			std::string colName = "lightColors[" + std::to_string(i) + "]";
-			pbr_ibl_diffuse_textured.SetVec3(posName, lightPositions[i]);
-			pbr_ibl_diffuse_textured.SetVec3(colName, lightColors[i]);
-		}
-		pbr_ibl_diffuse_textured.SetMat4("projection", projection);
-		pbr_ibl_diffuse_textured.SetMat4("view", view);
-		pbr_ibl_diffuse_textured.SetVec3("viewPos", camera.position);
+		state.BindTexture(0, GL_TEXTURE_2D, albedo);
+		state.BindTexture(1, GL_TEXTURE_2D, normal);
+		state.BindTexture(2, GL_TEXTURE_2D, metallic);
+		state.BindTexture(3, GL_TEXTURE_2D, roughness);
+		state.BindTexture(4, GL_TEXTURE_2D, ao);
+		state.BindTexture(5, GL_TEXTURE_CUBE_MAP, irradianceMap);
 
 		// pbr scaling factors
 		pbr_ibl_diffuse_textured.SetFloat("roughnessScale", roughnessScale);
 		pbr_ibl_diffuse_textured.SetFloat("metallicScale", metallicScale);
 		pbr_ibl_diffuse_textured.SetVec3("albedoScale", albedoScale);
 
-		for (int row = 0; row < nrRows; row++) {
-			for (int col = 0; col < nrColumns; col++) {
-				// Clamp the roughness to 0.05 - 1.0 as perfectly smooth surfaces (roughness of 0.0) tend to look a bit on direct lighting.
-				model = glm::mat4(1.0f);
-				model = glm::translate(model, glm::vec3((col - (nrColumns / 2)) * spacing, (row - (nrRows / 2)) * spacing, 0.0f));
-				model = glm::scale(model, glm::vec3(0.5f));
-
-				pbr_ibl_diffuse_textured.SetMat4("model", model);
-				pbr_ibl_diffuse_textured.SetMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
-				//sphere.Render();
-			}
-		}
-
 		// Render pbr sphere without texture, changing metallic and roughness by row and col
 		// ---------------------------------------------------------------------------------
 		pbr_ibl_diffuse.Bind();
-		pbr_ibl_diffuse.SetMat4("projection", projection);
-		pbr_ibl_diffuse.SetMat4("view", view);
-		pbr_ibl_diffuse.SetVec3("viewPos", camera.position);
 		pbr_ibl_diffuse.SetVec3("albedo", 0.5f, 0.0f, 0.0f);
 		pbr_ibl_diffuse.SetFloat("ao", 1.0f);
 
-		// lighting uniforms
-		for (int i = 0; i < lightPositions.size(); ++i) {
-			std::string posName = "lightPositions[" + std::to_string(i) + "]";
-			std::string colName = "lightColors[" + std::to_string(i) + "]";
-			pbr_ibl_diffuse.SetVec3(posName, lightPositions[i]);
-			pbr_ibl_diffuse.SetVec3(colName, lightColors[i]);
-		}
-
 		pbr_ibl_diffuse.SetInt("irradianceMap", 0);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
 
+		// Per-draw data, timed to show the cost of writing one ring buffer slice
+		Timer::Duration drawDataTime(0.0f);
 		model = glm::mat4(1.0f);
 		for (int row = 0; row < nrRows; ++row) {
-			pbr_ibl_diffuse.SetFloat("metallic", (float)row / (float)nrRows);
+			float rowMetallic = (float)row / (float)nrRows;
 			for (int col = 0; col < nrColumns; ++col) {
-				pbr_ibl_diffuse.SetFloat("roughness", glm::clamp((float)col / (float)nrColumns, 0.05f, 1.0f));
 				model = glm::mat4(1.0f);
 				model = glm::translate(model, glm::vec3((float)(col - (nrColumns / 2)) * spacing, (float)(row - (nrRows / 2)) * spacing, -2.0f));
-				pbr_ibl_diffuse.SetMat4("model", model);
-				pbr_ibl_diffuse.SetMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
-				sphere.Render();
+				DrawData drawData(model);
+				drawData.material = glm::vec4(rowMetallic, glm::clamp((float)col / (float)nrColumns, 0.05f, 1.0f), 0.0f, 0.0f);
+
+				auto drawDataStart = Timer::Clock::now();
+				GLintptr drawDataOffset = drawUniforms.Write(drawData);
+				drawDataTime += Timer::Clock::now() - drawDataStart;
+
+				float viewDepth = -(view * model[3]).z;
+				renderQueue.Submit(kOpaquePass, pbr_ibl_diffuse, sphere, &irradianceTextures,
+					RenderQueue::DepthBucket(viewDepth, kFarPlane), drawDataOffset);
 			}
 		}
+		float drawDataMicrosecondsPerDraw = drawDataTime.count() * 1e6f / (float)(nrRows * nrColumns);
+		averageDrawDataMicrosecondsPerDraw = glm::mix(averageDrawDataMicrosecondsPerDraw, drawDataMicrosecondsPerDraw, 0.05f);
 
 		// render light source
 		// -------------------
-		debug_light_shader.Bind();
-		debug_light_shader.SetMat4("projection", projection);
-		debug_light_shader.SetMat4("view", view);
-
-		for (int i = 0; i < lightPositions.size(); ++i) {
+		for (size_t i = 0; i < lightPositions.size(); ++i) {
 			model = glm::mat4(1.0f);
 			model = glm::translate(model, lightPositions[i]);
 			model = glm::scale(model, glm::vec3(0.5f));
-			debug_light_shader.SetMat4("model", model);
-			sphere.Render();
+			float viewDepth = -(view * model[3]).z;
+			renderQueue.Submit(kOpaquePass, debug_light_shader, sphere, nullptr,
+				RenderQueue::DepthBucket(viewDepth, kFarPlane), drawUniforms.Write(DrawData(model)));
 		}
 
 		// render skybox (render as last to prevent overdraw)
 		// notice that we explicitly set depth value to 1.0f
 		// -------------------------------------------------
-		background_shader.Bind();
-		background_shader.SetMat4("view", view);
-		background_shader.SetMat4("projection", projection);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, environmentCubemap);
-		//glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap); // display irradiance map
-		cube.Render();
+		renderQueue.Submit(kSkyboxPass, background_shader, cube, &environmentTextures, 0);
+
+		renderQueue.Execute(&drawUniforms);
+		drawUniforms.EndFrame();
+		uniformCallsPerFrame = Shader::GetUniformCallCount();
+		frameDataUpdatesPerFrame = frameUniforms.GetUpdateCount();
+		GLStateCache::Stats stateChangesPerFrame = state.GetStats();
 
 		// ImGui code
 		// ----------
@@ -439,6 +461,21 @@ int main()
 		if (ImGui::SliderFloat("Mouse Sensitivity", &newSensitivity, 0.01f, 1.0f)) 
 			camera.SetMouseSensitivity(newSensitivity); 
 
+		// Uniform upload statistics
+		ImGui::Text("Per-draw data (%s): %.3f us/draw", drawUniforms.IsPersistent() ? "persistent map" : "map range", averageDrawDataMicrosecondsPerDraw);
+		ImGui::Text("Ring slices: %u/frame, fence stalls: %u", drawUniforms.GetDrawsLastFrame(), drawUniforms.GetStallCount());
+		ImGui::Text("Uniform calls: %u/frame, FrameData updates: %u/frame", uniformCallsPerFrame, frameDataUpdatesPerFrame);
+		ImGui::Text("Uniform calls replaced by FrameData: %u/frame", frameUniforms.GetReplacedUniformCalls());
+		ImGui::Text("GL state changes: %u issued, %u skipped /frame", stateChangesPerFrame.issued, stateChangesPerFrame.skipped);
+		const RenderQueue::Stats& queueStats = renderQueue.GetStats();
+		ImGui::Text("Render queue: %u draws, program switches %u (unsorted %u), texture switches %u (unsorted %u)",
+			queueStats.draws, queueStats.programSwitches, queueStats.unsortedProgramSwitches,
+			queueStats.textureSwitches, queueStats.unsortedTextureSwitches);
+		const TextureManager::Stats& textureStats = textures.GetStats();
+		ImGui::Text("Textures: %zu resident (%zu unreferenced), %.1f MB, hit rate %.0f%%, %u evictions",
+			textureStats.residentCount, textureStats.unreferencedCount, textureStats.residentBytes / (1024.0f * 1024.0f),
+			textures.GetHitRate() * 100.0f, textureStats.evictions);
+
 		ImGui::End();
 
 		// The second UI panal
@@ -488,7 +525,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
 	// make sure the viewport matches the new window dimensions; note that SCR_WIDTH and 
 	// SCR_HEIGHT will be significantly larger than specified on retina displays.
-	glViewport(0, 0, width, height);
+	GLStateCache::Get().Viewport(0, 0, width, height);
 	SCR_WIDTH = width;
 	SCR_HEIGHT = height;
 }
@@ -544,63 +581,9 @@ void ProcessInput(GLFWwindow* window)
 		camera.ProcessKeyboard(RIGHT, deltaTime);
 }
 
-// Utility function for loading a 2D texture from file
-// Loading HDR texture when isHDR is true
-unsigned int LoadTexture(const std::string& path, bool isHDR) 
-{
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-
-	int width, height, nrComponents;
-	void* data;
-
-	// Using stbi_load or stbi_loadf for different texture type
-	if (!isHDR) {
-		data = stbi_load(path.c_str(), &width, &height, &nrComponents, 0);
-	}
-	else {
-		stbi_set_flip_vertically_on_load(true);
-		data = stbi_loadf(path.c_str(), &width, &height, &nrComponents, 0);
-	}
-
-	if (data) {
-		GLenum format;
-		GLenum dataType = (isHDR) ? GL_FLOAT : GL_UNSIGNED_BYTE; // Set GL_FLOAT or GL_UNSIGNED_BYTE for different texture data type
-		GLint internalFormat; // Using 16-bit float format for HDR, otherwise internalFormat equals to format
-
-		if (nrComponents == 1) format = internalFormat = GL_RED;
-		else if (nrComponents == 3) format = internalFormat = GL_RGB;
-		else if (nrComponents == 4) format = internalFormat = GL_RGBA;
-		else std::cerr << "Invalid texture format: Unsupported number of components!\n";
-
-		if (isHDR) internalFormat = GL_RGB16F; 
-		
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, dataType, data);
-		if (!isHDR) 
-			glGenerateMipmap(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		if (!isHDR) 
-			stbi_image_free(data);
-		else 
-			stbi_image_free((float*)data);
-	}
-	else {
-		std::cerr << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-		return -1;
-	}
-
-	return textureID;
-}
-
 void CheckFramebufferStatus(unsigned int fbo, const std::string& framebufferName) 
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	GLStateCache::Get().BindFramebuffer(fbo);
 	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
 	if (status != GL_FRAMEBUFFER_COMPLETE) {
 		std::cerr << "Framebuffer (" << framebufferName << ") with ID (" << fbo << ") is not complete! Error code: " << status << std::endl;
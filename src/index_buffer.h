@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+// Meshes with at most this many vertices are drawn with 16-bit indices
+constexpr size_t kMaxShortIndexVertices = 65536;
+
+// Narrowest index type that can address _vertexCount vertices
+inline GLenum IndexTypeFor(size_t _vertexCount)
+{
+	return _vertexCount <= kMaxShortIndexVertices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+inline size_t IndexTypeSize(GLenum _type)
+{
+	return _type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+// Fills the bound GL_ELEMENT_ARRAY_BUFFER with _indices converted to _type, followed by
+// _moreCount indices from _moreIndices (e.g. the LOD levels) without joining them on the CPU
+inline void UploadIndices(GLenum _type, const unsigned int* _indices, size_t _count,
+	const unsigned int* _moreIndices = nullptr, size_t _moreCount = 0)
+{
+	if (_type != GL_UNSIGNED_SHORT) {
+		if (_moreCount == 0) {
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, _count * sizeof(uint32_t), _indices, GL_STATIC_DRAW);
+			return;
+		}
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, (_count + _moreCount) * sizeof(uint32_t), nullptr, GL_STATIC_DRAW);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, _count * sizeof(uint32_t), _indices);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, _count * sizeof(uint32_t), _moreCount * sizeof(uint32_t), _moreIndices);
+		return;
+	}
+
+	std::vector<uint16_t> shortIndices;
+	shortIndices.reserve(_count + _moreCount);
+	shortIndices.insert(shortIndices.end(), _indices, _indices + _count);
+	if (_moreCount > 0)
+		shortIndices.insert(shortIndices.end(), _moreIndices, _moreIndices + _moreCount);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(uint16_t), shortIndices.data(), GL_STATIC_DRAW);
+}
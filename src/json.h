@@ -0,0 +1,327 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Read-only JSON document tree, enough for asset manifests such as glTF. Objects keep their
+// members in file order and are searched linearly, missing members and out of range elements
+// read as a shared null value, so lookups chain without checks.
+//
+// Usage:
+//   JsonValue document;
+//   std::string error;
+//   if (!JsonValue::Parse(text.data(), text.size(), document, &error)) { ... }
+//   int count = document["accessors"][0]["count"].AsInt();
+//   for (const JsonValue& node : document["nodes"].Elements()) { ... }
+class JsonValue
+{
+public:
+	enum class Type : uint8_t
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	using Member = std::pair<std::string, JsonValue>;
+
+	Type GetType() const { return type; }
+	bool IsNull() const { return type == Type::Null; }
+	bool IsNumber() const { return type == Type::Number; }
+	bool IsString() const { return type == Type::String; }
+	bool IsArray() const { return type == Type::Array; }
+	bool IsObject() const { return type == Type::Object; }
+
+	bool AsBool(bool _fallback = false) const { return type == Type::Bool ? boolean : _fallback; }
+	double AsNumber(double _fallback = 0.0) const { return type == Type::Number ? number : _fallback; }
+	float AsFloat(float _fallback = 0.0f) const { return type == Type::Number ? (float)number : _fallback; }
+	int AsInt(int _fallback = 0) const { return type == Type::Number ? (int)number : _fallback; }
+	size_t AsSize(size_t _fallback = 0) const { return type == Type::Number && number >= 0.0 ? (size_t)number : _fallback; }
+	const std::string& AsString() const { return type == Type::String ? string : Null().string; }
+
+	// Elements of an array, members of an object, 0 otherwise
+	size_t Size() const { return type == Type::Array ? elements.size() : type == Type::Object ? members.size() : 0; }
+	const std::vector<JsonValue>& Elements() const { return elements; }
+	const std::vector<Member>& Members() const { return members; }
+
+	const JsonValue& operator[](size_t _index) const
+	{
+		return type == Type::Array && _index < elements.size() ? elements[_index] : Null();
+	}
+
+	const JsonValue& operator[](int _index) const { return _index >= 0 ? (*this)[(size_t)_index] : Null(); }
+
+	const JsonValue& operator[](const char* _name) const
+	{
+		for (const Member& member : members) {
+			if (member.first == _name)
+				return member.second;
+		}
+		return Null();
+	}
+
+	bool Has(const char* _name) const { return !(*this)[_name].IsNull(); }
+
+	// Parses a whole document, false (with a message in _error) on malformed input
+	static bool Parse(const char* _text, size_t _length, JsonValue& _value, std::string* _error = nullptr)
+	{
+		Parser parser{ _text, _text + _length, std::string() };
+		_value = JsonValue();
+		bool parsed = parser.ParseValue(_value, 0);
+		parser.SkipWhitespace();
+		if (parsed && parser.position != parser.end)
+			parsed = parser.Fail("trailing characters");
+		if (!parsed && _error)
+			*_error = parser.error + " at offset " + std::to_string(parser.position - _text);
+		return parsed;
+	}
+
+private:
+	static const JsonValue& Null()
+	{
+		static const JsonValue null;
+		return null;
+	}
+
+	struct Parser
+	{
+		static constexpr int kMaxDepth = 256;
+
+		const char* position;
+		const char* end;
+		std::string error;
+
+		bool Fail(const char* _message)
+		{
+			if (error.empty())
+				error = _message;
+			return false;
+		}
+
+		void SkipWhitespace()
+		{
+			while (position != end && (*position == ' ' || *position == '\t' || *position == '\n' || *position == '\r'))
+				position++;
+		}
+
+		bool Literal(const char* _word)
+		{
+			for (; *_word; _word++, position++) {
+				if (position == end || *position != *_word)
+					return Fail("invalid literal");
+			}
+			return true;
+		}
+
+		bool ParseValue(JsonValue& _value, int _depth)
+		{
+			if (_depth > kMaxDepth)
+				return Fail("nesting too deep");
+			SkipWhitespace();
+			if (position == end)
+				return Fail("unexpected end");
+
+			switch (*position) {
+			case '{': return ParseObject(_value, _depth);
+			case '[': return ParseArray(_value, _depth);
+			case '"':
+				_value.type = Type::String;
+				return ParseString(_value.string);
+			case 't':
+				_value.type = Type::Bool;
+				_value.boolean = true;
+				return Literal("true");
+			case 'f':
+				_value.type = Type::Bool;
+				_value.boolean = false;
+				return Literal("false");
+			case 'n':
+				return Literal("null");
+			default:
+				return ParseNumber(_value);
+			}
+		}
+
+		bool ParseObject(JsonValue& _value, int _depth)
+		{
+			_value.type = Type::Object;
+			position++; // {
+			SkipWhitespace();
+			if (position != end && *position == '}') {
+				position++;
+				return true;
+			}
+			while (true) {
+				SkipWhitespace();
+				if (position == end || *position != '"')
+					return Fail("expected member name");
+				_value.members.emplace_back();
+				Member& member = _value.members.back();
+				if (!ParseString(member.first))
+					return false;
+				SkipWhitespace();
+				if (position == end || *position != ':')
+					return Fail("expected ':'");
+				position++;
+				if (!ParseValue(member.second, _depth + 1))
+					return false;
+				SkipWhitespace();
+				if (position != end && *position == ',') {
+					position++;
+					continue;
+				}
+				if (position != end && *position == '}') {
+					position++;
+					return true;
+				}
+				return Fail("expected ',' or '}'");
+			}
+		}
+
+		bool ParseArray(JsonValue& _value, int _depth)
+		{
+			_value.type = Type::Array;
+			position++; // [
+			SkipWhitespace();
+			if (position != end && *position == ']') {
+				position++;
+				return true;
+			}
+			while (true) {
+				_value.elements.emplace_back();
+				if (!ParseValue(_value.elements.back(), _depth + 1))
+					return false;
+				SkipWhitespace();
+				if (position != end && *position == ',') {
+					position++;
+					continue;
+				}
+				if (position != end && *position == ']') {
+					position++;
+					return true;
+				}
+				return Fail("expected ',' or ']'");
+			}
+		}
+
+		bool ParseHex4(uint32_t& _code)
+		{
+			_code = 0;
+			for (int i = 0; i < 4; i++, position++) {
+				if (position == end)
+					return Fail("unexpected end in \\u escape");
+				char c = *position;
+				_code <<= 4;
+				if (c >= '0' && c <= '9') _code |= (uint32_t)(c - '0');
+				else if (c >= 'a' && c <= 'f') _code |= (uint32_t)(c - 'a' + 10);
+				else if (c >= 'A' && c <= 'F') _code |= (uint32_t)(c - 'A' + 10);
+				else return Fail("invalid \\u escape");
+			}
+			return true;
+		}
+
+		static void AppendUtf8(std::string& _out, uint32_t _code)
+		{
+			if (_code < 0x80)
+				_out += (char)_code;
+			else if (_code < 0x800) {
+				_out += (char)(0xC0 | (_code >> 6));
+				_out += (char)(0x80 | (_code & 0x3F));
+			}
+			else if (_code < 0x10000) {
+				_out += (char)(0xE0 | (_code >> 12));
+				_out += (char)(0x80 | ((_code >> 6) & 0x3F));
+				_out += (char)(0x80 | (_code & 0x3F));
+			}
+			else {
+				_out += (char)(0xF0 | (_code >> 18));
+				_out += (char)(0x80 | ((_code >> 12) & 0x3F));
+				_out += (char)(0x80 | ((_code >> 6) & 0x3F));
+				_out += (char)(0x80 | (_code & 0x3F));
+			}
+		}
+
+		bool ParseString(std::string& _out)
+		{
+			position++; // opening quote
+			while (true) {
+				// Copy the run up to the next quote or escape in one go
+				const char* run = position;
+				while (position != end && *position != '"' && *position != '\\')
+					position++;
+				_out.append(run, position);
+				if (position == end)
+					return Fail("unterminated string");
+				if (*position++ == '"')
+					return true;
+
+				if (position == end)
+					return Fail("unterminated string");
+				switch (*position++) {
+				case '"': _out += '"'; break;
+				case '\\': _out += '\\'; break;
+				case '/': _out += '/'; break;
+				case 'b': _out += '\b'; break;
+				case 'f': _out += '\f'; break;
+				case 'n': _out += '\n'; break;
+				case 'r': _out += '\r'; break;
+				case 't': _out += '\t'; break;
+				case 'u': {
+					uint32_t code;
+					if (!ParseHex4(code))
+						return false;
+					// Surrogate pair
+					if (code >= 0xD800 && code <= 0xDBFF && end - position >= 6 && position[0] == '\\' && position[1] == 'u') {
+						position += 2;
+						uint32_t low;
+						if (!ParseHex4(low))
+							return false;
+						code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+					}
+					AppendUtf8(_out, code);
+					break;
+				}
+				default:
+					return Fail("invalid escape");
+				}
+			}
+		}
+
+		bool ParseNumber(JsonValue& _value)
+		{
+			// strtod needs a terminated string, numbers are short
+			char buffer[64];
+			size_t length = 0;
+			while (position + length != end && length < sizeof(buffer) - 1) {
+				char c = position[length];
+				if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'))
+					break;
+				buffer[length++] = c;
+			}
+			if (length == 0)
+				return Fail("unexpected character");
+			buffer[length] = '\0';
+			char* parsedEnd = nullptr;
+			_value.number = std::strtod(buffer, &parsedEnd);
+			if (parsedEnd != buffer + length)
+				return Fail("invalid number");
+			_value.type = Type::Number;
+			position += length;
+			return true;
+		}
+	};
+
+private:
+	Type type = Type::Null;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> elements;
+	std::vector<Member> members;
+};
@@ -18,9 +18,13 @@
 #include <GLFW/glfw3.h>
 
 #include "camera.h"
+#include "draw_uniforms.h"
+#include "frame_uniforms.h"
 #include "geometry_renderers.h"
+#include "gl_state_cache.h"
 #include "model.h"
 #include "shader.h"
+#include "texture_manager.h"
 #include "timer.h"
 
 #include "imgui/imgui.h"
@@ -32,7 +36,6 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void ProcessInput(GLFWwindow* window);
-unsigned int LoadTexture(const std::string& path);
 
 // Scene settings
 int SCR_WIDTH = 1920;  // Screen width
@@ -74,7 +77,7 @@ int main()
 
 		// OpenGL global settings
 		// ----------------------
-		glEnable(GL_DEPTH_TEST);
+		GLStateCache::Get().Enable(GL_DEPTH_TEST);
 	}
 	catch (const std::runtime_error& e) {
 		std::cerr << e.what() << std::endl;
@@ -96,8 +99,10 @@ int main()
 	yzh::Cube cube;
 	yzh::Sphere sphere(64, 64);
 
-	// build and compile shader(s)
+	// build and compile shader(s), the normal map's tangent frame is rebuilt per fragment from
+	// derivatives (shader) or interpolated from the sphere's vertex tangents (tangentShader)
 	Shader shader("res/shaders/pbr_ibl.vert", "res/shaders/pbr_lighting_textured.frag");
+	Shader tangentShader("res/shaders/pbr_ibl.vert", "res/shaders/pbr_lighting_textured.frag", ShaderDefines{ { "NORMAL_MAP_SOURCE", "2" } });
 	Shader shaderLight("res/shaders/debug_light.vs", "res/shaders/debug_light.fs");
 
 	// lighting infos
@@ -110,26 +115,51 @@ int main()
 
 	// load PBR material textures
 	// --------------------------
-	unsigned int albedo = LoadTexture("res/textures/pbr/rusted_iron/albedo.png");
-	unsigned int normal = LoadTexture("res/textures/pbr/rusted_iron/normal.png");
-	unsigned int metallic = LoadTexture("res/textures/pbr/rusted_iron/metallic.png");
-	unsigned int roughness = LoadTexture("res/textures/pbr/rusted_iron/roughness.png");
-	unsigned int ao = LoadTexture("res/textures/pbr/rusted_iron/ao.png");
+	TextureManager& textures = TextureManager::Get();
+	unsigned int albedo = textures.Acquire("res/textures/pbr/rusted_iron/albedo.png");
+	unsigned int normal = textures.Acquire("res/textures/pbr/rusted_iron/normal.png");
+	unsigned int metallic = textures.Acquire("res/textures/pbr/rusted_iron/metallic.png");
+	unsigned int roughness = textures.Acquire("res/textures/pbr/rusted_iron/roughness.png");
+	unsigned int ao = textures.Acquire("res/textures/pbr/rusted_iron/ao.png");
 
 	// Scaling factors (control them in UI panal)
 	float metallicScale = 1.0f; // Scale factor for metallic
 	float roughnessScale = 1.0f; // Scale factor for roughness
 	glm::vec3 albedoScale(1.0f, 1.0f, 1.0f); // Scale factor for albedo
 
-	shader.Bind();
-	shader.SetInt("albedoMap", 0);
-	shader.SetInt("normalMap", 1);
-	shader.SetInt("metallicMap", 2);
-	shader.SetInt("roughnessMap", 3);
-	shader.SetInt("aoMap", 4);
+	for (Shader* pbrShader : { &shader, &tangentShader }) {
+		pbrShader->Bind();
+		pbrShader->SetInt("albedoMap", 0);
+		pbrShader->SetInt("normalMap", 1);
+		pbrShader->SetInt("metallicMap", 2);
+		pbrShader->SetInt("roughnessMap", 3);
+		pbrShader->SetInt("aoMap", 4);
+	}
+
+	// Camera and light are shared through the per-frame uniform buffer
+	FrameUniformBuffer frameUniforms;
+	frameUniforms.Attach(shader);
+	frameUniforms.Attach(tangentShader);
+	frameUniforms.Attach(shaderLight);
+	DrawUniformRing drawUniforms(nrRows * nrColumns + 1); // model and normal matrix per draw
+	drawUniforms.Attach(shader);
+	drawUniforms.Attach(tangentShader);
+	drawUniforms.Attach(shaderLight);
+	FrameData frameData;
+	frameData.lightPositions[0] = glm::vec4(lightPosition, 1.0f);
+	frameData.lightColors[0] = glm::vec4(lightColor, 0.0f);
 
 	timer.stop(); // Timer stops
 
+	// GPU time of the sphere grid, each query is read back kGridQueries frames after it was issued so
+	// reading it does not stall
+	const int kGridQueries = 4;
+	unsigned int gridQueries[kGridQueries];
+	glGenQueries(kGridQueries, gridQueries);
+	int gridQueryFrame = 0;
+	float gridMilliseconds = 0.0f;
+	bool useVertexTangents = true;
+
 	// Imgui settings
     // --------------
 	bool ImGUIFirstTime = true;
@@ -150,31 +180,35 @@ int main()
 
 		// PBR rendering
 		// -------------
-		shader.Bind();
+		Shader& pbrShader = useVertexTangents ? tangentShader : shader;
+		pbrShader.Bind();
 		glm::mat4 projection = glm::perspective(glm::radians(camera.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
 		glm::mat4 view = camera.GetViewMatrix();
 		glm::mat4 model = glm::mat4(1.0f);
-		shader.SetMat4("projection", projection); // projection matrix
-		shader.SetMat4("view", view); // view matrix
-		shader.SetVec3("viewPos", camera.position); // view(eye) position
-		shader.SetVec3("lightColor", lightColor); // lighting info
-		shader.SetVec3("lightPosition", lightPosition); // lighting info
+		frameData.projection = projection; // projection matrix
+		frameData.view = view; // view matrix
+		frameData.viewPos = glm::vec4(camera.position, 1.0f); // view(eye) position
+		frameUniforms.Update(frameData);
+		drawUniforms.BeginFrame();
 			
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, albedo);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, normal);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, metallic);
-		glActiveTexture(GL_TEXTURE3);
-		glBindTexture(GL_TEXTURE_2D, roughness);
-		glActiveTexture(GL_TEXTURE4);
-		glBindTexture(GL_TEXTURE_2D, ao);
+		GLStateCache::Get().BindTexture(0, GL_TEXTURE_2D, albedo);
+		GLStateCache::Get().BindTexture(1, GL_TEXTURE_2D, normal);
+		GLStateCache::Get().BindTexture(2, GL_TEXTURE_2D, metallic);
+		GLStateCache::Get().BindTexture(3, GL_TEXTURE_2D, roughness);
+		GLStateCache::Get().BindTexture(4, GL_TEXTURE_2D, ao);
 
 		// Scaling factors
-		shader.SetFloat("roughnessScale", roughnessScale); 
-		shader.SetFloat("metallicScale", metallicScale);
-		shader.SetVec3("albedoScale", albedoScale);
+		pbrShader.SetFloat("roughnessScale", roughnessScale); 
+		pbrShader.SetFloat("metallicScale", metallicScale);
+		pbrShader.SetVec3("albedoScale", albedoScale);
+
+		unsigned int gridQuery = gridQueries[gridQueryFrame % kGridQueries];
+		if (gridQueryFrame >= kGridQueries) {
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(gridQuery, GL_QUERY_RESULT, &elapsed);
+			gridMilliseconds = glm::mix(gridMilliseconds, elapsed / 1e6f, 0.05f);
+		}
+		glBeginQuery(GL_TIME_ELAPSED, gridQuery);
 
 		// render rows * column number of spheres with varying metallic/roughness values
 		// -----------------------------------------------------------------------------
@@ -186,23 +220,23 @@ int main()
 				model = glm::translate(model, glm::vec3((col - (nrColumns / 2)) * spacing, (row - (nrRows / 2)) * spacing, 0.0f));
 				model = glm::scale(model, glm::vec3(0.5f));
 
-				shader.SetMat4("model", model);
-				shader.SetMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
+				drawUniforms.Push(DrawData(model));
 				sphere.Render();
 			}
 		}
+		glEndQuery(GL_TIME_ELAPSED);
+		gridQueryFrame++;
 
 		// render light source 
 		// -------------------
 		shaderLight.Bind();
-		shaderLight.SetMat4("projection", projection);
-		shaderLight.SetMat4("view", view);
 
 		model = glm::mat4(1.0f);
 		model = glm::translate(model, lightPosition);
 		model = glm::scale(model, glm::vec3(0.5f));
-		shaderLight.SetMat4("model", model);
+		drawUniforms.Push(DrawData(model));
 		sphere.Render();
+		drawUniforms.EndFrame();
 
 		// ImGui new frame 
 		ImGui_ImplOpenGL3_NewFrame();
@@ -245,6 +279,11 @@ int main()
 		ImGui::SameLine();
 		ImGui::SliderFloat3("##Albedo", &albedoScale[0], 0.0f, 2.0f);
 
+		// Fragment cost of the two tangent frames on the 7 x 7 grid
+		if (ImGui::Checkbox("Vertex tangents (no dFdx/dFdy)", &useVertexTangents))
+			gridMilliseconds = 0.0f;
+		ImGui::Text("Sphere grid GPU time: %.3f ms", gridMilliseconds);
+
 		ImGui::End();
 
 		// ImGui Rendering
@@ -257,6 +296,7 @@ int main()
 	}
 
 	// Release all the resources of OpenGL (VAO, VBO, etc.)
+	glDeleteQueries(kGridQueries, gridQueries);
 	glfwTerminate();
 
 	// ImGui Cleanup
@@ -272,7 +312,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
 	// make sure the viewport matches the new window dimensions; note that SCR_WIDTH and 
 	// SCR_HEIGHT will be significantly larger than specified on retina displays.
-	glViewport(0, 0, width, height);
+	GLStateCache::Get().Viewport(0, 0, width, height);
 	SCR_WIDTH = width;
 	SCR_HEIGHT = height;
 }
@@ -326,40 +366,4 @@ void ProcessInput(GLFWwindow* window)
 		camera.ProcessKeyboard(LEFT, deltaTime);
 	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
 		camera.ProcessKeyboard(RIGHT, deltaTime);
-}
-
-// Utility function for loading a 2D texture from file
-unsigned int LoadTexture(const std::string& path)
-{
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrComponents, 0);
-	if (data) {
-		GLenum format = GL_RGBA;
-		if (nrComponents == 1) format = GL_RED;
-		else if (nrComponents == 3) format = GL_RGB;
-		else if (nrComponents == 4) format = GL_RGBA;
-		else {
-			std::cerr << "Invalid texture format: Unsupported number of components!\n";
-			return -1;
-		}
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		stbi_image_free(data);
-	}
-	else {
-		std::cerr << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-		return -1;
-	}
-
-	return textureID;
 }
\ No newline at end of file
@@ -1,10 +1,19 @@
 #pragma once
 
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 #include <string>
 
 #include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
 
+#include "gl_state_cache.h"
+#include "index_buffer.h"
 #include "shader.h"
 
 struct Vertex
@@ -18,6 +27,30 @@ struct Vertex
 	glm::vec3 Bitangent;
 };
 
+// GPU vertex layout of a Mesh, the CPU side always keeps Vertex
+enum class VertexFormat : uint8_t
+{
+	Float = 0, // Vertex as is, 56 bytes
+	Packed = 1 // PackedVertex, 20 bytes, the vertex shader needs PACKED_VERTEX 1
+};
+
+// Compact GPU vertex. Attribute locations stay those of Vertex, the shader sees:
+//   0 position   unorm16 in [0, 1] over the mesh AABB (all meshes' AABB in a MeshArena), decoded with
+//                positionOffset + aPos * positionScale
+//   1 normal     xyz of GL_INT_2_10_10_10_REV, normalized
+//   2 texCoords  half float
+//   3 tangent    xyz of GL_INT_2_10_10_10_REV, w: bitangent sign, bitangent = cross(normal, tangent.xyz) * tangent.w
+// Location 4 (bitangent) is not used.
+struct PackedVertex
+{
+	uint16_t position[4];  // w is padding
+	uint32_t normal;
+	uint32_t tangent;
+	uint16_t texCoords[2];
+};
+
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must stay 20 bytes");
+
 struct Texture
 {
 	std::string type; // e.g., texture_diffuse, texture_specular
@@ -28,11 +61,36 @@ struct Texture
 class Mesh
 {
 public:
+	// Index range of one level of detail in the mesh's index buffer, level 0 is indices, the
+	// coarser levels (lodIndices) follow it. error: distance to the full mesh relative to the
+	// bounds diagonal (see mesh_simplifier.h).
+	struct LodLevel
+	{
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		float error;
+	};
+
 	Mesh() = delete;  // Deleted default constructor
-	Mesh(const std::vector<Vertex>& vertices,
-		const std::vector<unsigned int>& indices,
+	// Takes the arrays by value, pass them with std::move() to hand them over without a copy
+	Mesh(std::vector<Vertex> vertices,
+		std::vector<unsigned int> indices,
+		std::vector<Texture> textures,
+		bool hasTangentAndBitangent,
+		bool createBuffers = true);  // Parameterized constructor
+	// Constructs from vertex/index blobs already in GPU layout (e.g. a memory-mapped .pbrmesh),
+	// the blobs go straight to glBufferData and the bounds are taken as given. lodIndexData and
+	// lodLevels are the coarser levels (see SetLods()), uploaded together with the indices.
+	// No CPU copy is kept, as after ReleaseCpuData(). With createBuffers false no GL objects are
+	// made and the blobs are copied instead, the mesh can only be drawn once it is placed in a
+	// MeshArena (see AttachToArena()).
+	Mesh(const Vertex* vertexData, size_t vertexCount,
+		const unsigned int* indexData, size_t indexCount,
 		const std::vector<Texture>& textures,
-		bool hasTangentAndBitangent);  // Parameterized constructor
+		bool hasTangentAndBitangent,
+		const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+		const unsigned int* lodIndexData, size_t lodIndexCount, std::vector<LodLevel> lodLevels,
+		bool createBuffers = true);
 	~Mesh();  // Destructor
 
 	// Move Semantics
@@ -59,48 +117,217 @@ public:
     //
 	void Render(Shader& shader, const std::vector<std::string>& textureTypesToUse = {}) const;
 
+	// Same as above with the filter given as a TextureTypeMask(), the per-frame path: after the
+	// first draw with a (shader, mask) pair it binds from a cached table without touching strings.
+	void Render(Shader& shader, uint32_t textureTypeMask) const;
+
+	// Binds the textures (and the PACKED_VERTEX uniforms) of this mesh without drawing, for
+	// callers that issue the draw themselves, e.g. MeshArena for a batch of meshes
+	void BindMaterial(Shader& shader, uint32_t textureTypeMask) const;
+
+	// True when both meshes bind the same textures under the same types
+	bool HasSameMaterial(const Mesh& other) const;
+
+	// Drops the mesh's own buffers, from now on it draws from the arena's VAO starting at
+	// firstIndex of the arena's index buffer, with indices relative to baseVertex. Packed
+	// positions are quantized over [quantizationMin, quantizationMax], the arena's range.
+	void AttachToArena(unsigned int arenaVAO, GLenum arenaIndexType, size_t firstIndex, int baseVertex,
+		const glm::vec3& quantizationMin, const glm::vec3& quantizationMax);
+
+	// Vertex attribute pointers of a Vertex / PackedVertex buffer, into the bound VAO from the
+	// bound GL_ARRAY_BUFFER
+	static void SetupVertexAttributes(VertexFormat format, bool hasTangentAndBitangent);
+
+	// Coarser levels over the same vertices, e.g. from MeshSimplifier::BuildLodChain(). Re-uploads
+	// the mesh's own index buffer, call it before the mesh goes into a MeshArena and before
+	// ReleaseCpuData().
+	void SetLods(std::vector<unsigned int> lodIndices, std::vector<LodLevel> lodLevels);
+	size_t GetLodCount() const { return 1 + lodLevels.size(); }
+	LodLevel GetLod(size_t level) const;
+	// Picks the coarsest level whose error, over screenSize pixels (the bounds diagonal on screen),
+	// stays within pixelThreshold pixels. Render() draws the picked level.
+	size_t SelectLod(float screenSize, float pixelThreshold) const;
+	void SetCurrentLod(size_t level) const { currentLod = level < GetLodCount() ? level : 0; }
+	size_t GetCurrentLod() const { return currentLod; }
+
+	// Texture type bits used by the filter mask. Every other type name gets its own bit on first use,
+	// so a filter keeps matching exact names like the string list did; only past 27 such names do the
+	// remaining ones share kTextureOverflow.
+	static constexpr uint32_t kTextureDiffuse = 1u << 0;
+	static constexpr uint32_t kTextureSpecular = 1u << 1;
+	static constexpr uint32_t kTextureNormal = 1u << 2;
+	static constexpr uint32_t kTextureHeight = 1u << 3;
+	static constexpr uint32_t kTextureOverflow = 1u << 31;
+	static constexpr uint32_t kAllTextureTypes = ~0u;
+
+	static uint32_t TextureTypeBit(const std::string& type);
+	// Converts a list of texture type names into a filter mask, an empty list selects every type
+	static uint32_t TextureTypeMask(const std::vector<std::string>& types);
+
+	// Frees vertices, indices and lodIndices once the GPU holds them (the mesh's own buffers or a
+	// MeshArena). Counts, bounds and textures stay, the mesh keeps drawing but can no longer be
+	// cached, simplified or placed in an arena.
+	void ReleaseCpuData();
+	bool HasCpuData() const { return vertices.size() == vertexCount && indices.size() == indexCount; }
+
+	// GPU layout of the meshes created from now on
+	static void SetDefaultVertexFormat(VertexFormat format) { DefaultVertexFormat() = format; }
+	static VertexFormat GetDefaultVertexFormat() { return DefaultVertexFormat(); }
+
+	// Quantizes vertices into PackedVertex, positions relative to [boundsMin, boundsMax]
+	static std::vector<PackedVertex> PackVertices(const Vertex* vertexData, size_t vertexCount,
+		const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
 	// Accessors
 	unsigned int GetVAO() { return VAO; }
 	const unsigned int GetVAO() const { return VAO; }
+	bool HasTangentAndBitangent() const { return hasTangentAndBitangent; }
+	// Object-space axis-aligned bounds of the vertices
+	const glm::vec3& GetBoundsMin() const { return boundsMin; }
+	const glm::vec3& GetBoundsMax() const { return boundsMax; }
+	VertexFormat GetVertexFormat() const { return vertexFormat; }
+	bool IsInArena() const { return !ownsBuffers; }
+	size_t GetFirstIndex() const { return firstIndex; }
+	int GetBaseVertex() const { return baseVertex; }
+	// GL_UNSIGNED_SHORT when the mesh has at most kMaxShortIndexVertices vertices
+	GLenum GetIndexType() const { return indexType; }
+	size_t GetIndexBufferBytes() const { return (indexCount + lodIndexCount) * IndexTypeSize(indexType); }
+	// Size of the vertex buffer, also the bytes one full draw fetches
+	size_t GetVertexBufferBytes() const { return vertexCount * (vertexFormat == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex)); }
+	// Also valid after ReleaseCpuData()
+	size_t GetVertexCount() const { return vertexCount; }
+	size_t GetIndexCount() const { return indexCount; } // level 0
+	// Bytes of vertices, indices and lodIndices held on the CPU
+	size_t GetCpuBytes() const { return vertices.capacity() * sizeof(Vertex) + (indices.capacity() + lodIndices.capacity()) * sizeof(unsigned int); }
 
 	// Public Members
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
 	std::vector<Texture> textures;
+	std::vector<unsigned int> lodIndices; // levels 1.., back to back after indices on the GPU
 
 private:
-	void SetupMesh();  // Initialize OpenGL objects
+	void SetupMesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount,
+		const unsigned int* lodIndexData, bool createBuffers);  // Initialize OpenGL objects
+	void DeleteBuffers();
+	// indices, then lodIndexCount indices of the coarser levels
+	void UploadIndexBuffer(const unsigned int* indexData, size_t indexCount, const unsigned int* lodIndexData) const;
+
+	// One sampler of a binding table: texture unit, texture and the sampler's uniform location
+	struct TextureBinding
+	{
+		GLint location;
+		int unit;
+		unsigned int texture;
+	};
+
+	// Sampler name -> texture unit mapping of this mesh for one (program, filter) combination.
+	// Keyed by Shader::GetGeneration(), the program id alone can belong to a rebuilt shader.
+	struct BindingTable
+	{
+		unsigned int program;
+		uint64_t programGeneration;
+		uint32_t textureTypeMask;
+		std::vector<TextureBinding> bindings;
+		GLint positionScaleLocation = -1;  // PACKED_VERTEX dequantization, packed meshes only
+		GLint positionOffsetLocation = -1;
+	};
+
+	const BindingTable& GetBindingTable(Shader& shader, uint32_t textureTypeMask) const;
+
+	static VertexFormat& DefaultVertexFormat()
+	{
+		static VertexFormat format = VertexFormat::Float;
+		return format;
+	}
 
 private:
-	unsigned int VAO, VBO, IBO;
+	unsigned int VAO = 0, VBO = 0, IBO = 0;
+	bool ownsBuffers = true; // false once the VAO belongs to a MeshArena
 	bool hasTangentAndBitangent = false;
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+	glm::vec3 quantizationMin = glm::vec3(0.0f); // PACKED_VERTEX range, the bounds unless in an arena
+	glm::vec3 quantizationMax = glm::vec3(0.0f);
+	VertexFormat vertexFormat = VertexFormat::Float;
+	GLenum indexType = GL_UNSIGNED_INT;
+	size_t firstIndex = 0;
+	int baseVertex = 0;
+	std::vector<LodLevel> lodLevels; // levels 1..
+	mutable size_t currentLod = 0;
+	size_t vertexCount = 0;   // of vertices / indices / lodIndices while they are kept
+	size_t indexCount = 0;
+	size_t lodIndexCount = 0;
+	mutable std::vector<BindingTable> bindingTables; // built on first use, usually one or two entries
 };
 
-Mesh::Mesh(const std::vector<Vertex>& _vertices,
-	const std::vector<unsigned int>& _indices,
-	const std::vector<Texture>& _textures,
-	bool _hasTangentAndBitangent)
+Mesh::Mesh(std::vector<Vertex> _vertices,
+	std::vector<unsigned int> _indices,
+	std::vector<Texture> _textures,
+	bool _hasTangentAndBitangent,
+	bool _createBuffers)
+	: vertices(std::move(_vertices)), indices(std::move(_indices)), textures(std::move(_textures)),
+	hasTangentAndBitangent(_hasTangentAndBitangent)
 {
-	this->vertices = _vertices;
-	this->indices = _indices;
-	this->textures = _textures;
-	this->hasTangentAndBitangent = _hasTangentAndBitangent;
 
-	SetupMesh();
+	if (!vertices.empty()) {
+		boundsMin = glm::vec3(FLT_MAX);
+		boundsMax = glm::vec3(-FLT_MAX);
+		for (const Vertex& vertex : vertices) {
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+	}
+
+	SetupMesh(vertices.data(), vertices.size(), indices.data(), indices.size(), nullptr, _createBuffers);
+}
+
+Mesh::Mesh(const Vertex* _vertexData, size_t _vertexCount,
+	const unsigned int* _indexData, size_t _indexCount,
+	const std::vector<Texture>& _textures,
+	bool _hasTangentAndBitangent,
+	const glm::vec3& _boundsMin, const glm::vec3& _boundsMax,
+	const unsigned int* _lodIndexData, size_t _lodIndexCount, std::vector<LodLevel> _lodLevels,
+	bool _createBuffers)
+	: textures(_textures), hasTangentAndBitangent(_hasTangentAndBitangent),
+	boundsMin(_boundsMin), boundsMax(_boundsMax), lodLevels(std::move(_lodLevels)), lodIndexCount(_lodIndexCount)
+{
+	// A MeshArena fills its buffers from the CPU arrays later, the only case that needs them
+	if (!_createBuffers) {
+		vertices.assign(_vertexData, _vertexData + _vertexCount);
+		indices.assign(_indexData, _indexData + _indexCount);
+		lodIndices.assign(_lodIndexData, _lodIndexData + _lodIndexCount);
+	}
+	SetupMesh(_vertexData, _vertexCount, _indexData, _indexCount, _lodIndexData, _createBuffers);
 }
 
 Mesh::~Mesh()
 {
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &IBO);
+	DeleteBuffers();
+}
+
+// Only the mesh's own objects, an arena VAO is deleted by its MeshArena
+void Mesh::DeleteBuffers()
+{
+	if (ownsBuffers && VAO != 0) {
+		GLStateCache::Get().ForgetVertexArray(VAO);
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+		glDeleteBuffers(1, &IBO);
+	}
+	VAO = VBO = IBO = 0;
 }
 
 // Move constructor
 Mesh::Mesh(Mesh&& other) noexcept
-	: VAO(other.VAO), VBO(other.VBO), IBO(other.IBO),
-	vertices(std::move(other.vertices)), indices(std::move(other.indices)),
-	textures(std::move(other.textures)), hasTangentAndBitangent(other.hasTangentAndBitangent)
+	: vertices(std::move(other.vertices)), indices(std::move(other.indices)),
+	textures(std::move(other.textures)), lodIndices(std::move(other.lodIndices)), VAO(other.VAO), VBO(other.VBO), IBO(other.IBO),
+	ownsBuffers(other.ownsBuffers), hasTangentAndBitangent(other.hasTangentAndBitangent),
+	boundsMin(other.boundsMin), boundsMax(other.boundsMax),
+	quantizationMin(other.quantizationMin), quantizationMax(other.quantizationMax), vertexFormat(other.vertexFormat),
+	indexType(other.indexType), firstIndex(other.firstIndex), baseVertex(other.baseVertex),
+	lodLevels(std::move(other.lodLevels)), currentLod(other.currentLod), vertexCount(other.vertexCount),
+	indexCount(other.indexCount), lodIndexCount(other.lodIndexCount), bindingTables(std::move(other.bindingTables))
 {
 	// Invalidate the moved-from object's OpenGL handles
 	other.VAO = 0;
@@ -114,18 +341,32 @@ Mesh& Mesh::operator=(Mesh&& other) noexcept
 	// prevent duplication
 	if (this != &other) {
 		// Release any resources held by *this
-		glDeleteVertexArrays(1, &VAO);
-		glDeleteBuffers(1, &VBO);
-		glDeleteBuffers(1, &IBO);
+		DeleteBuffers();
 
 		// Steal the resources from other
 		VAO = other.VAO;
 		VBO = other.VBO;
 		IBO = other.IBO;
+		ownsBuffers = other.ownsBuffers;
 		vertices = std::move(other.vertices);
 		indices = std::move(other.indices);
 		textures = std::move(other.textures);
+		lodIndices = std::move(other.lodIndices);
 		hasTangentAndBitangent = other.hasTangentAndBitangent;
+		boundsMin = other.boundsMin;
+		boundsMax = other.boundsMax;
+		quantizationMin = other.quantizationMin;
+		quantizationMax = other.quantizationMax;
+		vertexFormat = other.vertexFormat;
+		indexType = other.indexType;
+		firstIndex = other.firstIndex;
+		baseVertex = other.baseVertex;
+		lodLevels = std::move(other.lodLevels);
+		currentLod = other.currentLod;
+		vertexCount = other.vertexCount;
+		indexCount = other.indexCount;
+		lodIndexCount = other.lodIndexCount;
+		bindingTables = std::move(other.bindingTables);
 
 		// Invalidate the moved-from object's OpenGL handles
 		other.VAO = 0;
@@ -137,19 +378,161 @@ Mesh& Mesh::operator=(Mesh&& other) noexcept
 
 void Mesh::Render(Shader& shader, const std::vector<std::string>& textureTypesToUse) const
 {
+	Render(shader, TextureTypeMask(textureTypesToUse));
+}
+
+void Mesh::Render(Shader& shader, uint32_t textureTypeMask) const
+{
+	BindMaterial(shader, textureTypeMask);
+
+	// Draw mesh, the VAO stays bound so consecutive draws of this mesh (or of meshes sharing an
+	// arena) skip the rebind
+	LodLevel lod = GetLod(currentLod);
+	GLStateCache::Get().BindVertexArray(VAO);
+	glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)lod.indexCount, indexType,
+		reinterpret_cast<const void*>((firstIndex + lod.firstIndex) * IndexTypeSize(indexType)), baseVertex);
+}
+
+void Mesh::SetLods(std::vector<unsigned int> _lodIndices, std::vector<LodLevel> _lodLevels)
+{
+	lodIndices = std::move(_lodIndices);
+	lodLevels = std::move(_lodLevels);
+	lodIndexCount = lodIndices.size();
+	currentLod = 0;
+	if (!ownsBuffers || VAO == 0)
+		return;
+
+	GLStateCache::Get().BindVertexArray(VAO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+	UploadIndexBuffer(indices.data(), indices.size(), lodIndices.data());
+	GLStateCache::Get().BindVertexArray(0);
+}
+
+Mesh::LodLevel Mesh::GetLod(size_t _level) const
+{
+	if (_level == 0 || _level > lodLevels.size())
+		return { 0, (uint32_t)indexCount, 0.0f };
+	return lodLevels[_level - 1];
+}
+
+size_t Mesh::SelectLod(float _screenSize, float _pixelThreshold) const
+{
+	size_t level = 0;
+	for (size_t i = 0; i < lodLevels.size(); i++) {
+		if (lodLevels[i].error * _screenSize > _pixelThreshold)
+			break;
+		level = i + 1;
+	}
+	currentLod = level;
+	return level;
+}
+
+void Mesh::BindMaterial(Shader& shader, uint32_t textureTypeMask) const
+{
+	GLStateCache& state = GLStateCache::Get();
+	const BindingTable& table = GetBindingTable(shader, textureTypeMask);
+	for (const TextureBinding& binding : table.bindings) {
+		shader.SetInt(binding.location, binding.unit);
+		state.BindTexture(binding.unit, GL_TEXTURE_2D, binding.texture); // skipped when the unit already holds it
+	}
+	if (vertexFormat == VertexFormat::Packed) {
+		shader.SetVec3(table.positionScaleLocation, quantizationMax - quantizationMin);
+		shader.SetVec3(table.positionOffsetLocation, quantizationMin);
+	}
+}
+
+bool Mesh::HasSameMaterial(const Mesh& other) const
+{
+	if (textures.size() != other.textures.size())
+		return false;
+	for (size_t i = 0; i < textures.size(); i++) {
+		if (textures[i].id != other.textures[i].id || textures[i].type != other.textures[i].type)
+			return false;
+	}
+	return true;
+}
+
+void Mesh::ReleaseCpuData()
+{
+	std::vector<Vertex>().swap(vertices);
+	std::vector<unsigned int>().swap(indices);
+	std::vector<unsigned int>().swap(lodIndices);
+}
+
+void Mesh::AttachToArena(unsigned int _arenaVAO, GLenum _arenaIndexType, size_t _firstIndex, int _baseVertex,
+	const glm::vec3& _quantizationMin, const glm::vec3& _quantizationMax)
+{
+	DeleteBuffers();
+	ownsBuffers = false;
+	VAO = _arenaVAO;
+	indexType = _arenaIndexType;
+	firstIndex = _firstIndex;
+	baseVertex = _baseVertex;
+	quantizationMin = _quantizationMin;
+	quantizationMax = _quantizationMax;
+}
+
+uint32_t Mesh::TextureTypeBit(const std::string& type)
+{
+	if (type == "texture_diffuse")
+		return kTextureDiffuse;
+	if (type == "texture_specular")
+		return kTextureSpecular;
+	if (type == "texture_normal")
+		return kTextureNormal;
+	if (type == "texture_height")
+		return kTextureHeight;
+
+	static std::mutex mutex;
+	static std::unordered_map<std::string, uint32_t> bits;
+	std::lock_guard<std::mutex> lock(mutex);
+	auto found = bits.find(type);
+	if (found != bits.end())
+		return found->second;
+	uint32_t bit = bits.size() < 27 ? kTextureHeight << (bits.size() + 1) : kTextureOverflow;
+	bits.emplace(type, bit);
+	return bit;
+}
+
+uint32_t Mesh::TextureTypeMask(const std::vector<std::string>& types)
+{
+	if (types.empty())
+		return kAllTextureTypes;
+
+	uint32_t mask = 0;
+	for (const std::string& type : types)
+		mask |= TextureTypeBit(type);
+	return mask;
+}
+
+// Resolves the sampler names once per (program, filter) combination, the string work of the
+// original per-draw loop happens only here.
+const Mesh::BindingTable& Mesh::GetBindingTable(Shader& shader, uint32_t textureTypeMask) const
+{
+	for (const BindingTable& table : bindingTables) {
+		if (table.programGeneration == shader.GetGeneration() && table.textureTypeMask == textureTypeMask)
+			return table;
+	}
+
+	// Tables of an older program that had this id are stale, drop them so the list stays short
+	bindingTables.erase(std::remove_if(bindingTables.begin(), bindingTables.end(), [&](const BindingTable& stale) {
+		return stale.program == shader.GetID() && stale.programGeneration != shader.GetGeneration();
+	}), bindingTables.end());
+
+	BindingTable table;
+	table.program = shader.GetID();
+	table.programGeneration = shader.GetGeneration();
+	table.textureTypeMask = textureTypeMask;
+
 	// Start from material.diffuse1 or material.specular1
 	size_t diffuseNr = 1, specularNr = 1, normalNr = 1, heightNr = 1;
-
 	for (int i = 0; i < textures.size(); i++) {
-		glActiveTexture(GL_TEXTURE0 + i);
 		// Get texture numberN in diffuse_textureN 
-		std::string name = textures[i].type;
+		const std::string& name = textures[i].type;
 
 		// Skip this texture if it's not in the list of types to use
-		if (!textureTypesToUse.empty() && 
-			std::find(textureTypesToUse.begin(), textureTypesToUse.end(), name) == textureTypesToUse.end()) {
+		if ((TextureTypeBit(name) & textureTypeMask) == 0)
 			continue;
-		}
 
 		std::string number;
 		if (name == "texture_diffuse")
@@ -162,29 +545,103 @@ void Mesh::Render(Shader& shader, const std::vector<std::string>& textureTypesTo
 			number = std::to_string(heightNr++);
 
 		// can change this line based on the specific shader code
-		shader.SetInt((name + number).c_str(), i);
-		glBindTexture(GL_TEXTURE_2D, textures[i].id);
+		std::string samplerName = name + number;
+		table.bindings.push_back({ shader.GetUniformLocation(UniformName(samplerName)), i, textures[i].id });
 	}
+	if (vertexFormat == VertexFormat::Packed) {
+		table.positionScaleLocation = shader.GetUniformLocation("positionScale");
+		table.positionOffsetLocation = shader.GetUniformLocation("positionOffset");
+	}
+
+	bindingTables.push_back(std::move(table));
+	return bindingTables.back();
+}
 
-	// Draw mesh
-	glBindVertexArray(VAO);
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
+std::vector<PackedVertex> Mesh::PackVertices(const Vertex* vertexData, size_t vertexCount,
+	const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	glm::vec3 extent = boundsMax - boundsMin;
+	glm::vec3 inverseExtent = glm::vec3(
+		extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+		extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+		extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+	std::vector<PackedVertex> packed(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++) {
+		const Vertex& vertex = vertexData[i];
+		PackedVertex& out = packed[i];
+
+		glm::vec3 position = glm::clamp((vertex.position - boundsMin) * inverseExtent, 0.0f, 1.0f);
+		for (int axis = 0; axis < 3; axis++)
+			out.position[axis] = (uint16_t)(position[axis] * 65535.0f + 0.5f);
+		out.position[3] = 0;
+
+		out.normal = glm::packSnorm3x10_1x2(glm::vec4(vertex.normal, 0.0f));
+
+		// Bitangent folded into a handedness sign, rebuilt as cross(normal, tangent) * sign
+		float sign = glm::dot(glm::cross(vertex.normal, vertex.Tangent), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+		out.tangent = glm::packSnorm3x10_1x2(glm::vec4(vertex.Tangent, sign));
+
+		out.texCoords[0] = glm::packHalf1x16(vertex.texCoords.x);
+		out.texCoords[1] = glm::packHalf1x16(vertex.texCoords.y);
+	}
+	return packed;
 }
 
-void Mesh::SetupMesh()
+void Mesh::SetupMesh(const Vertex* _vertexData, size_t _vertexCount, const unsigned int* _indexData, size_t _indexCount,
+	const unsigned int* _lodIndexData, bool _createBuffers)
 {
+	vertexCount = _vertexCount;
+	indexCount = _indexCount;
+	indexType = IndexTypeFor(_vertexCount);
+	vertexFormat = GetDefaultVertexFormat();
+	quantizationMin = boundsMin;
+	quantizationMax = boundsMax;
+	if (!_createBuffers)
+		return; // drawn once a MeshArena holds the vertices
+
 	// VAO, VBO, and IBO(EBO)
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
 	glGenBuffers(1, &IBO);
 
-	glBindVertexArray(VAO);
+	GLStateCache::Get().BindVertexArray(VAO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+	UploadIndexBuffer(_indexData, _indexCount, _lodIndexData);
+
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+	if (vertexFormat == VertexFormat::Packed) {
+		std::vector<PackedVertex> packed = PackVertices(_vertexData, _vertexCount, boundsMin, boundsMax);
+		glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
+	}
+	else
+		glBufferData(GL_ARRAY_BUFFER, _vertexCount * sizeof(Vertex), _vertexData, GL_STATIC_DRAW);
+	SetupVertexAttributes(vertexFormat, hasTangentAndBitangent);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+	// Unbind VAO
+	GLStateCache::Get().BindVertexArray(0);
+}
+
+void Mesh::UploadIndexBuffer(const unsigned int* _indexData, size_t _indexCount, const unsigned int* _lodIndexData) const
+{
+	UploadIndices(indexType, _indexData, _indexCount, _lodIndexData, lodIndexCount);
+}
+
+void Mesh::SetupVertexAttributes(VertexFormat _format, bool _hasTangentAndBitangent)
+{
+	if (_format == VertexFormat::Packed) {
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
+		if (_hasTangentAndBitangent) {
+			glEnableVertexAttribArray(3);
+			glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, tangent));
+		}
+		return;
+	}
 
 	// Positions
 	glEnableVertexAttribArray(0);
@@ -198,7 +655,7 @@ void Mesh::SetupMesh()
 	glEnableVertexAttribArray(2);
 	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
 
-	if (hasTangentAndBitangent) {
+	if (_hasTangentAndBitangent) {
 		// vertex tangent
 		glEnableVertexAttribArray(3);
 		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
@@ -207,6 +664,4 @@ void Mesh::SetupMesh()
 		glEnableVertexAttribArray(4);
 		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
 	}
-	// Unbind VAO
-	glBindVertexArray(0);
 }
\ No newline at end of file
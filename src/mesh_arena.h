@@ -0,0 +1,253 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "gl_state_cache.h"
+#include "index_buffer.h"
+#include "mesh.h"
+#include "shader.h"
+
+// One vertex buffer, one index buffer and one VAO holding every mesh of a Model.
+//
+// Each mesh becomes a range of the index buffer drawn with glDrawElementsBaseVertex, so drawing
+// the meshes one after another never rebinds the VAO. With ARB_multi_draw_indirect consecutive
+// meshes that share a material are collapsed into one glMultiDrawElementsIndirect over a command
+// buffer built at Build() time: one draw call per material instead of one per mesh. The commands
+// follow the level of detail each mesh has selected, the buffer is rewritten when one changes.
+//
+// Indices are 16-bit when every mesh has at most kMaxShortIndexVertices vertices (they stay
+// relative to the mesh's base vertex). Packed vertices are quantized over the bounds of all meshes,
+// so one positionScale / positionOffset serves every draw.
+//
+// Usage:
+//   MeshArena arena;
+//   arena.Build(meshes);                         // meshes now draw from the arena
+//   arena.Render(meshes, shader, Mesh::kAllTextureTypes);
+class MeshArena
+{
+public:
+	// Layout of DrawElementsIndirectCommand
+	struct DrawCommand
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// Consecutive meshes with the same material
+	struct Batch
+	{
+		size_t firstMesh;
+		size_t meshCount;
+	};
+
+	MeshArena() = default;
+
+	~MeshArena() { Release(); }
+
+	MeshArena(const MeshArena&) = delete;
+	MeshArena& operator=(const MeshArena&) = delete;
+
+	MeshArena(MeshArena&& other) noexcept
+		: VAO(other.VAO), VBO(other.VBO), IBO(other.IBO), commandBuffer(other.commandBuffer),
+		indexType(other.indexType), batches(std::move(other.batches)), commands(std::move(other.commands)), vertexBytes(other.vertexBytes), indexBytes(other.indexBytes)
+	{
+		other.VAO = other.VBO = other.IBO = other.commandBuffer = 0;
+	}
+
+	MeshArena& operator=(MeshArena&& other) noexcept
+	{
+		if (this != &other) {
+			Release();
+			VAO = other.VAO;
+			VBO = other.VBO;
+			IBO = other.IBO;
+			commandBuffer = other.commandBuffer;
+			indexType = other.indexType;
+			batches = std::move(other.batches);
+			commands = std::move(other.commands);
+			vertexBytes = other.vertexBytes;
+			indexBytes = other.indexBytes;
+			other.VAO = other.VBO = other.IBO = other.commandBuffer = 0;
+		}
+		return *this;
+	}
+
+	static bool HasMultiDrawIndirect() { return GLEW_ARB_multi_draw_indirect || GLEW_VERSION_4_3; }
+
+	// Turns the multi-draw path off (e.g. to compare against per-mesh draws), on by default
+	static void SetMultiDrawEnabled(bool _enabled) { MultiDrawFlag() = _enabled; }
+	static bool IsMultiDrawEnabled() { return MultiDrawFlag() && HasMultiDrawIndirect(); }
+
+	// Uploads the meshes' CPU vertices and indices into the shared buffers and attaches every mesh
+	// to them, the meshes' own buffers (if any) are deleted. All meshes must use the same
+	// VertexFormat and still have their CPU data (see Mesh::ReleaseCpuData()).
+	void Build(std::vector<Mesh>& _meshes)
+	{
+		Release();
+		if (_meshes.empty())
+			return;
+
+		const VertexFormat format = _meshes.front().GetVertexFormat();
+		const size_t stride = format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+		size_t vertexCount = 0, indexCount = 0, largestMesh = 0;
+		bool hasTangentAndBitangent = false;
+		glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+		for (const Mesh& mesh : _meshes) {
+			vertexCount += mesh.vertices.size();
+			indexCount += mesh.indices.size() + mesh.lodIndices.size();
+			largestMesh = std::max(largestMesh, mesh.vertices.size());
+			hasTangentAndBitangent |= mesh.HasTangentAndBitangent();
+			if (!mesh.vertices.empty()) {
+				boundsMin = glm::min(boundsMin, mesh.GetBoundsMin());
+				boundsMax = glm::max(boundsMax, mesh.GetBoundsMax());
+			}
+		}
+		if (vertexCount == 0)
+			boundsMin = boundsMax = glm::vec3(0.0f);
+		indexType = IndexTypeFor(largestMesh);
+		vertexBytes = vertexCount * stride;
+		indexBytes = indexCount * IndexTypeSize(indexType);
+
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glGenBuffers(1, &IBO);
+		GLStateCache::Get().BindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, vertexBytes, nullptr, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, nullptr, GL_STATIC_DRAW);
+
+		commands.reserve(_meshes.size());
+		std::vector<uint16_t> shortIndices;
+		size_t baseVertex = 0, firstIndex = 0;
+		for (Mesh& mesh : _meshes) {
+			if (format == VertexFormat::Packed) {
+				std::vector<PackedVertex> packed = Mesh::PackVertices(mesh.vertices.data(), mesh.vertices.size(), boundsMin, boundsMax);
+				glBufferSubData(GL_ARRAY_BUFFER, baseVertex * stride, packed.size() * stride, packed.data());
+			}
+			else
+				glBufferSubData(GL_ARRAY_BUFFER, baseVertex * stride, mesh.vertices.size() * stride, mesh.vertices.data());
+
+			// Level 0, then the coarser levels
+			size_t lodFirstIndex = firstIndex + mesh.indices.size();
+			if (indexType == GL_UNSIGNED_SHORT) {
+				shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+				shortIndices.insert(shortIndices.end(), mesh.lodIndices.begin(), mesh.lodIndices.end());
+				glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, firstIndex * sizeof(uint16_t), shortIndices.size() * sizeof(uint16_t), shortIndices.data());
+			}
+			else {
+				glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, firstIndex * sizeof(uint32_t), mesh.indices.size() * sizeof(uint32_t), mesh.indices.data());
+				glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, lodFirstIndex * sizeof(uint32_t), mesh.lodIndices.size() * sizeof(uint32_t), mesh.lodIndices.data());
+			}
+
+			mesh.AttachToArena(VAO, indexType, firstIndex, (int)baseVertex, boundsMin, boundsMax);
+			commands.push_back(CommandFor(mesh));
+			baseVertex += mesh.vertices.size();
+			firstIndex = lodFirstIndex + mesh.lodIndices.size();
+		}
+		Mesh::SetupVertexAttributes(format, hasTangentAndBitangent);
+		GLStateCache::Get().BindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		for (size_t i = 0; i < _meshes.size(); i++) {
+			if (batches.empty() || !_meshes[i].HasSameMaterial(_meshes[batches.back().firstMesh]))
+				batches.push_back({ i, 0 });
+			batches.back().meshCount++;
+		}
+
+		if (HasMultiDrawIndirect()) {
+			glGenBuffers(1, &commandBuffer);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawCommand), commands.data(), GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		}
+	}
+
+	bool IsEmpty() const { return VAO == 0; }
+
+	// Draws _meshes, the vector Build() was called with
+	void Render(const std::vector<Mesh>& _meshes, Shader& _shader, uint32_t _textureTypeMask) const
+	{
+		if (!IsMultiDrawEnabled()) {
+			for (const Mesh& mesh : _meshes)
+				mesh.Render(_shader, _textureTypeMask);
+			return;
+		}
+
+		GLStateCache::Get().BindVertexArray(VAO);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+		bool changed = false;
+		for (size_t i = 0; i < _meshes.size(); i++) {
+			DrawCommand command = CommandFor(_meshes[i]);
+			if (command.count != commands[i].count || command.firstIndex != commands[i].firstIndex) {
+				commands[i] = command;
+				changed = true;
+			}
+		}
+		if (changed)
+			glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawCommand), commands.data());
+
+		for (const Batch& batch : batches) {
+			_meshes[batch.firstMesh].BindMaterial(_shader, _textureTypeMask);
+			glMultiDrawElementsIndirect(GL_TRIANGLES, indexType,
+				reinterpret_cast<const void*>(batch.firstMesh * sizeof(DrawCommand)), (GLsizei)batch.meshCount, 0);
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	// Draw calls one Render() issues for _meshCount meshes
+	size_t GetDrawCallCount(size_t _meshCount) const { return IsMultiDrawEnabled() ? batches.size() : _meshCount; }
+
+	const std::vector<Batch>& GetBatches() const { return batches; }
+	GLenum GetIndexType() const { return indexType; }
+	size_t GetVertexBufferBytes() const { return vertexBytes; }
+	size_t GetIndexBufferBytes() const { return indexBytes; }
+
+private:
+	static bool& MultiDrawFlag()
+	{
+		static bool enabled = true;
+		return enabled;
+	}
+
+	// The level of detail the mesh has selected, the mesh is attached already
+	static DrawCommand CommandFor(const Mesh& _mesh)
+	{
+		Mesh::LodLevel lod = _mesh.GetLod(_mesh.GetCurrentLod());
+		return { lod.indexCount, 1, (GLuint)(_mesh.GetFirstIndex() + lod.firstIndex), _mesh.GetBaseVertex(), 0 };
+	}
+
+	void Release()
+	{
+		if (VAO != 0) {
+			GLStateCache::Get().ForgetVertexArray(VAO);
+			glDeleteVertexArrays(1, &VAO);
+			glDeleteBuffers(1, &VBO);
+			glDeleteBuffers(1, &IBO);
+		}
+		if (commandBuffer != 0)
+			glDeleteBuffers(1, &commandBuffer);
+		VAO = VBO = IBO = commandBuffer = 0;
+		batches.clear();
+		commands.clear();
+		vertexBytes = indexBytes = 0;
+	}
+
+private:
+	unsigned int VAO = 0, VBO = 0, IBO = 0;
+	unsigned int commandBuffer = 0; // GL_DRAW_INDIRECT_BUFFER, one DrawCommand per mesh
+	GLenum indexType = GL_UNSIGNED_INT;
+	std::vector<Batch> batches;
+	mutable std::vector<DrawCommand> commands; // CPU copy of commandBuffer
+	size_t vertexBytes = 0;
+	size_t indexBytes = 0;
+};
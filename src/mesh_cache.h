@@ -0,0 +1,449 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "tangent_generator.h"
+
+// Read-only memory mapping of a whole file, unmapped on destruction
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::string& _path) { Open(_path); }
+	~MappedFile() { Close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& _path)
+	{
+		Close();
+#ifdef _WIN32
+		file = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+			Close();
+			return false;
+		}
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping) {
+			Close();
+			return false;
+		}
+		data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		size = (size_t)fileSize.QuadPart;
+#else
+		descriptor = open(_path.c_str(), O_RDONLY);
+		if (descriptor < 0)
+			return false;
+		struct stat status;
+		if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+			Close();
+			return false;
+		}
+		void* view = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		data = (view == MAP_FAILED) ? nullptr : static_cast<const char*>(view);
+		size = (size_t)status.st_size;
+#endif
+		if (!data) {
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void Close()
+	{
+#ifdef _WIN32
+		if (data)
+			UnmapViewOfFile(data);
+		if (mapping)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+		mapping = nullptr;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (data)
+			munmap(const_cast<char*>(data), size);
+		if (descriptor >= 0)
+			close(descriptor);
+		descriptor = -1;
+#endif
+		data = nullptr;
+		size = 0;
+	}
+
+	bool IsOpen() const { return data != nullptr; }
+	const char* Data() const { return data; }
+	size_t Size() const { return size; }
+
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#else
+	int descriptor = -1;
+#endif
+};
+
+// Binary cache of imported models (<source>.pbrmesh next to the source file).
+//
+// Written once after the first Assimp import, later loads memory-map it and hand the vertex and
+// index blobs, which are stored in GPU layout, straight to glBufferData. No Assimp and no
+// per-vertex work on a hit. The cache is dropped and rewritten when the format version, the
+// Vertex layout, the enabled import stages (MeshOptimizer, MeshSimplifier, TangentGenerator) or
+// the source file's size / modification time change.
+//
+// Layout (little endian, blobs 16-byte aligned):
+//   Header
+//   MeshRecord[meshCount]
+//   TextureRecord[textureCount]   referenced by MeshRecord::firstTexture / textureCount
+//   string blob                   texture types and paths, not null terminated
+//   vertex / index blobs          Vertex[vertexCount] and uint32[indexCount] per mesh
+//   LOD blob                      Mesh::LodLevel[lodCount] and uint32[lodIndexCount] per mesh, if any
+//
+// Usage:
+//   MeshCache::Get().SetEnabled(false);  // force Assimp imports, e.g. for a cold-load benchmark
+//   ...
+//   MeshCache::Get().PrintStats();       // per model hits / misses / times
+class MeshCache
+{
+public:
+	struct Stats
+	{
+		unsigned int hits = 0;
+		unsigned int misses = 0;
+		float hitMilliseconds = 0.0f;  // accumulated load time of all hits
+		float missMilliseconds = 0.0f; // accumulated load time of all misses (import + store)
+	};
+
+	// Resolves a texture reference (type name, path relative to the model directory) to a loaded texture
+	using TextureLoader = std::function<Texture(const std::string& _type, const std::string& _path)>;
+
+	static MeshCache& Get()
+	{
+		static MeshCache cache;
+		return cache;
+	}
+
+	MeshCache(const MeshCache&) = delete;
+	MeshCache& operator=(const MeshCache&) = delete;
+
+	void SetEnabled(bool _enabled) { enabled = _enabled; }
+	bool IsEnabled() const { return enabled; }
+
+	static std::string PathFor(const std::string& _sourcePath) { return _sourcePath + ".pbrmesh"; }
+
+	// Builds the meshes of _sourcePath from its cache file, returns false on a miss or a stale /
+	// damaged cache, in which case _meshes is left untouched. _createBuffers is passed on to the
+	// Mesh constructor (false when the meshes go into a MeshArena).
+	bool Load(const std::string& _sourcePath, std::vector<Mesh>& _meshes, const TextureLoader& _loadTexture,
+		bool _createBuffers = true) const
+	{
+		MappedFile file(PathFor(_sourcePath));
+		if (!file.IsOpen() || file.Size() < sizeof(Header))
+			return false;
+
+		const char* base = file.Data();
+		const size_t size = file.Size();
+		Header header;
+		std::memcpy(&header, base, sizeof(header));
+		if (header.magic != kMagic || header.version != kVersion || header.vertexStride != sizeof(Vertex) ||
+			header.stages != EnabledStages() || !MatchesSource(header, _sourcePath))
+			return false;
+
+		const uint64_t recordsEnd = sizeof(Header) + (uint64_t)header.meshCount * sizeof(MeshRecord) +
+			(uint64_t)header.textureCount * sizeof(TextureRecord);
+		if (recordsEnd > size || header.stringsOffset + header.stringsSize > size)
+			return false;
+
+		const MeshRecord* records = reinterpret_cast<const MeshRecord*>(base + sizeof(Header));
+		const TextureRecord* textureRecords = reinterpret_cast<const TextureRecord*>(records + header.meshCount);
+		const char* strings = base + header.stringsOffset;
+
+		for (uint32_t i = 0; i < header.meshCount; i++) {
+			const MeshRecord& record = records[i];
+			if (record.vertexOffset + (uint64_t)record.vertexCount * sizeof(Vertex) > size ||
+				record.indexOffset + (uint64_t)record.indexCount * sizeof(unsigned int) > size ||
+				record.lodOffset + (uint64_t)record.lodCount * sizeof(Mesh::LodLevel) + (uint64_t)record.lodIndexCount * sizeof(unsigned int) > size ||
+				(uint64_t)record.firstTexture + record.textureCount > header.textureCount)
+				return false;
+			const Mesh::LodLevel* levels = reinterpret_cast<const Mesh::LodLevel*>(base + record.lodOffset);
+			for (uint32_t level = 0; level < record.lodCount; level++) {
+				if (levels[level].firstIndex < record.indexCount ||
+					(uint64_t)levels[level].firstIndex + levels[level].indexCount > (uint64_t)record.indexCount + record.lodIndexCount)
+					return false;
+			}
+			// A damaged blob must not reach the GPU as out-of-range vertex fetches
+			if (!IndicesInRange(reinterpret_cast<const unsigned int*>(base + record.indexOffset), record.indexCount, record.vertexCount) ||
+				!IndicesInRange(reinterpret_cast<const unsigned int*>(levels + record.lodCount), record.lodIndexCount, record.vertexCount))
+				return false;
+			for (uint32_t t = 0; t < record.textureCount; t++) {
+				const TextureRecord& texture = textureRecords[record.firstTexture + t];
+				if ((uint64_t)texture.typeOffset + texture.typeLength > header.stringsSize ||
+					(uint64_t)texture.pathOffset + texture.pathLength > header.stringsSize)
+					return false;
+			}
+		}
+
+		std::vector<Mesh> meshes;
+		meshes.reserve(header.meshCount);
+		std::vector<Texture> textures;
+		for (uint32_t i = 0; i < header.meshCount; i++) {
+			const MeshRecord& record = records[i];
+			textures.clear();
+			for (uint32_t t = 0; t < record.textureCount; t++) {
+				const TextureRecord& texture = textureRecords[record.firstTexture + t];
+				textures.push_back(_loadTexture(std::string(strings + texture.typeOffset, texture.typeLength),
+					std::string(strings + texture.pathOffset, texture.pathLength)));
+			}
+			const Mesh::LodLevel* levels = reinterpret_cast<const Mesh::LodLevel*>(base + record.lodOffset);
+			meshes.emplace_back(
+				reinterpret_cast<const Vertex*>(base + record.vertexOffset), record.vertexCount,
+				reinterpret_cast<const unsigned int*>(base + record.indexOffset), record.indexCount,
+				textures, record.hasTangentAndBitangent != 0,
+				glm::vec3(record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]),
+				glm::vec3(record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]),
+				reinterpret_cast<const unsigned int*>(levels + record.lodCount), record.lodIndexCount,
+				std::vector<Mesh::LodLevel>(levels, levels + record.lodCount),
+				_createBuffers);
+		}
+
+		for (Mesh& mesh : meshes)
+			_meshes.emplace_back(std::move(mesh));
+		return true;
+	}
+
+	// Writes the cache file of _sourcePath from freshly imported meshes
+	void Store(const std::string& _sourcePath, const std::vector<Mesh>& _meshes) const
+	{
+		Header header;
+		header.meshCount = (uint32_t)_meshes.size();
+		header.stages = EnabledStages();
+		SourceStamp(_sourcePath, header.sourceSize, header.sourceTime);
+
+		std::vector<MeshRecord> records(_meshes.size());
+		std::vector<TextureRecord> textureRecords;
+		std::string strings;
+		for (size_t i = 0; i < _meshes.size(); i++) {
+			const Mesh& mesh = _meshes[i];
+			MeshRecord& record = records[i];
+			record.vertexCount = (uint32_t)mesh.vertices.size();
+			record.indexCount = (uint32_t)mesh.indices.size();
+			record.firstTexture = (uint32_t)textureRecords.size();
+			record.textureCount = (uint32_t)mesh.textures.size();
+			record.hasTangentAndBitangent = mesh.HasTangentAndBitangent() ? 1 : 0;
+			record.lodCount = (uint32_t)(mesh.GetLodCount() - 1);
+			record.lodIndexCount = (uint32_t)mesh.lodIndices.size();
+			for (int axis = 0; axis < 3; axis++) {
+				record.boundsMin[axis] = mesh.GetBoundsMin()[axis];
+				record.boundsMax[axis] = mesh.GetBoundsMax()[axis];
+			}
+			for (const Texture& texture : mesh.textures) {
+				TextureRecord textureRecord;
+				textureRecord.typeOffset = (uint32_t)strings.size();
+				textureRecord.typeLength = (uint32_t)texture.type.size();
+				strings += texture.type;
+				textureRecord.pathOffset = (uint32_t)strings.size();
+				textureRecord.pathLength = (uint32_t)texture.path.size();
+				strings += texture.path;
+				textureRecords.push_back(textureRecord);
+			}
+		}
+		header.textureCount = (uint32_t)textureRecords.size();
+		header.stringsOffset = sizeof(Header) + records.size() * sizeof(MeshRecord) + textureRecords.size() * sizeof(TextureRecord);
+		header.stringsSize = strings.size();
+
+		uint64_t offset = Align(header.stringsOffset + header.stringsSize);
+		for (MeshRecord& record : records) {
+			record.vertexOffset = offset;
+			offset = Align(offset + (uint64_t)record.vertexCount * sizeof(Vertex));
+			record.indexOffset = offset;
+			offset = Align(offset + (uint64_t)record.indexCount * sizeof(unsigned int));
+			record.lodOffset = offset;
+			offset = Align(offset + (uint64_t)record.lodCount * sizeof(Mesh::LodLevel) + (uint64_t)record.lodIndexCount * sizeof(unsigned int));
+		}
+
+		std::ofstream file(PathFor(_sourcePath), std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+#ifdef _DEBUG
+			std::cerr << "Mesh cache: failed to write " << PathFor(_sourcePath) << "\n";
+#endif
+			return;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(MeshRecord));
+		file.write(reinterpret_cast<const char*>(textureRecords.data()), textureRecords.size() * sizeof(TextureRecord));
+		file.write(strings.data(), strings.size());
+		for (size_t i = 0; i < _meshes.size(); i++) {
+			Pad(file, records[i].vertexOffset);
+			file.write(reinterpret_cast<const char*>(_meshes[i].vertices.data()), _meshes[i].vertices.size() * sizeof(Vertex));
+			Pad(file, records[i].indexOffset);
+			file.write(reinterpret_cast<const char*>(_meshes[i].indices.data()), _meshes[i].indices.size() * sizeof(unsigned int));
+			Pad(file, records[i].lodOffset);
+			for (uint32_t level = 1; level <= records[i].lodCount; level++) {
+				Mesh::LodLevel lod = _meshes[i].GetLod(level);
+				file.write(reinterpret_cast<const char*>(&lod), sizeof(lod));
+			}
+			file.write(reinterpret_cast<const char*>(_meshes[i].lodIndices.data()), _meshes[i].lodIndices.size() * sizeof(unsigned int));
+		}
+	}
+
+	void Record(const std::string& _label, bool _hit, float _milliseconds)
+	{
+		Stats& entry = stats[_label];
+		if (_hit) {
+			entry.hits++;
+			entry.hitMilliseconds += _milliseconds;
+		}
+		else {
+			entry.misses++;
+			entry.missMilliseconds += _milliseconds;
+		}
+	}
+
+	const std::map<std::string, Stats>& GetStats() const { return stats; }
+
+	void PrintStats() const
+	{
+		std::cout << "Mesh cache (" << (enabled ? "enabled" : "disabled") << "):\n";
+		for (const auto& [label, entry] : stats) {
+			std::cout << "  " << label << ": " << entry.hits << " hit(s) " << entry.hitMilliseconds << " ms, "
+				<< entry.misses << " miss(es) " << entry.missMilliseconds << " ms\n";
+		}
+	}
+
+private:
+	MeshCache() = default;
+
+	struct Header
+	{
+		uint32_t magic = kMagic;
+		uint32_t version = kVersion;
+		uint32_t vertexStride = sizeof(Vertex);
+		uint32_t meshCount = 0;
+		uint32_t textureCount = 0;
+		uint32_t stages = 0; // EnabledStages() of the import that wrote the file
+		uint64_t sourceSize = 0;
+		int64_t sourceTime = 0;
+		uint64_t stringsOffset = 0;
+		uint64_t stringsSize = 0;
+	};
+
+	struct MeshRecord
+	{
+		uint64_t vertexOffset = 0;
+		uint64_t indexOffset = 0;
+		uint32_t vertexCount = 0;
+		uint32_t indexCount = 0;
+		uint32_t firstTexture = 0;
+		uint32_t textureCount = 0;
+		uint32_t hasTangentAndBitangent = 0;
+		float boundsMin[3] = {};
+		float boundsMax[3] = {};
+		uint32_t lodCount = 0; // levels after the full mesh
+		uint64_t lodOffset = 0;
+		uint32_t lodIndexCount = 0;
+		uint32_t reserved = 0;
+	};
+
+	struct TextureRecord
+	{
+		uint32_t typeOffset = 0; // into the string blob
+		uint32_t typeLength = 0;
+		uint32_t pathOffset = 0;
+		uint32_t pathLength = 0;
+	};
+
+	static constexpr uint32_t kMagic = 0x4D524250; // "PBRM"
+	static constexpr uint32_t kVersion = 5; // 2: meshes are stored after MeshOptimizer, 3: LOD chains, 4: generated tangents, 5: stage flags
+
+	// Import stages whose output is baked into the cached meshes
+	static constexpr uint32_t kStageOptimizer = 1u << 0;
+	static constexpr uint32_t kStageSimplifier = 1u << 1;
+	static constexpr uint32_t kStageTangents = 1u << 2;
+
+	static uint32_t EnabledStages()
+	{
+		return (MeshOptimizer::IsEnabled() ? kStageOptimizer : 0u) |
+			(MeshSimplifier::IsEnabled() ? kStageSimplifier : 0u) |
+			(TangentGenerator::IsEnabled() ? kStageTangents : 0u);
+	}
+
+	static bool IndicesInRange(const unsigned int* _indices, size_t _count, uint32_t _vertexCount)
+	{
+		for (size_t i = 0; i < _count; i++) {
+			if (_indices[i] >= _vertexCount)
+				return false;
+		}
+		return true;
+	}
+	static constexpr uint64_t kBlobAlignment = 16;
+
+	static uint64_t Align(uint64_t _offset) { return (_offset + kBlobAlignment - 1) / kBlobAlignment * kBlobAlignment; }
+
+	static void Pad(std::ofstream& _file, uint64_t _offset)
+	{
+		static const char zeros[kBlobAlignment] = {};
+		uint64_t position = (uint64_t)_file.tellp();
+		if (position < _offset)
+			_file.write(zeros, (std::streamsize)(_offset - position));
+	}
+
+	static void SourceStamp(const std::string& _sourcePath, uint64_t& _size, int64_t& _time)
+	{
+		std::error_code error;
+		_size = (uint64_t)std::filesystem::file_size(_sourcePath, error);
+		if (error)
+			_size = 0;
+		_time = (int64_t)std::filesystem::last_write_time(_sourcePath, error).time_since_epoch().count();
+		if (error)
+			_time = 0;
+	}
+
+	static bool MatchesSource(const Header& _header, const std::string& _sourcePath)
+	{
+		uint64_t size = 0;
+		int64_t time = 0;
+		SourceStamp(_sourcePath, size, time);
+		return _header.sourceSize == size && _header.sourceTime == time;
+	}
+
+private:
+	bool enabled = true;
+	std::map<std::string, Stats> stats; // per source path
+};
@@ -0,0 +1,355 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+
+// Post-import optimization of indexed triangle meshes, run once before a mesh is uploaded (and
+// cached, see mesh_cache.h):
+//   1. weld      merges bit-identical vertices (Assimp hands out three vertices per triangle)
+//   2. cache     Tipsify triangle order for post-transform vertex cache locality
+//   3. overdraw  Tipsify clusters sorted outward facing first, kept only while ACMR stays within
+//                kOverdrawThreshold of the cache-optimized order
+//   4. fetch     vertices renumbered in first-use order, unreferenced ones dropped
+//
+// SplitForIndexLimit() optionally cuts the result into parts that fit 16-bit indices.
+//
+// Usage:
+//   MeshOptimizer::Report report = MeshOptimizer::Optimize(vertices, indices);
+//   report.Print(std::cout);
+class MeshOptimizer
+{
+public:
+	static constexpr unsigned int kCacheSize = 16;      // simulated FIFO post-transform cache
+	static constexpr float kOverdrawThreshold = 1.05f; // allowed ACMR growth for the overdraw order
+
+	// ACMR: vertex shader invocations per triangle (0.5 ideal for large grids, 3 worst)
+	// ATVR: vertex shader invocations per vertex (1 ideal)
+	struct CacheStats
+	{
+		float acmr = 0.0f;
+		float atvr = 0.0f;
+	};
+
+	struct Report
+	{
+		size_t verticesBefore = 0;
+		size_t verticesAfter = 0;
+		size_t triangles = 0;
+		CacheStats before;
+		CacheStats after;
+		bool overdrawOrder = false; // cluster order kept
+		float milliseconds = 0.0f;
+
+		void Print(std::ostream& _out) const
+		{
+			_out << "  " << triangles << " triangles, vertices " << verticesBefore << " -> " << verticesAfter
+				<< ", ACMR " << before.acmr << " -> " << after.acmr
+				<< ", ATVR " << before.atvr << " -> " << after.atvr
+				<< (overdrawOrder ? ", overdraw order" : "") << ", " << milliseconds << " ms\n";
+		}
+	};
+
+	static void SetEnabled(bool _enabled) { EnabledFlag() = _enabled; }
+	static bool IsEnabled() { return EnabledFlag(); }
+
+	static Report Optimize(std::vector<Vertex>& _vertices, std::vector<unsigned int>& _indices)
+	{
+		auto start = std::chrono::steady_clock::now();
+		Report report;
+		report.verticesBefore = _vertices.size();
+		report.triangles = _indices.size() / 3;
+		report.before = AnalyzeVertexCache(_indices, _vertices.size());
+
+		WeldVertices(_vertices, _indices);
+
+		std::vector<unsigned int> clusters;
+		std::vector<unsigned int> cacheOrder = OptimizeVertexCache(_indices, _vertices.size(), &clusters);
+		float cacheAcmr = AnalyzeVertexCache(cacheOrder, _vertices.size()).acmr;
+		std::vector<unsigned int> overdrawOrder = OptimizeOverdraw(cacheOrder, _vertices, clusters);
+		report.overdrawOrder = AnalyzeVertexCache(overdrawOrder, _vertices.size()).acmr <= cacheAcmr * kOverdrawThreshold;
+		_indices.swap(report.overdrawOrder ? overdrawOrder : cacheOrder);
+
+		OptimizeVertexFetch(_vertices, _indices);
+
+		report.verticesAfter = _vertices.size();
+		report.after = AnalyzeVertexCache(_indices, _vertices.size());
+		report.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return report;
+	}
+
+	static CacheStats AnalyzeVertexCache(const std::vector<unsigned int>& _indices, size_t _vertexCount)
+	{
+		CacheStats stats;
+		if (_indices.empty() || _vertexCount == 0)
+			return stats;
+
+		// FIFO: a vertex is a hit while fewer than kCacheSize misses happened since its own miss
+		std::vector<size_t> missTime(_vertexCount, 0);
+		size_t misses = 0;
+		for (unsigned int index : _indices) {
+			if (missTime[index] == 0 || misses - missTime[index] >= kCacheSize)
+				missTime[index] = ++misses;
+		}
+		stats.acmr = (float)misses / (_indices.size() / 3);
+		stats.atvr = (float)misses / _vertexCount;
+		return stats;
+	}
+
+	// Merges vertices whose bytes are identical and rewrites the indices
+	static void WeldVertices(std::vector<Vertex>& _vertices, std::vector<unsigned int>& _indices)
+	{
+		struct VertexHash
+		{
+			size_t operator()(const Vertex& _vertex) const
+			{
+				const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&_vertex);
+				uint64_t hash = 14695981039346656037ull; // 64-bit FNV-1a
+				for (size_t i = 0; i < sizeof(Vertex); i++) {
+					hash ^= bytes[i];
+					hash *= 1099511628211ull;
+				}
+				return (size_t)hash;
+			}
+		};
+		struct VertexEqual
+		{
+			bool operator()(const Vertex& _a, const Vertex& _b) const { return std::memcmp(&_a, &_b, sizeof(Vertex)) == 0; }
+		};
+
+		std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> unique;
+		unique.reserve(_vertices.size());
+		std::vector<unsigned int> remap(_vertices.size());
+		std::vector<Vertex> welded;
+		welded.reserve(_vertices.size());
+		for (size_t i = 0; i < _vertices.size(); i++) {
+			auto result = unique.emplace(_vertices[i], (unsigned int)welded.size());
+			if (result.second)
+				welded.push_back(_vertices[i]);
+			remap[i] = result.first->second;
+		}
+		for (unsigned int& index : _indices)
+			index = remap[index];
+		_vertices.swap(welded);
+	}
+
+	// Tipsify (Sander, Nehab, Barczak 2007). Fans around the vertex that is most likely still in the
+	// cache, falling back to a dead-end stack of recently used vertices. _clusters receives the
+	// triangle index where each fan sequence restarts from the dead-end stack.
+	static std::vector<unsigned int> OptimizeVertexCache(const std::vector<unsigned int>& _indices, size_t _vertexCount,
+		std::vector<unsigned int>* _clusters = nullptr)
+	{
+		const size_t triangleCount = _indices.size() / 3;
+		std::vector<unsigned int> result;
+		result.reserve(_indices.size());
+		if (_clusters)
+			_clusters->clear();
+		if (triangleCount == 0)
+			return result;
+
+		// Vertex -> triangles adjacency
+		std::vector<unsigned int> live(_vertexCount, 0);
+		for (unsigned int index : _indices)
+			live[index]++;
+		std::vector<unsigned int> offsets(_vertexCount + 1, 0);
+		for (size_t v = 0; v < _vertexCount; v++)
+			offsets[v + 1] = offsets[v] + live[v];
+		std::vector<unsigned int> adjacency(_indices.size());
+		std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < _indices.size(); i++)
+			adjacency[fill[_indices[i]]++] = (unsigned int)(i / 3);
+
+		std::vector<unsigned int> cacheTime(_vertexCount, 0);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<unsigned int> deadEnd;
+		std::vector<unsigned int> candidates;
+		unsigned int time = kCacheSize + 1;
+		size_t cursor = 0;
+		long long fan = 0;
+		bool restart = true;
+
+		while (fan >= 0) {
+			unsigned int firstTriangle = (unsigned int)(result.size() / 3);
+			if (restart && _clusters && (_clusters->empty() || _clusters->back() != firstTriangle))
+				_clusters->push_back(firstTriangle);
+
+			candidates.clear();
+			for (unsigned int a = offsets[fan]; a < offsets[fan + 1]; a++) {
+				unsigned int triangle = adjacency[a];
+				if (emitted[triangle])
+					continue;
+				for (int corner = 0; corner < 3; corner++) {
+					unsigned int v = _indices[triangle * 3 + corner];
+					result.push_back(v);
+					deadEnd.push_back(v);
+					candidates.push_back(v);
+					live[v]--;
+					if (time - cacheTime[v] > kCacheSize)
+						cacheTime[v] = time++;
+				}
+				emitted[triangle] = true;
+			}
+
+			// Next fan: the candidate with the highest cache priority whose fan fits in the cache
+			long long next = -1;
+			int best = -1;
+			for (unsigned int v : candidates) {
+				if (live[v] == 0)
+					continue;
+				int priority = 0;
+				if (time - cacheTime[v] + 2 * live[v] <= kCacheSize)
+					priority = (int)(time - cacheTime[v]);
+				if (priority > best) {
+					best = priority;
+					next = v;
+				}
+			}
+			restart = (next < 0);
+			if (next < 0)
+				next = SkipDeadEnd(live, deadEnd, cursor, _vertexCount);
+			fan = next;
+		}
+		return result;
+	}
+
+	// Sorts the clusters (triangle ranges starting at _clusters) so that the ones facing away from
+	// the mesh center come first, they tend to occlude the rest from most view directions.
+	static std::vector<unsigned int> OptimizeOverdraw(const std::vector<unsigned int>& _indices, const std::vector<Vertex>& _vertices,
+		const std::vector<unsigned int>& _clusters)
+	{
+		const size_t triangleCount = _indices.size() / 3;
+		if (_clusters.size() < 2)
+			return _indices;
+
+		glm::vec3 meshCenter(0.0f);
+		float meshArea = 0.0f;
+		std::vector<float> sortKeys(_clusters.size());
+		std::vector<glm::vec3> centers(_clusters.size(), glm::vec3(0.0f));
+		std::vector<glm::vec3> normals(_clusters.size(), glm::vec3(0.0f));
+		std::vector<float> areas(_clusters.size(), 0.0f);
+		for (size_t c = 0; c < _clusters.size(); c++) {
+			size_t end = (c + 1 < _clusters.size()) ? _clusters[c + 1] : triangleCount;
+			for (size_t t = _clusters[c]; t < end; t++) {
+				const glm::vec3& p0 = _vertices[_indices[t * 3 + 0]].position;
+				const glm::vec3& p1 = _vertices[_indices[t * 3 + 1]].position;
+				const glm::vec3& p2 = _vertices[_indices[t * 3 + 2]].position;
+				glm::vec3 normal = glm::cross(p1 - p0, p2 - p0); // length is twice the area
+				float area = glm::length(normal);
+				centers[c] += (p0 + p1 + p2) * (area / 3.0f);
+				normals[c] += normal;
+				areas[c] += area;
+			}
+			meshCenter += centers[c];
+			meshArea += areas[c];
+		}
+		if (meshArea > 0.0f)
+			meshCenter /= meshArea;
+
+		for (size_t c = 0; c < _clusters.size(); c++) {
+			glm::vec3 center = areas[c] > 0.0f ? centers[c] / areas[c] : meshCenter;
+			float length = glm::length(normals[c]);
+			sortKeys[c] = length > 0.0f ? glm::dot(center - meshCenter, normals[c] / length) : 0.0f;
+		}
+
+		std::vector<unsigned int> order(_clusters.size());
+		std::iota(order.begin(), order.end(), 0u);
+		std::stable_sort(order.begin(), order.end(), [&sortKeys](unsigned int _a, unsigned int _b) { return sortKeys[_a] > sortKeys[_b]; });
+
+		std::vector<unsigned int> result;
+		result.reserve(_indices.size());
+		for (unsigned int c : order) {
+			size_t end = (c + 1 < _clusters.size()) ? _clusters[c + 1] : triangleCount;
+			result.insert(result.end(), _indices.begin() + _clusters[c] * 3, _indices.begin() + end * 3);
+		}
+		return result;
+	}
+
+	// Renumbers the vertices in the order the index buffer first uses them, drops unused ones
+	static void OptimizeVertexFetch(std::vector<Vertex>& _vertices, std::vector<unsigned int>& _indices)
+	{
+		const unsigned int kUnused = ~0u;
+		std::vector<unsigned int> remap(_vertices.size(), kUnused);
+		std::vector<Vertex> ordered;
+		ordered.reserve(_vertices.size());
+		for (unsigned int& index : _indices) {
+			if (remap[index] == kUnused) {
+				remap[index] = (unsigned int)ordered.size();
+				ordered.push_back(_vertices[index]);
+			}
+			index = remap[index];
+		}
+		_vertices.swap(ordered);
+	}
+
+	struct Part
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+	};
+
+	// Cuts the triangle list, in order, into parts of at most _maxVertices vertices each, so every
+	// part can be drawn with 16-bit indices. Runs after the other steps, which keeps the parts
+	// spatially coherent and their cache order intact.
+	static std::vector<Part> SplitForIndexLimit(const std::vector<Vertex>& _vertices, const std::vector<unsigned int>& _indices,
+		size_t _maxVertices = 65536)
+	{
+		const unsigned int kUnused = ~0u;
+		std::vector<Part> parts(1);
+		std::vector<unsigned int> remap(_vertices.size(), kUnused);
+		std::vector<unsigned int> touched; // remap entries set for the current part
+		for (size_t t = 0; t + 2 < _indices.size(); t += 3) {
+			size_t added = 0;
+			for (size_t k = 0; k < 3; k++)
+				added += remap[_indices[t + k]] == kUnused;
+			if (parts.back().vertices.size() + added > _maxVertices) {
+				for (unsigned int index : touched)
+					remap[index] = kUnused;
+				touched.clear();
+				parts.emplace_back();
+			}
+
+			Part& part = parts.back();
+			for (size_t k = 0; k < 3; k++) {
+				unsigned int index = _indices[t + k];
+				if (remap[index] == kUnused) {
+					remap[index] = (unsigned int)part.vertices.size();
+					part.vertices.push_back(_vertices[index]);
+					touched.push_back(index);
+				}
+				part.indices.push_back(remap[index]);
+			}
+		}
+		return parts;
+	}
+
+private:
+	static bool& EnabledFlag()
+	{
+		static bool enabled = true;
+		return enabled;
+	}
+
+	static long long SkipDeadEnd(const std::vector<unsigned int>& _live, std::vector<unsigned int>& _deadEnd, size_t& _cursor, size_t _vertexCount)
+	{
+		while (!_deadEnd.empty()) {
+			unsigned int v = _deadEnd.back();
+			_deadEnd.pop_back();
+			if (_live[v] > 0)
+				return v;
+		}
+		for (; _cursor < _vertexCount; _cursor++) {
+			if (_live[_cursor] > 0)
+				return (long long)_cursor;
+		}
+		return -1;
+	}
+};
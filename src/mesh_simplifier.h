@@ -0,0 +1,472 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+#include "mesh_optimizer.h"
+
+// Quadric error metric simplification (Garland, Heckbert 1997) of indexed triangle meshes, used to
+// build the LOD chain of a Mesh at import time (stored in the mesh cache with the mesh).
+//
+// Edges collapse onto one of their existing vertices, so every level indexes the vertex buffer of
+// the full mesh and only adds an index range. Vertices are classified first:
+//   manifold  unique position, closed fan          may collapse onto any neighbor
+//   border    on an open boundary                  only along the boundary, onto a border vertex
+//   seam      position shared by exactly two       only along the seam, together with its twin
+//             vertices (UV or normal split)        vertex, so both sides stay stitched
+//   locked    anything else (corners, T-junctions) never moves
+// Border and seam edges also add a quadric perpendicular to their triangle, which keeps them from
+// drifting inward.
+//
+// Errors are distances relative to the diagonal of the mesh bounds, a level with error e is off
+// by about e * (size of the mesh on screen) pixels.
+//
+// Usage:
+//   std::vector<unsigned int> lodIndices;
+//   std::vector<Mesh::LodLevel> levels;
+//   MeshSimplifier::BuildLodChain(vertices, indices, lodIndices, levels);
+//   mesh.SetLods(std::move(lodIndices), std::move(levels));
+class MeshSimplifier
+{
+public:
+	static constexpr int kMaxLevels = 3;         // levels after the full mesh
+	static constexpr float kLevelRatio = 0.5f;   // triangles of a level relative to the previous one
+	static constexpr float kMaxError = 0.05f;    // coarser levels are not built
+	static constexpr float kMinReduction = 0.8f; // a level must drop at least 20% of the previous one's triangles
+
+	static void SetEnabled(bool _enabled) { EnabledFlag() = _enabled; }
+	static bool IsEnabled() { return EnabledFlag(); }
+
+	// Levels 1.. of _indices, each with about kLevelRatio of the previous level's triangles.
+	// _lodIndices receives the levels back to back, LodLevel::firstIndex counts from the end of
+	// _indices (level 0), as the levels follow it in the mesh's index buffer.
+	static void BuildLodChain(const std::vector<Vertex>& _vertices, const std::vector<unsigned int>& _indices,
+		std::vector<unsigned int>& _lodIndices, std::vector<Mesh::LodLevel>& _levels)
+	{
+		_lodIndices.clear();
+		_levels.clear();
+		std::vector<size_t> targets;
+		size_t target = _indices.size();
+		for (int level = 0; level < kMaxLevels; level++) {
+			target = (size_t)(target / 3 * kLevelRatio) * 3;
+			if (target < 3)
+				break;
+			targets.push_back(target);
+		}
+
+		std::vector<std::vector<unsigned int>> levels;
+		std::vector<float> errors;
+		Simplify(_vertices, _indices, targets, kMaxError, levels, errors);
+
+		size_t previous = _indices.size();
+		for (size_t i = 0; i < levels.size(); i++) {
+			std::vector<unsigned int>& level = levels[i];
+			if (level.empty() || level.size() > previous * kMinReduction)
+				break;
+			if (MeshOptimizer::IsEnabled())
+				level = MeshOptimizer::OptimizeVertexCache(level, _vertices.size());
+			_levels.push_back({ (uint32_t)(_indices.size() + _lodIndices.size()), (uint32_t)level.size(), errors[i] });
+			_lodIndices.insert(_lodIndices.end(), level.begin(), level.end());
+			previous = level.size();
+		}
+	}
+
+	// Collapses edges of _indices until the index count falls to each of _targets (descending) or
+	// the next collapse would exceed _maxError. _levels receives the indices at every target reached
+	// and _errors their error, both stop at the first target that cannot be reached.
+	static void Simplify(const std::vector<Vertex>& _vertices, const std::vector<unsigned int>& _indices,
+		const std::vector<size_t>& _targets, float _maxError,
+		std::vector<std::vector<unsigned int>>& _levels, std::vector<float>& _errors)
+	{
+		_levels.clear();
+		_errors.clear();
+		const size_t vertexCount = _vertices.size();
+		if (_targets.empty() || vertexCount == 0 || _indices.size() < 3)
+			return;
+
+		// Positions scaled so that the bounds diagonal is 1, errors come out relative to it
+		glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+		for (const Vertex& vertex : _vertices) {
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+		float diagonal = glm::length(boundsMax - boundsMin);
+		float scale = diagonal > 0.0f ? 1.0f / diagonal : 1.0f;
+		std::vector<glm::vec3> positions(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+			positions[i] = (_vertices[i].position - boundsMin) * scale;
+
+		std::vector<unsigned int> remap, wedge;
+		BuildPositionRemap(_vertices, remap, wedge);
+
+		std::vector<unsigned int> indices = _indices;
+		std::vector<unsigned char> kinds;
+		std::vector<unsigned int> borderNext, borderPrevious;
+		ClassifyVertices(indices, remap, wedge, kinds, borderNext, borderPrevious);
+
+		std::vector<Quadric> quadrics(vertexCount);
+		FillQuadrics(indices, positions, remap, kinds, borderNext, quadrics);
+
+		const float maxCost = _maxError * _maxError;
+		float error = 0.0f;
+		size_t level = 0;
+		std::vector<Collapse> candidates;
+		std::vector<unsigned int> collapseTarget(vertexCount);
+		std::vector<unsigned char> touched(vertexCount);
+		std::vector<unsigned int> adjacencyOffsets, adjacency;
+
+		while (level < _targets.size()) {
+			while (level < _targets.size() && indices.size() <= _targets[level]) {
+				_levels.push_back(indices);
+				_errors.push_back(error);
+				level++;
+			}
+			if (level == _targets.size())
+				break;
+
+			// Candidate collapses, the cheaper direction of every edge that may collapse at all
+			candidates.clear();
+			for (size_t t = 0; t < indices.size(); t += 3) {
+				for (int k = 0; k < 3; k++) {
+					unsigned int a = indices[t + k], b = indices[t + (k + 1) % 3];
+					bool ab = CanCollapse(a, b, kinds, remap, wedge, borderNext, borderPrevious);
+					bool ba = CanCollapse(b, a, kinds, remap, wedge, borderNext, borderPrevious);
+					if (!ab && !ba)
+						continue;
+					float costAB = ab ? CollapseCost(quadrics[remap[a]], positions[b]) : FLT_MAX;
+					float costBA = ba ? CollapseCost(quadrics[remap[b]], positions[a]) : FLT_MAX;
+					if (costAB <= costBA)
+						candidates.push_back({ a, b, costAB });
+					else
+						candidates.push_back({ b, a, costBA });
+				}
+			}
+			std::sort(candidates.begin(), candidates.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+			BuildAdjacency(indices, vertexCount, adjacencyOffsets, adjacency);
+			for (size_t i = 0; i < vertexCount; i++)
+				collapseTarget[i] = (unsigned int)i;
+			std::fill(touched.begin(), touched.end(), 0);
+
+			// Each collapse removes about two triangles, take the cheapest ones that leave the
+			// neighborhoods of earlier collapses in this pass alone
+			size_t trianglesToRemove = (indices.size() - _targets[level]) / 3;
+			size_t collapses = 0;
+			for (const Collapse& collapse : candidates) {
+				if (collapses * 2 >= trianglesToRemove || collapse.cost > maxCost)
+					break;
+				unsigned int from = collapse.from, to = collapse.to;
+				if (touched[remap[from]] || touched[remap[to]])
+					continue;
+				if (Flips(from, to, indices, positions, adjacencyOffsets, adjacency))
+					continue;
+
+				unsigned int twinFrom = from, twinTo = to;
+				if (kinds[from] == kSeam) {
+					twinFrom = wedge[from];
+					twinTo = wedge[to];
+					if (Flips(twinFrom, twinTo, indices, positions, adjacencyOffsets, adjacency))
+						continue;
+				}
+
+				collapseTarget[from] = to;
+				collapseTarget[twinFrom] = twinTo;
+				if (kinds[from] != kManifold) {
+					UnlinkOpenEdge(from, to, borderNext, borderPrevious);
+					if (twinFrom != from)
+						UnlinkOpenEdge(twinFrom, twinTo, borderNext, borderPrevious);
+				}
+				quadrics[remap[to]].Add(quadrics[remap[from]]);
+				touched[remap[from]] = touched[remap[to]] = 1;
+				error = std::max(error, std::sqrt(std::max(collapse.cost, 0.0f)));
+				collapses++;
+			}
+			if (collapses == 0)
+				break;
+
+			// Remaps the indices and drops the triangles that became degenerate
+			size_t write = 0;
+			for (size_t t = 0; t < indices.size(); t += 3) {
+				unsigned int a = collapseTarget[indices[t]], b = collapseTarget[indices[t + 1]], c = collapseTarget[indices[t + 2]];
+				if (a == b || b == c || c == a)
+					continue;
+				indices[write++] = a;
+				indices[write++] = b;
+				indices[write++] = c;
+			}
+			indices.resize(write);
+		}
+	}
+
+private:
+	enum : unsigned char { kManifold, kBorder, kSeam, kLocked };
+
+	// Symmetric 4x4 quadric, area weighted
+	struct Quadric
+	{
+		float a2 = 0, b2 = 0, c2 = 0, ab = 0, ac = 0, bc = 0, ad = 0, bd = 0, cd = 0, d2 = 0;
+		float weight = 0;
+
+		static Quadric FromPlane(const glm::vec3& _normal, float _d, float _weight)
+		{
+			Quadric q;
+			q.a2 = _normal.x * _normal.x * _weight;
+			q.b2 = _normal.y * _normal.y * _weight;
+			q.c2 = _normal.z * _normal.z * _weight;
+			q.ab = _normal.x * _normal.y * _weight;
+			q.ac = _normal.x * _normal.z * _weight;
+			q.bc = _normal.y * _normal.z * _weight;
+			q.ad = _normal.x * _d * _weight;
+			q.bd = _normal.y * _d * _weight;
+			q.cd = _normal.z * _d * _weight;
+			q.d2 = _d * _d * _weight;
+			q.weight = _weight;
+			return q;
+		}
+
+		void Add(const Quadric& _other)
+		{
+			a2 += _other.a2; b2 += _other.b2; c2 += _other.c2;
+			ab += _other.ab; ac += _other.ac; bc += _other.bc;
+			ad += _other.ad; bd += _other.bd; cd += _other.cd;
+			d2 += _other.d2;
+			weight += _other.weight;
+		}
+
+		// Weighted sum of squared distances of _p to the planes
+		float Evaluate(const glm::vec3& _p) const
+		{
+			float x = _p.x, y = _p.y, z = _p.z;
+			return a2 * x * x + b2 * y * y + c2 * z * z + 2.0f * (ab * x * y + ac * x * z + bc * y * z)
+				+ 2.0f * (ad * x + bd * y + cd * z) + d2;
+		}
+	};
+
+	struct Collapse
+	{
+		unsigned int from;
+		unsigned int to;
+		float cost; // squared relative distance
+	};
+
+	static bool& EnabledFlag()
+	{
+		static bool enabled = true;
+		return enabled;
+	}
+
+	static float CollapseCost(const Quadric& _quadric, const glm::vec3& _position)
+	{
+		return _quadric.weight > 0.0f ? std::fabs(_quadric.Evaluate(_position)) / _quadric.weight : 0.0f;
+	}
+
+	static uint64_t EdgeKey(unsigned int _a, unsigned int _b) { return ((uint64_t)_a << 32) | _b; }
+
+	// remap: first vertex with the same position, wedge: next vertex with the same position (cyclic)
+	static void BuildPositionRemap(const std::vector<Vertex>& _vertices, std::vector<unsigned int>& _remap, std::vector<unsigned int>& _wedge)
+	{
+		struct PositionHash
+		{
+			size_t operator()(const glm::vec3& _p) const
+			{
+				uint32_t bits[3];
+				std::memcpy(bits, &_p, sizeof(bits));
+				return (size_t)(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+			}
+		};
+
+		const size_t vertexCount = _vertices.size();
+		_remap.resize(vertexCount);
+		_wedge.resize(vertexCount);
+		std::unordered_map<glm::vec3, unsigned int, PositionHash> firstByPosition;
+		firstByPosition.reserve(vertexCount);
+		for (unsigned int i = 0; i < (unsigned int)vertexCount; i++) {
+			auto result = firstByPosition.emplace(_vertices[i].position, i);
+			unsigned int first = result.first->second;
+			_remap[i] = first;
+			_wedge[i] = i;
+			if (first != i) {
+				_wedge[i] = _wedge[first];
+				_wedge[first] = i;
+			}
+		}
+	}
+
+	static void ClassifyVertices(const std::vector<unsigned int>& _indices, const std::vector<unsigned int>& _remap,
+		const std::vector<unsigned int>& _wedge, std::vector<unsigned char>& _kinds,
+		std::vector<unsigned int>& _borderNext, std::vector<unsigned int>& _borderPrevious)
+	{
+		const size_t vertexCount = _remap.size();
+		std::vector<uint64_t> edges, positionEdges;
+		edges.reserve(_indices.size());
+		positionEdges.reserve(_indices.size());
+		for (size_t t = 0; t < _indices.size(); t += 3) {
+			for (int k = 0; k < 3; k++) {
+				unsigned int a = _indices[t + k], b = _indices[t + (k + 1) % 3];
+				edges.push_back(EdgeKey(a, b));
+				positionEdges.push_back(EdgeKey(_remap[a], _remap[b]));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		std::sort(positionEdges.begin(), positionEdges.end());
+		auto hasEdge = [](const std::vector<uint64_t>& _set, unsigned int _a, unsigned int _b) {
+			return std::binary_search(_set.begin(), _set.end(), EdgeKey(_a, _b));
+		};
+
+		// Open edges: no opposite edge between the same two vertices
+		const unsigned int kNone = ~0u;
+		std::vector<unsigned int> openOut(vertexCount, 0), openIn(vertexCount, 0);
+		std::vector<unsigned char> seamEdges(vertexCount, 0); // open edges of the vertex that are seams
+		_borderNext.assign(vertexCount, kNone);
+		_borderPrevious.assign(vertexCount, kNone);
+		for (size_t t = 0; t < _indices.size(); t += 3) {
+			for (int k = 0; k < 3; k++) {
+				unsigned int a = _indices[t + k], b = _indices[t + (k + 1) % 3];
+				if (hasEdge(edges, b, a))
+					continue;
+				bool seam = hasEdge(positionEdges, _remap[b], _remap[a]);
+				openOut[a]++;
+				openIn[b]++;
+				_borderNext[a] = b;
+				_borderPrevious[b] = a;
+				seamEdges[a] += seam;
+				seamEdges[b] += seam;
+			}
+		}
+
+		_kinds.assign(vertexCount, kLocked);
+		for (size_t i = 0; i < vertexCount; i++) {
+			bool unique = _wedge[i] == i;
+			bool pair = !unique && _wedge[_wedge[i]] == i;
+			if (openOut[i] == 0 && openIn[i] == 0)
+				_kinds[i] = unique ? kManifold : kLocked;
+			else if (openOut[i] == 1 && openIn[i] == 1 && unique && seamEdges[i] == 0)
+				_kinds[i] = kBorder;
+			else if (openOut[i] == 1 && openIn[i] == 1 && pair && seamEdges[i] == 2)
+				_kinds[i] = kSeam;
+		}
+		// Both halves of a seam have to be able to move together
+		for (size_t i = 0; i < vertexCount; i++) {
+			if (_kinds[i] == kSeam && _kinds[_wedge[i]] != kSeam)
+				_kinds[i] = kLocked;
+		}
+	}
+
+	// Collapsing _from onto _to keeps the topology of the classified feature lines
+	static bool CanCollapse(unsigned int _from, unsigned int _to, const std::vector<unsigned char>& _kinds,
+		const std::vector<unsigned int>& _remap, const std::vector<unsigned int>& _wedge,
+		const std::vector<unsigned int>& _borderNext, const std::vector<unsigned int>& _borderPrevious)
+	{
+		if (_remap[_from] == _remap[_to])
+			return false;
+		switch (_kinds[_from]) {
+		case kManifold:
+			return true;
+		case kBorder:
+			return _kinds[_to] == kBorder && (_borderNext[_from] == _to || _borderPrevious[_from] == _to);
+		case kSeam: {
+			if (_kinds[_to] != kSeam || !(_borderNext[_from] == _to || _borderPrevious[_from] == _to))
+				return false;
+			unsigned int twinFrom = _wedge[_from], twinTo = _wedge[_to];
+			return _borderNext[twinFrom] == twinTo || _borderPrevious[twinFrom] == twinTo;
+		}
+		default:
+			return false;
+		}
+	}
+
+	// Joins the open edge chain around _from, which collapses onto its chain neighbor _to
+	static void UnlinkOpenEdge(unsigned int _from, unsigned int _to, std::vector<unsigned int>& _next, std::vector<unsigned int>& _previous)
+	{
+		if (_next[_from] == _to) {
+			unsigned int previous = _previous[_from];
+			_previous[_to] = previous;
+			if (previous != ~0u)
+				_next[previous] = _to;
+		}
+		else {
+			unsigned int next = _next[_from];
+			_next[_to] = next;
+			if (next != ~0u)
+				_previous[next] = _to;
+		}
+	}
+
+	static void FillQuadrics(const std::vector<unsigned int>& _indices, const std::vector<glm::vec3>& _positions,
+		const std::vector<unsigned int>& _remap, const std::vector<unsigned char>& _kinds,
+		const std::vector<unsigned int>& _borderNext, std::vector<Quadric>& _quadrics)
+	{
+		const float kEdgeWeight = 10.0f;
+		for (size_t t = 0; t < _indices.size(); t += 3) {
+			const glm::vec3& p0 = _positions[_indices[t]];
+			const glm::vec3& p1 = _positions[_indices[t + 1]];
+			const glm::vec3& p2 = _positions[_indices[t + 2]];
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float length = glm::length(normal);
+			if (length <= 0.0f)
+				continue;
+			normal /= length;
+			Quadric plane = Quadric::FromPlane(normal, -glm::dot(normal, p0), length * 0.5f);
+			for (int k = 0; k < 3; k++)
+				_quadrics[_remap[_indices[t + k]]].Add(plane);
+
+			// Open edges of this triangle get a plane through the edge, perpendicular to the triangle
+			for (int k = 0; k < 3; k++) {
+				unsigned int a = _indices[t + k], b = _indices[t + (k + 1) % 3];
+				if (_borderNext[a] != b || _kinds[a] == kManifold)
+					continue;
+				glm::vec3 edge = _positions[b] - _positions[a];
+				float edgeLength = glm::length(edge);
+				if (edgeLength <= 0.0f)
+					continue;
+				glm::vec3 edgeNormal = glm::normalize(glm::cross(edge, normal));
+				Quadric edgePlane = Quadric::FromPlane(edgeNormal, -glm::dot(edgeNormal, _positions[a]), edgeLength * edgeLength * kEdgeWeight);
+				_quadrics[_remap[a]].Add(edgePlane);
+				_quadrics[_remap[b]].Add(edgePlane);
+			}
+		}
+	}
+
+	// Triangles around each vertex, as triangle indices
+	static void BuildAdjacency(const std::vector<unsigned int>& _indices, size_t _vertexCount,
+		std::vector<unsigned int>& _offsets, std::vector<unsigned int>& _triangles)
+	{
+		_offsets.assign(_vertexCount + 1, 0);
+		for (unsigned int index : _indices)
+			_offsets[index + 1]++;
+		for (size_t i = 0; i < _vertexCount; i++)
+			_offsets[i + 1] += _offsets[i];
+		_triangles.resize(_indices.size());
+		std::vector<unsigned int> cursor(_offsets.begin(), _offsets.end() - 1);
+		for (size_t i = 0; i < _indices.size(); i++)
+			_triangles[cursor[_indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	// True when moving _from onto _to turns one of the triangles around _from over
+	static bool Flips(unsigned int _from, unsigned int _to, const std::vector<unsigned int>& _indices,
+		const std::vector<glm::vec3>& _positions, const std::vector<unsigned int>& _offsets, const std::vector<unsigned int>& _triangles)
+	{
+		for (unsigned int i = _offsets[_from]; i < _offsets[_from + 1]; i++) {
+			const unsigned int* triangle = &_indices[(size_t)_triangles[i] * 3];
+			if (triangle[0] == _to || triangle[1] == _to || triangle[2] == _to)
+				continue; // collapses away
+			int k = triangle[0] == _from ? 0 : (triangle[1] == _from ? 1 : 2);
+			const glm::vec3& b = _positions[triangle[(k + 1) % 3]];
+			const glm::vec3& c = _positions[triangle[(k + 2) % 3]];
+			glm::vec3 before = glm::cross(b - _positions[_from], c - _positions[_from]);
+			glm::vec3 after = glm::cross(b - _positions[_to], c - _positions[_to]);
+			if (glm::dot(before, after) <= 0.0f)
+				return true;
+		}
+		return false;
+	}
+};
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// How the levels of a mip chain are averaged
+enum class MipFilter : uint8_t
+{
+	Auto = 0,   // chosen from the file name, see MipGenerator::FilterForPath()
+	Linear = 1, // plain average per channel: metallic, roughness, AO, height, masks
+	Srgb = 2,   // color channels averaged in linear light (decoded from sRGB and encoded again), alpha plain
+	Normal = 3  // xyz decoded to [-1, 1], averaged and renormalized, further channels plain
+};
+
+// Levels 1..n of an 8-bit 2D image, level 0 stays with the caller. Level sizes follow GL's rule
+// (halved, rounded down, at least 1), rows are tightly packed.
+struct MipChain
+{
+	struct Level
+	{
+		int width;
+		int height;
+		size_t offset; // into pixels
+	};
+
+	int components = 0;
+	std::vector<Level> levels; // level 1 first
+	std::vector<unsigned char> pixels;
+
+	size_t Bytes() const { return pixels.size(); }
+};
+
+// Builds mip chains on the CPU, so textures arrive with all their levels and loading no longer
+// waits for glGenerateMipmap on the GL thread. Every level is a 2x2 box filter of the one above
+// (the last row / column of an odd size is folded into its neighbour, a 3-wide box there), the
+// filter decides how texels are averaged. Rows of a level are split over _threadCount threads, the loops work on
+// whole rows of bytes so the compiler vectorizes the Linear filter.
+//
+// Usage:
+//   MipChain chain;
+//   MipGenerator::Build(pixels, width, height, components, MipFilter::Srgb, chain);
+//   // level i + 1 is chain.pixels.data() + chain.levels[i].offset
+class MipGenerator
+{
+public:
+	// Textures get CPU-built mip chains, on by default. Off: the driver builds them (glGenerateMipmap).
+	static void SetEnabled(bool _enabled) { EnabledFlag() = _enabled; }
+	static bool IsEnabled() { return EnabledFlag(); }
+
+	// By naming convention: normal maps ("normal", "_nrm", "_ddn", "_norm") get Normal, color maps
+	// ("albedo", "diffuse", "_dif", "basecolor", "color", "_col") get Srgb, everything else Linear
+	static MipFilter FilterForPath(const std::string& _path)
+	{
+		std::string name = _path.substr(_path.find_last_of("/\\") + 1);
+		std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		for (const char* key : { "normal", "_nrm", "_ddn", "_norm" }) {
+			if (name.find(key) != std::string::npos)
+				return MipFilter::Normal;
+		}
+		for (const char* key : { "albedo", "diffuse", "_dif", "basecolor", "color", "_col" }) {
+			if (name.find(key) != std::string::npos)
+				return MipFilter::Srgb;
+		}
+		return MipFilter::Linear;
+	}
+
+	static int LevelCount(int _width, int _height)
+	{
+		int levels = 1;
+		while (_width > 1 || _height > 1) {
+			_width = std::max(1, _width / 2);
+			_height = std::max(1, _height / 2);
+			levels++;
+		}
+		return levels;
+	}
+
+	// _filter Auto is treated as Linear (there is no path here), Normal needs at least 3 components
+	static void Build(const unsigned char* _pixels, int _width, int _height, int _components, MipFilter _filter, MipChain& _chain,
+		unsigned int _threadCount = 1)
+	{
+		_chain = MipChain();
+		_chain.components = _components;
+		if (_filter == MipFilter::Auto || (_filter == MipFilter::Normal && _components < 3))
+			_filter = MipFilter::Linear;
+
+		size_t bytes = 0;
+		for (int width = _width, height = _height; width > 1 || height > 1;) {
+			width = std::max(1, width / 2);
+			height = std::max(1, height / 2);
+			_chain.levels.push_back({ width, height, bytes });
+			bytes += (size_t)width * height * _components;
+		}
+		_chain.pixels.resize(bytes);
+
+		const unsigned char* source = _pixels;
+		int sourceWidth = _width, sourceHeight = _height;
+		for (const MipChain::Level& level : _chain.levels) {
+			unsigned char* destination = _chain.pixels.data() + level.offset;
+			auto rows = [&](int _begin, int _end) {
+				DownsampleRows(source, sourceWidth, sourceHeight, destination, level.width, _components, _filter, _begin, _end);
+			};
+			// Threads only pay off for the large levels
+			unsigned int threads = std::min<unsigned int>(std::max(1u, _threadCount), (unsigned int)((size_t)level.width * level.height / kMinTexelsPerThread) + 1);
+			threads = std::min<unsigned int>(threads, (unsigned int)level.height);
+			if (threads <= 1)
+				rows(0, level.height);
+			else {
+				std::vector<std::thread> workers;
+				int perThread = (level.height + (int)threads - 1) / (int)threads;
+				for (unsigned int i = 1; i < threads; i++) {
+					int begin = (int)i * perThread, end = std::min(level.height, begin + perThread);
+					if (begin < end)
+						workers.emplace_back(rows, begin, end);
+				}
+				rows(0, std::min(level.height, perThread)); // the calling thread is one of them
+				for (std::thread& worker : workers)
+					worker.join();
+			}
+			source = destination;
+			sourceWidth = level.width;
+			sourceHeight = level.height;
+		}
+	}
+
+private:
+	static constexpr size_t kMinTexelsPerThread = 64 * 1024;
+	static constexpr int kLinearToSrgbSize = 16384;
+
+	static bool& EnabledFlag()
+	{
+		static bool enabled = true;
+		return enabled;
+	}
+
+	static const float* SrgbToLinearTable()
+	{
+		static const std::vector<float> table = []() {
+			std::vector<float> values(256);
+			for (int i = 0; i < 256; i++) {
+				float c = i / 255.0f;
+				values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			return values;
+		}();
+		return table.data();
+	}
+
+	static const unsigned char* LinearToSrgbTable()
+	{
+		static const std::vector<unsigned char> table = []() {
+			std::vector<unsigned char> values(kLinearToSrgbSize);
+			for (int i = 0; i < kLinearToSrgbSize; i++) {
+				float linear = i / (float)(kLinearToSrgbSize - 1);
+				float c = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+				values[i] = (unsigned char)std::min(255.0f, c * 255.0f + 0.5f);
+			}
+			return values;
+		}();
+		return table.data();
+	}
+
+	// Plain 2x2 average of the texels whose four sources all exist and that fold in no odd column,
+	// the channel count is a constant so the loop vectorizes. Returns the first column left for the
+	// generic path.
+	template <int Components>
+	static int AverageRow(const unsigned char* _row0, const unsigned char* _row1, unsigned char* _out, int _width, int _sourceWidth)
+	{
+		const int complete = std::min(_width, _sourceWidth / 2) - (FoldsLast(_sourceWidth) ? 1 : 0);
+		for (int x = 0; x < complete; x++) {
+			const unsigned char* a = _row0 + 2 * x * Components;
+			const unsigned char* b = _row1 + 2 * x * Components;
+			for (int c = 0; c < Components; c++)
+				_out[x * Components + c] = (unsigned char)((a[c] + a[c + Components] + b[c] + b[c + Components] + 2) >> 2);
+		}
+		return complete;
+	}
+
+	// An odd source size (other than 1) leaves a row / column that the last texel of the level folds in
+	static bool FoldsLast(int _sourceSize) { return _sourceSize > 1 && (_sourceSize & 1) != 0; }
+
+	static void DownsampleRows(const unsigned char* _source, int _sourceWidth, int _sourceHeight, unsigned char* _destination,
+		int _width, int _components, MipFilter _filter, int _rowBegin, int _rowEnd)
+	{
+		const float* toLinear = SrgbToLinearTable();
+		const unsigned char* toSrgb = LinearToSrgbTable();
+		const int colorChannels = _components == 4 || _components == 2 ? _components - 1 : _components; // alpha stays plain
+		const size_t sourceStride = (size_t)_sourceWidth * _components;
+
+		const int height = std::max(1, _sourceHeight / 2);
+		for (int y = _rowBegin; y < _rowEnd; y++) {
+			const unsigned char* rows[3] = {
+				_source + (size_t)std::min(2 * y, _sourceHeight - 1) * sourceStride,
+				_source + (size_t)std::min(2 * y + 1, _sourceHeight - 1) * sourceStride,
+				_source + (size_t)std::min(2 * y + 2, _sourceHeight - 1) * sourceStride };
+			const int rowCount = (y == height - 1 && FoldsLast(_sourceHeight)) ? 3 : 2;
+			const unsigned char* row0 = rows[0];
+			const unsigned char* row1 = rows[1];
+			unsigned char* out = _destination + (size_t)y * _width * _components;
+
+			int x = 0;
+			if (_filter == MipFilter::Linear && rowCount == 2) {
+				switch (_components) {
+				case 1: x = AverageRow<1>(row0, row1, out, _width, _sourceWidth); break;
+				case 2: x = AverageRow<2>(row0, row1, out, _width, _sourceWidth); break;
+				case 3: x = AverageRow<3>(row0, row1, out, _width, _sourceWidth); break;
+				case 4: x = AverageRow<4>(row0, row1, out, _width, _sourceWidth); break;
+				}
+				out += (size_t)x * _components;
+			}
+
+			// Everything else: the sRGB and normal filters, the folded last row / column and the edge
+			// of a 1-texel wide source. 2x2 texels, up to 3x3 where an odd row / column is folded in.
+			for (; x < _width; x++, out += _components) {
+				const int columnCount = (x == _width - 1 && FoldsLast(_sourceWidth)) ? 3 : 2;
+				const unsigned char* texels[9];
+				int count = 0;
+				for (int r = 0; r < rowCount; r++) {
+					for (int column = 0; column < columnCount; column++)
+						texels[count++] = rows[r] + (size_t)std::min(2 * x + column, _sourceWidth - 1) * _components;
+				}
+				const float weight = 1.0f / count;
+
+				int plainFrom = 0;
+				if (_filter == MipFilter::Srgb) {
+					for (int c = 0; c < colorChannels; c++) {
+						float sum = 0.0f;
+						for (int i = 0; i < count; i++)
+							sum += toLinear[texels[i][c]];
+						out[c] = toSrgb[(int)(sum * weight * (kLinearToSrgbSize - 1) + 0.5f)];
+					}
+					plainFrom = colorChannels;
+				}
+				else if (_filter == MipFilter::Normal) {
+					// Sum of the decoded normals, scaled by 255 / 2 (the scale goes away in the normalization)
+					float n[3];
+					for (int c = 0; c < 3; c++) {
+						int sum = 0;
+						for (int i = 0; i < count; i++)
+							sum += texels[i][c];
+						n[c] = (float)sum - 127.5f * count;
+					}
+					float lengthSquared = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+					if (lengthSquared > 1e-6f) {
+						// Inverse of the decode (t - 127.5) / 127.5, rounded to the nearest byte
+						float scale = 127.5f / std::sqrt(lengthSquared);
+						for (int c = 0; c < 3; c++)
+							out[c] = (unsigned char)std::clamp(std::lround(n[c] * scale + 127.5f), 0L, 255L);
+					}
+					else {
+						out[0] = out[1] = 128; // opposing normals cancel out, fall back to the surface normal
+						out[2] = 255;
+					}
+					plainFrom = 3;
+				}
+				for (int c = plainFrom; c < _components; c++) {
+					int sum = 0;
+					for (int i = 0; i < count; i++)
+						sum += texels[i][c];
+					out[c] = (unsigned char)((sum + count / 2) / count);
+				}
+			}
+		}
+	}
+};
@@ -5,6 +5,14 @@
 #include "stb_image.h"
 #endif 
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <assimp/Importer.hpp>
@@ -16,20 +24,47 @@
 
 #include <GL/glew.h>
 
+#include "gl_state_cache.h"
 #include "mesh.h"
+#include "mesh_arena.h"
+#include "mesh_cache.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "obj_parser.h"
+#include "tangent_generator.h"
 #include "shader.h"
+#include "texture_decoder.h"
+#include "texture_manager.h"
 
+// Both acquire a TextureManager reference, release it with TextureManager::Release()
 unsigned int TextureFromFile(const char* path, const std::string& directory);
 
+// Returns right away, the file is decoded on the TextureDecodePool and the pixels are uploaded by
+// the next TextureDecodePool::UploadReady() / Finish() on the GL thread.
+unsigned int TextureFromFileAsync(const char* path, const std::string& directory, MipFilter filter = MipFilter::Auto);
+
 class Model
 {
 public:
 	Model() = delete;
 
-	Model(const std::string& _filePath) {
+	// With _waitForTextures false the constructor returns before the textures have their pixels,
+	// they are uploaded by later TextureDecodePool::UploadReady() calls (e.g. once per frame).
+	Model(const std::string& _filePath, bool _waitForTextures = true)
+		: waitForTextures(_waitForTextures) {
 		LoadModel(_filePath);
 	}
 
+	// Hands the model's texture references back to the TextureManager
+	~Model() {
+		for (const auto& loaded : textures_loaded)
+			TextureManager::Get().Release(loaded.second.id);
+	}
+
+	Model(const Model&) = delete;
+	Model& operator=(const Model&) = delete;
+	Model(Model&&) = default; // the moved-from model is left without meshes and texture references
+
     // Draws the model using the provided shader.
     //
     // Usage:
@@ -39,10 +74,45 @@ public:
     //       model.Draw(shader);
     //
 	void Render(Shader& _shader, const std::vector<std::string>& textureTypeToUse = {}) {
+		Render(_shader, Mesh::TextureTypeMask(textureTypeToUse));
+	}
+
+	// Filter given as Mesh::TextureTypeMask(), no strings are touched once every mesh has its binding table
+	void Render(Shader& _shader, uint32_t textureTypeMask) {
+		if (!arena.IsEmpty()) {
+			arena.Render(meshes, _shader, textureTypeMask); // one draw per material with multi-draw indirect
+			return;
+		}
 		for (size_t i = 0; i < meshes.size(); i++)
-			meshes[i].Render(_shader, textureTypeToUse);
+			meshes[i].Render(_shader, textureTypeMask);
 	}
 
+	// Picks the level of detail of every mesh from the size of its bounds on screen, the levels
+	// stay selected for the following Render() calls.
+	//   _model, _view:   the transforms the model is drawn with
+	//   _fovY:           vertical field of view in radians
+	//   _viewportHeight: in pixels
+	void SelectLods(const glm::mat4& _model, const glm::mat4& _view, float _fovY, float _viewportHeight);
+
+	// Largest error a selected level may show on screen, in pixels (1 by default). 0 only allows
+	// levels that are exact, e.g. collapsed coplanar triangles.
+	void SetLodErrorThreshold(float _pixels) { lodErrorThreshold = _pixels; }
+	float GetLodErrorThreshold() const { return lodErrorThreshold; }
+
+	// Triangles the next Render() draws at the selected levels
+	size_t GetRenderedTriangleCount() const {
+		size_t triangles = 0;
+		for (const Mesh& mesh : meshes)
+			triangles += mesh.GetLod(mesh.GetCurrentLod()).indexCount / 3;
+		return triangles;
+	}
+
+	// Draw calls one Render() issues
+	size_t GetDrawCallCount() const { return arena.IsEmpty() ? meshes.size() : arena.GetDrawCallCount(meshes.size()); }
+
+	// Empty unless the model was loaded with the arena enabled
+	const MeshArena& GetArena() const { return arena; }
+
 	const std::vector<Mesh>& GetMesh() const{
 		return meshes;
 	}
@@ -51,22 +121,141 @@ public:
     // It returns a pair of glm::vec3 representing the minimum and maximum vertex positions that define the AABB.
 	std::pair<glm::vec3, glm::vec3> CalculateAABB();
 
+	// True when the meshes came from the .pbrmesh cache instead of an Assimp import
+	bool LoadedFromCache() const { return loadedFromCache; }
+
+	// One report per mesh optimized during an Assimp import, empty after a cache hit
+	const std::vector<MeshOptimizer::Report>& GetOptimizationReports() const { return optimizationReports; }
+
+	// Time the import threads spent converting the aiMeshes (optimizer and LODs included), 0 after a cache hit
+	float GetConversionMilliseconds() const { return conversionMilliseconds; }
+
+	// Imported meshes with more than kMaxShortIndexVertices vertices are split into several meshes
+	// drawn with 16-bit indices, instead of one mesh drawn with 32-bit indices. Off by default, a
+	// cached model keeps the split it was stored with.
+	static void SetSplitForShortIndices(bool _split) { SplitForShortIndicesFlag() = _split; }
+	static bool IsSplitForShortIndices() { return SplitForShortIndicesFlag(); }
+
+	// Models loaded from now on keep all their meshes in one MeshArena (on by default), otherwise
+	// every mesh owns its VAO and buffers
+	static void SetArenaEnabled(bool _enabled) { ArenaEnabledFlag() = _enabled; }
+	static bool IsArenaEnabled() { return ArenaEnabledFlag(); }
+
+	// Models loaded from now on free the CPU copies of their vertices and indices once they are
+	// on the GPU (after the mesh cache is written), only counts and bounds stay. Off by default.
+	static void SetGpuResidentOnly(bool _residentOnly) { GpuResidentOnlyFlag() = _residentOnly; }
+	static bool IsGpuResidentOnly() { return GpuResidentOnlyFlag(); }
+
+	// Threads converting the aiMeshes of an Assimp import, 0 (the default) for the number of
+	// hardware threads. The GL objects are still created on the loading thread.
+	static void SetImportThreadCount(unsigned int _count) { ImportThreadCountValue() = _count; }
+	static unsigned int GetImportThreadCount() {
+		unsigned int count = ImportThreadCountValue();
+		return count != 0 ? count : std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// .obj files are read by ObjParser (multithreaded, no Assimp), on by default. Assimp still
+	// imports them when the parser fails.
+	static void SetObjFastPath(bool _enabled) { ObjFastPathFlag() = _enabled; }
+	static bool IsObjFastPath() { return ObjFastPathFlag(); }
+
 private:
+	static bool& SplitForShortIndicesFlag()
+	{
+		static bool split = false;
+		return split;
+	}
+
+	static bool& ArenaEnabledFlag()
+	{
+		static bool enabled = true;
+		return enabled;
+	}
+
+	static bool& GpuResidentOnlyFlag()
+	{
+		static bool residentOnly = false;
+		return residentOnly;
+	}
+
+	static unsigned int& ImportThreadCountValue()
+	{
+		static unsigned int count = 0;
+		return count;
+	}
+
+	static bool& ObjFastPathFlag()
+	{
+		static bool enabled = true;
+		return enabled;
+	}
+
+	void ReleaseCpuData() {
+		if (IsGpuResidentOnly()) {
+			for (Mesh& mesh : meshes)
+				mesh.ReleaseCpuData();
+		}
+	}
+
 	void LoadModel(const std::string& _filePath);
 
-	void ProcessNode(aiNode* node, const aiScene* scene);
+	// CPU side of one imported mesh, built by ConvertMesh() / FinishConversion() on an import thread
+	struct ConvertedMesh
+	{
+		struct Part
+		{
+			std::vector<Vertex> vertices;
+			std::vector<unsigned int> indices;
+			std::vector<unsigned int> lodIndices;
+			std::vector<Mesh::LodLevel> lodLevels;
+		};
+		std::vector<Part> parts; // more than one when split for 16-bit indices
+		MeshOptimizer::Report report;
+		bool optimized = false;
+		bool hasTangents = false; // from the file or generated by TangentGenerator
+	};
+
+	// Runs job(i) for every i in [0, count) on GetImportThreadCount() threads, the calling one
+	// included, the jobs with the largest weight(i) first
+	template <typename Weight, typename Job>
+	static void RunImportJobs(size_t count, const Weight& weight, const Job& job);
+
+	void ProcessNode(aiNode* rootNode, const aiScene* scene);
+
+	void CollectMeshes(aiNode* currentNode, const aiScene* scene, std::vector<aiMesh*>& jobs);
+
+	static void ConvertMesh(const aiMesh* mesh, ConvertedMesh& converted);
 
-	Mesh ProcessMesh(aiMesh* mesh, const aiScene* scene);
+	// Tangents (unless the file has them), optimizer, 16-bit split and LOD chain of converted vertices
+	// and indices
+	static void FinishConversion(std::vector<Vertex> vertices, std::vector<unsigned int> indices, bool hasTangents, ConvertedMesh& converted);
+
+	void ProcessMesh(aiMesh* mesh, const aiScene* scene, ConvertedMesh& converted);
+
+	// Creates the Mesh objects (one per part) of a converted mesh at the end of the meshes vector
+	void AddConvertedMesh(ConvertedMesh& converted, const std::vector<Texture>& textures);
+
+	// The ObjParser fast path, false (with the model untouched) when the file has to go to Assimp
+	bool LoadObj(const std::string& _filePath);
 
 	std::vector<Texture> LoadMaterialTextures(aiMaterial* mat, aiTextureType type,
 		std::string typeName);
 
+	// Returns the already loaded texture at path, or loads it
+	Texture LoadTexture(const std::string& path, const std::string& typeName);
+
 private:
 	std::vector<Mesh>meshes; // Meshes where actually hold the data
-	std::vector<Texture>textures_loaded; // To prevent double texture loading
+	std::unordered_map<std::string, Texture> textures_loaded; // By path, one TextureManager reference each
 	std::string directory;
 
 	bool firstTime = true; // the first time to load mesh
+	bool loadedFromCache = false;
+	bool waitForTextures = true;
+	std::vector<MeshOptimizer::Report> optimizationReports;
+	float conversionMilliseconds = 0.0f;
+	MeshArena arena;
+	float lodErrorThreshold = 1.0f; // pixels
 };
 
 std::pair<glm::vec3, glm::vec3> Model::CalculateAABB()
@@ -74,100 +263,224 @@ std::pair<glm::vec3, glm::vec3> Model::CalculateAABB()
 	glm::vec3 minVertexPos = glm::vec3(FLT_MAX);
 	glm::vec3 maxVertexPos = glm::vec3(-FLT_MAX);
 
+	// Combines the per-mesh bounds, computed once at import time or read from the mesh cache
 	for (const auto& mesh : this->meshes) {
-		for (const auto& vertex : mesh.vertices) {
-			minVertexPos.x = std::min(minVertexPos.x, vertex.position.x);
-			minVertexPos.y = std::min(minVertexPos.y, vertex.position.y);
-			minVertexPos.z = std::min(minVertexPos.z, vertex.position.z);
-
-			maxVertexPos.x = std::max(maxVertexPos.x, vertex.position.x);
-			maxVertexPos.y = std::max(maxVertexPos.y, vertex.position.y);
-			maxVertexPos.z = std::max(maxVertexPos.z, vertex.position.z);
-		}
+		if (mesh.GetVertexCount() == 0)
+			continue;
+		minVertexPos = glm::min(minVertexPos, mesh.GetBoundsMin());
+		maxVertexPos = glm::max(maxVertexPos, mesh.GetBoundsMax());
 	}
 
 	return { minVertexPos, maxVertexPos };
 }
 
 // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+// Tries the .pbrmesh cache first, on a miss imports with Assimp and writes the cache.
 void Model::LoadModel(const std::string& _filePath)
 {
-	Assimp::Importer import;
-	const aiScene* scene = import.ReadFile(_filePath, 
-		aiProcess_Triangulate | aiProcess_FlipUVs );
+	directory = _filePath.substr(0, _filePath.find_last_of('/'));
 
-#ifdef _DEBUG
-	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-		std::cout << "ERROR::ASSIMP::" << import.GetErrorString() << std::endl;
-		return;
+	MeshCache& cache = MeshCache::Get();
+	auto start = std::chrono::steady_clock::now();
+	auto elapsedMilliseconds = [&start]() {
+		return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	if (cache.IsEnabled()) {
+		loadedFromCache = cache.Load(_filePath, meshes, [this](const std::string& type, const std::string& path) {
+			return LoadTexture(path, type);
+		}, !IsArenaEnabled());
+		if (loadedFromCache) {
+			if (IsArenaEnabled())
+				arena.Build(meshes);
+			ReleaseCpuData();
+			if (waitForTextures)
+				TextureDecodePool::Get().Finish();
+			cache.Record(_filePath, true, elapsedMilliseconds());
+			return;
+		}
 	}
+
+	const bool isObj = _filePath.size() >= 4 && _filePath.compare(_filePath.size() - 4, 4, ".obj") == 0;
+	if (!isObj || !IsObjFastPath() || !LoadObj(_filePath)) {
+		Assimp::Importer import;
+		const aiScene* scene = import.ReadFile(_filePath, 
+			aiProcess_Triangulate | aiProcess_FlipUVs );
+
+#ifdef _DEBUG
+		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+			std::cout << "ERROR::ASSIMP::" << import.GetErrorString() << std::endl;
+			return;
+		}
 #endif 
 
-	directory = _filePath.substr(0, _filePath.find_last_of('/'));
+		ProcessNode(scene->mRootNode, scene);
+		import.FreeScene(); // everything needed is in meshes now
+	}
+	if (IsArenaEnabled())
+		arena.Build(meshes);
+
+	// Textures were decoded on the pool while the meshes were converted, upload what is left
+	if (waitForTextures)
+		TextureDecodePool::Get().Finish();
+
+	if (cache.IsEnabled())
+		cache.Store(_filePath, meshes);
+	ReleaseCpuData();
+	if (cache.IsEnabled())
+		cache.Record(_filePath, false, elapsedMilliseconds());
+}
 
-	ProcessNode(scene->mRootNode, scene);
+template <typename Weight, typename Job>
+inline void Model::RunImportJobs(size_t count, const Weight& weight, const Job& job)
+{
+	// Largest first, so no thread is left with a big one at the end
+	std::vector<size_t> order(count);
+	for (size_t i = 0; i < count; i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&weight](size_t a, size_t b) {
+		return weight(a) > weight(b);
+	});
+
+	std::atomic<size_t> next{ 0 };
+	auto work = [&]() {
+		for (size_t claimed = next++; claimed < count; claimed = next++)
+			job(order[claimed]);
+	};
+
+	const size_t threadCount = std::min<size_t>(GetImportThreadCount(), count);
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < threadCount; i++)
+		workers.emplace_back(work);
+	work(); // the calling thread is one of them
+	for (std::thread& worker : workers)
+		worker.join();
 }
 
-// Iterate through all Node, from scene->mRootNode
-inline void Model::ProcessNode(aiNode* currentNode, const aiScene* scene)
+// Flattens the node tree into one job per mesh reference, converts the aiMeshes on
+// GetImportThreadCount() threads and then creates the Mesh objects in traversal order on the
+// calling (GL) thread
+inline void Model::ProcessNode(aiNode* rootNode, const aiScene* scene)
 {
-	for (size_t i = 0; i < currentNode->mNumMeshes; i++) {
-		// mMeshes in node store the index,
-		// where mMeshes in scene hold the actual objects
-		aiMesh* mesh = scene->mMeshes[currentNode->mMeshes[i]];
-
-		// Using emplace_back to construct a Mesh object in-place at the end of the meshes vector.
-		// The ProcessMesh function returns a Mesh object, and its ownership is transferred
-		// to the vector using move semantics (via the Mesh object's move constructor).
-		meshes.emplace_back(ProcessMesh(mesh, scene));
-	}
+	std::vector<aiMesh*> jobs;
+	CollectMeshes(rootNode, scene, jobs);
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<ConvertedMesh> converted(jobs.size());
+	RunImportJobs(jobs.size(),
+		[&](size_t i) { return (size_t)jobs[i]->mNumVertices; },
+		[&](size_t i) { ConvertMesh(jobs[i], converted[i]); });
+	conversionMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	for (size_t i = 0; i < jobs.size(); i++)
+		ProcessMesh(jobs[i], scene, converted[i]);
+}
 
-	for (size_t i = 0; i < currentNode->mNumChildren; i++) {
-		ProcessNode(currentNode->mChildren[i], scene);
-	}
+// Appends the meshes of currentNode and its children, depth first
+inline void Model::CollectMeshes(aiNode* currentNode, const aiScene* scene, std::vector<aiMesh*>& jobs)
+{
+	// mMeshes in node store the index,
+	// where mMeshes in scene hold the actual objects
+	for (size_t i = 0; i < currentNode->mNumMeshes; i++)
+		jobs.push_back(scene->mMeshes[currentNode->mMeshes[i]]);
+
+	for (size_t i = 0; i < currentNode->mNumChildren; i++)
+		CollectMeshes(currentNode->mChildren[i], scene, jobs);
 }
 
-// Retriving information from aiMesh and aiScene, converting all to our own Mesh
-inline Mesh Model::ProcessMesh(aiMesh* mesh, const aiScene* scene)
+// Retriving vertices and indices from aiMesh, no GL and no Model state, so it runs on any thread.
+// Every attribute stream is copied by its own loop into the presized vertex array, the checks
+// for optional streams are made once per mesh.
+inline void Model::ConvertMesh(const aiMesh* mesh, ConvertedMesh& converted)
 {
-	std::vector<Vertex>vertices;
-	std::vector<unsigned int>indices;
-	std::vector<Texture>textures;
-	bool hasTangentsAndBitangents = mesh->HasTangentsAndBitangents();
+	static_assert(sizeof(aiVector3D) == sizeof(glm::vec3), "aiVector3D streams are copied as glm::vec3");
 
-	// Process vertices
-	for (size_t i = 0; i < mesh->mNumVertices; i++) {
-		Vertex vertex;
+	const size_t vertexCount = mesh->mNumVertices;
+	std::vector<Vertex> vertices(vertexCount); // zeroed, so meshes without tangents write deterministic cache blobs
+	Vertex* out = vertices.data();
 
-		// Positions
-		vertex.position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+	// Positions
+	for (size_t i = 0; i < vertexCount; i++)
+		std::memcpy(&out[i].position, &mesh->mVertices[i], sizeof(glm::vec3));
 
-		// Normals
-		if (mesh->HasNormals())
-			vertex.normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+	// Normals
+	if (mesh->HasNormals()) {
+		for (size_t i = 0; i < vertexCount; i++)
+			std::memcpy(&out[i].normal, &mesh->mNormals[i], sizeof(glm::vec3));
+	}
 
-		// Texture Coordinates
-		if (mesh->mTextureCoords[0])
-			vertex.texCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
-		else
-			vertex.texCoords = glm::vec2(0.0f, 0.0f);
+	// Texture Coordinates, only x and y of the first set
+	if (mesh->mTextureCoords[0]) {
+		const aiVector3D* texCoords = mesh->mTextureCoords[0];
+		for (size_t i = 0; i < vertexCount; i++)
+			std::memcpy(&out[i].texCoords, &texCoords[i], sizeof(glm::vec2));
+	}
 
-		// Tangents and Bitangents
-		if (hasTangentsAndBitangents) {
-			vertex.Tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
-			vertex.Bitangent = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+	// Tangents and Bitangents
+	if (mesh->HasTangentsAndBitangents()) {
+		for (size_t i = 0; i < vertexCount; i++)
+			std::memcpy(&out[i].Tangent, &mesh->mTangents[i], sizeof(glm::vec3));
+		for (size_t i = 0; i < vertexCount; i++)
+			std::memcpy(&out[i].Bitangent, &mesh->mBitangents[i], sizeof(glm::vec3));
+	}
+
+	// Indices, aiProcess_Triangulate leaves triangles unless the mesh also has points or lines
+	std::vector<unsigned int> indices;
+	if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE) {
+		indices.resize((size_t)mesh->mNumFaces * 3);
+		unsigned int* index = indices.data();
+		for (size_t i = 0; i < mesh->mNumFaces; i++, index += 3)
+			std::memcpy(index, mesh->mFaces[i].mIndices, 3 * sizeof(unsigned int));
+	}
+	else {
+		size_t indexCount = 0;
+		for (size_t i = 0; i < mesh->mNumFaces; i++)
+			indexCount += mesh->mFaces[i].mNumIndices;
+		indices.reserve(indexCount);
+		for (size_t i = 0; i < mesh->mNumFaces; i++) {
+			const aiFace& face = mesh->mFaces[i];
+			indices.insert(indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
 		}
+	}
 
-		vertices.push_back(vertex);
+	FinishConversion(std::move(vertices), std::move(indices), mesh->HasTangentsAndBitangents(), converted);
+}
+
+inline void Model::FinishConversion(std::vector<Vertex> vertices, std::vector<unsigned int> indices, bool hasTangents, ConvertedMesh& converted)
+{
+	// Tangent frames for the vertex-tangent shaders, generated before welding so the optimizer sees them
+	static_assert(offsetof(Vertex, Tangent) == TangentGenerator::kTangentOffset * sizeof(float) &&
+		offsetof(Vertex, Bitangent) == TangentGenerator::kBitangentOffset * sizeof(float), "Vertex layout differs from TangentGenerator's");
+	converted.hasTangents = hasTangents;
+	if (!hasTangents && TangentGenerator::IsEnabled() && !vertices.empty()) {
+		TangentGenerator::Generate(&vertices[0].position.x, sizeof(Vertex) / sizeof(float), vertices.size(), indices);
+		converted.hasTangents = true;
 	}
 
-	// Process indices
-	for (size_t i = 0; i < mesh->mNumFaces; i++) {
-		aiFace face = mesh->mFaces[i];
-		for (size_t j = 0; j < face.mNumIndices; j++) {
-			indices.push_back(face.mIndices[j]);
-		}
+	// Weld, vertex cache / overdraw order and fetch order, the result is what the mesh cache stores
+	converted.optimized = MeshOptimizer::IsEnabled();
+	if (converted.optimized)
+		converted.report = MeshOptimizer::Optimize(vertices, indices);
+
+	if (IsSplitForShortIndices() && vertices.size() > kMaxShortIndexVertices) {
+		for (MeshOptimizer::Part& part : MeshOptimizer::SplitForIndexLimit(vertices, indices, kMaxShortIndexVertices))
+			converted.parts.push_back({ std::move(part.vertices), std::move(part.indices), {}, {} });
+	}
+	else
+		converted.parts.push_back({ std::move(vertices), std::move(indices), {}, {} });
+
+	// Coarser levels of detail over the same vertices, cached with the mesh
+	if (MeshSimplifier::IsEnabled()) {
+		for (ConvertedMesh::Part& part : converted.parts)
+			MeshSimplifier::BuildLodChain(part.vertices, part.indices, part.lodIndices, part.lodLevels);
 	}
+}
+
+// Loads the textures of the mesh's material and constructs the Mesh object (or its parts, see
+// SetSplitForShortIndices) in-place at the end of the meshes vector
+inline void Model::ProcessMesh(aiMesh* mesh, const aiScene* scene, ConvertedMesh& converted)
+{
+	std::vector<Texture>textures;
 
 	// Process textures based on shader naming conventions
 	if (mesh->mMaterialIndex >= 0) {
@@ -188,13 +501,79 @@ inline Mesh Model::ProcessMesh(aiMesh* mesh, const aiScene* scene)
 	}
 
 #ifdef  _DEBUG
+	bool hasTangentsAndBitangents = mesh->HasTangentsAndBitangents();
 	if (this->firstTime) {
-		std::cout << "Mesh " << (hasTangentsAndBitangents ? "has" : "does not have") << " tangents and bitangents.\n";
+		std::cout << "Mesh " << (hasTangentsAndBitangents ? "has" : converted.hasTangents ? "has generated" : "does not have") << " tangents and bitangents.\n";
 		this->firstTime = false;
 	}
 #endif 
 
-	return Mesh(vertices, indices, textures, hasTangentsAndBitangents);
+	AddConvertedMesh(converted, textures);
+}
+
+inline void Model::AddConvertedMesh(ConvertedMesh& converted, const std::vector<Texture>& textures)
+{
+	if (converted.optimized)
+		optimizationReports.push_back(converted.report);
+
+	// The vertex and index arrays are moved into the mesh, not copied
+	for (ConvertedMesh::Part& part : converted.parts) {
+		Mesh& added = meshes.emplace_back(std::move(part.vertices), std::move(part.indices), textures, converted.hasTangents, !IsArenaEnabled());
+		if (!part.lodLevels.empty())
+			added.SetLods(std::move(part.lodIndices), std::move(part.lodLevels));
+	}
+}
+
+// Same meshes as the Assimp OBJ importer: one per o / g / usemtl group, the material's map_Kd,
+// map_Ks, map_Bump and map_Ka as diffuse, specular, normal and height textures
+inline bool Model::LoadObj(const std::string& _filePath)
+{
+	ObjParser::Scene scene;
+	if (!ObjParser::Parse(_filePath, scene, GetImportThreadCount()))
+		return false;
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<ConvertedMesh> converted(scene.groups.size());
+	RunImportJobs(scene.groups.size(),
+		[&](size_t i) { return scene.groups[i].vertices.size(); },
+		[&](size_t i) { FinishConversion(std::move(scene.groups[i].vertices), std::move(scene.groups[i].indices), false, converted[i]); });
+	conversionMilliseconds = scene.buildMilliseconds +
+		std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	for (size_t i = 0; i < scene.groups.size(); i++) {
+		std::vector<Texture> textures;
+		if (scene.groups[i].material >= 0) {
+			const ObjParser::Material& material = scene.materials[scene.groups[i].material];
+			if (!material.diffuse.empty())
+				textures.push_back(LoadTexture(material.diffuse, "texture_diffuse"));
+			if (!material.specular.empty())
+				textures.push_back(LoadTexture(material.specular, "texture_specular"));
+			if (!material.bump.empty())
+				textures.push_back(LoadTexture(material.bump, "texture_normal"));
+			if (!material.ambient.empty())
+				textures.push_back(LoadTexture(material.ambient, "texture_height"));
+		}
+		AddConvertedMesh(converted[i], textures);
+	}
+	return true;
+}
+
+inline void Model::SelectLods(const glm::mat4& _model, const glm::mat4& _view, float _fovY, float _viewportHeight)
+{
+	glm::mat4 modelView = _view * _model;
+	float scale = std::max(glm::length(glm::vec3(_model[0])), std::max(glm::length(glm::vec3(_model[1])), glm::length(glm::vec3(_model[2]))));
+	float pixelsPerUnit = _viewportHeight / (2.0f * std::tan(_fovY * 0.5f)); // at a distance of 1
+
+	for (const Mesh& mesh : meshes) {
+		if (mesh.GetLodCount() == 1)
+			continue;
+		glm::vec3 center = 0.5f * (mesh.GetBoundsMin() + mesh.GetBoundsMax());
+		float diagonal = glm::length(mesh.GetBoundsMax() - mesh.GetBoundsMin()) * scale;
+		float distance = glm::length(glm::vec3(modelView * glm::vec4(center, 1.0f)));
+		// Full detail once the camera is inside the bounding sphere
+		float screenSize = distance > 0.5f * diagonal ? diagonal * pixelsPerUnit / distance : FLT_MAX;
+		mesh.SelectLod(screenSize, lodErrorThreshold);
+	}
 }
 
 // Return a vector contains Texture, retriving texture information from aiMaterial to our own textures and textures_loaded
@@ -209,64 +588,37 @@ inline std::vector<Texture> Model::LoadMaterialTextures(aiMaterial* mat, aiTextu
 		aiString str;
 		mat->GetTexture(type, i, &str);
 
-		bool skip = false;
-		for (size_t j = 0; j < textures_loaded.size(); j++) {
-			// Iterate through textures_loaded vector, to check if it already exisits.
-			if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0) {
-				// Use the located texture directly since we've already loaded
-				textures.push_back(textures_loaded[j]);
-				skip = true;
-				break;
-			}
-		}
-
-		// If the texture has not been loaded yet, add it
-		if (!skip) {
-			Texture texture;
-			texture.id = TextureFromFile(str.C_Str(), directory);
-			texture.type = typeName;
-			texture.path = str.C_Str();
-
-			textures.push_back(texture);
-			textures_loaded.push_back(texture);
-		}
+		textures.push_back(LoadTexture(str.C_Str(), typeName));
 	}
 	return textures;
 }
 
+inline Texture Model::LoadTexture(const std::string& path, const std::string& typeName)
+{
+	// Use the located texture directly if this model already uses it
+	auto it = textures_loaded.find(path);
+	if (it != textures_loaded.end())
+		return it->second;
+
+	// Otherwise take a reference from the TextureManager, which may have it from another model
+	Texture texture;
+	// Colors are averaged in linear light, normal maps renormalized, the rest plainly
+	MipFilter filter = typeName == "texture_diffuse" ? MipFilter::Srgb : typeName == "texture_normal" ? MipFilter::Normal : MipFilter::Linear;
+	texture.id = TextureFromFileAsync(path.c_str(), directory, filter);
+	texture.type = typeName;
+	texture.path = path;
+
+	textures_loaded.emplace(path, texture);
+	return texture;
+}
+
 // Load a texture and return the actual id.
 unsigned int TextureFromFile(const char* path, const std::string& directory)
 {
-	// Directory + filepath 
-	std::string filename = std::string(path);
-	filename = directory + '/' + filename;
-
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-	if (data) {
-		GLenum format = GL_RED;
-		if (nrComponents == 1) format = GL_RED;
-		if (nrComponents == 3) format = GL_RGB;
-		if (nrComponents == 4) format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else {
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-	}
+	return TextureManager::Get().Acquire(directory + '/' + path);
+}
 
-	return textureID;
+unsigned int TextureFromFileAsync(const char* path, const std::string& directory, MipFilter filter)
+{
+	return TextureManager::Get().AcquireAsync(directory + '/' + path, filter);
 }
\ No newline at end of file
@@ -0,0 +1,715 @@
+#ifndef GLEW_STATIC
+#define GLEW_STATIC
+#endif
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <unistd.h>
+#endif
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <assimp/Exporter.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "draw_uniforms.h"
+#include "frame_uniforms.h"
+#include "gl_state_cache.h"
+#include "gltf_model.h"
+#include "mesh_cache.h"
+#include "mesh_optimizer.h"
+#include "model.h"
+#include "obj_parser.h"
+#include "shader.h"
+#include "texture_decoder.h"
+#include "texture_manager.h"
+#include "texture_upload_ring.h"
+#include "timer.h"
+
+// Model load-time benchmark, runs headless on a hidden window and prints the results:
+//  - cold loads (Assimp import, which also writes the .pbrmesh cache) against warm loads
+//    (memory-mapped cache, blobs straight to glBufferData)
+//  - ACMR / ATVR of every mesh before and after MeshOptimizer
+//  - warm loads with 1..N texture decode threads
+//  - CPU mip chains (MipGenerator) against glGenerateMipmap, per texture and per model load
+//  - streaming textures through the pixel buffer ring under a per-frame byte budget
+//  - vertex buffer size of the float and packed vertex formats
+//  - index buffer size with 32-bit, per-mesh and split 16-bit indices
+//  - draw calls per Model::Render() with and without the mesh arena's multi-draw batches
+//  - triangles and GPU frame time along a camera flying away, full meshes against selected LODs
+//  - peak and steady-state RSS of a load, with CPU mesh copies kept and GPU-resident only
+//  - Assimp import throughput (vertices/s) against the number of mesh conversion threads
+//  - the glTF loader against Assimp on the same .glb
+//  - ObjParser throughput (MB/s) against the number of threads and against Assimp
+//  - TextureManager sharing, residency and eviction
+
+// Resident set size of the process in bytes
+size_t CurrentRss()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.WorkingSetSize;
+	return 0;
+#else
+	std::ifstream statm("/proc/self/statm");
+	size_t pages = 0, residentPages = 0;
+	statm >> pages >> residentPages;
+	return residentPages * (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+// Samples CurrentRss() every millisecond on a thread from construction to Stop(), the largest
+// sample is the peak of what ran in between
+class RssSampler
+{
+public:
+	RssSampler()
+		: peak(CurrentRss()), sampler([this]() {
+			while (running) {
+				peak = std::max(peak.load(), CurrentRss());
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}) {}
+
+	~RssSampler() { Stop(); }
+
+	size_t Stop()
+	{
+		if (running) {
+			running = false;
+			sampler.join();
+			peak = std::max(peak.load(), CurrentRss());
+		}
+		return peak;
+	}
+
+private:
+	std::atomic<bool> running{ true };
+	std::atomic<size_t> peak;
+	std::thread sampler;
+};
+
+struct LoadResult
+{
+	float milliseconds = 0.0f;
+	size_t meshes = 0;
+	size_t vertices = 0;
+	size_t indices = 0;
+	bool fromCache = false;
+};
+
+LoadResult TimeLoad(const std::string& path)
+{
+	Timer timer;
+	timer.start();
+	Model model(path);
+	glFinish(); // include the buffer uploads
+	LoadResult result;
+	result.milliseconds = timer.elapsedMicroseconds() / 1000.0f;
+	result.meshes = model.GetMesh().size();
+	for (const Mesh& mesh : model.GetMesh()) {
+		result.vertices += mesh.GetVertexCount();
+		result.indices += mesh.GetIndexCount();
+	}
+	result.fromCache = model.LoadedFromCache();
+	return result;
+}
+
+int main()
+{
+	if (!glfwInit()) {
+		std::cerr << "failed to init glfw" << std::endl;
+		return -1;
+	}
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(64, 64, "model loading", nullptr, nullptr);
+	if (!window) {
+		std::cerr << "failed to create window" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+	if (glewInit() != GLEW_OK) {
+		std::cerr << "failed to init glew" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+
+	const std::vector<std::string> models = {
+		"res/models/nanosuit/nanosuit.obj",
+		"res/models/backpack/backpack.obj"
+	};
+	const int warmRuns = 5;
+
+	// No texture survives its model, so every load below decodes its textures again
+	TextureManager::Get().SetBudget(0);
+
+	std::cout << std::fixed << std::setprecision(2);
+	for (const std::string& path : models) {
+		std::error_code error;
+		std::filesystem::remove(MeshCache::PathFor(path), error);
+
+		LoadResult cold = TimeLoad(path);
+		float warmTotal = 0.0f;
+		LoadResult warm;
+		for (int i = 0; i < warmRuns; i++) {
+			warm = TimeLoad(path);
+			warmTotal += warm.milliseconds;
+		}
+		float warmAverage = warmTotal / warmRuns;
+
+		std::cout << path << "\n"
+			<< "  " << cold.meshes << " meshes, " << cold.vertices << " vertices, " << cold.indices / 3 << " triangles\n"
+			<< "  cold (Assimp + cache write): " << cold.milliseconds << " ms\n"
+			<< "  warm (mapped .pbrmesh, avg of " << warmRuns << "): " << warmAverage << " ms"
+			<< (warm.fromCache ? "" : "  [cache miss!]") << "\n"
+			<< "  speedup: " << (warmAverage > 0.0f ? cold.milliseconds / warmAverage : 0.0f) << "x\n";
+		if (warm.meshes != cold.meshes || warm.vertices != cold.vertices || warm.indices != cold.indices)
+			std::cout << "  warning: warm load does not match the cold import\n";
+	}
+
+	// Optimizer results per mesh, from one more import without the cache
+	std::cout << "\nMesh optimizer (FIFO cache of " << MeshOptimizer::kCacheSize << "):\n";
+	MeshCache::Get().SetEnabled(false);
+	for (const std::string& path : models) {
+		Model model(path);
+		std::cout << path << "\n";
+		for (const MeshOptimizer::Report& report : model.GetOptimizationReports())
+			report.Print(std::cout);
+	}
+	MeshCache::Get().SetEnabled(true);
+	std::cout << "Both timings include texture decoding, which the mesh cache does not skip.\n";
+	MeshCache::Get().PrintStats();
+
+	TextureDecodePool& decoder = TextureDecodePool::Get();
+	const unsigned int maxWorkers = decoder.GetWorkerCount();
+	std::vector<unsigned int> workerCounts;
+	for (unsigned int count = 1; count < maxWorkers; count *= 2)
+		workerCounts.push_back(count);
+	workerCounts.push_back(maxWorkers);
+
+	std::cout << "\nTexture decode threads (warm loads, avg of " << warmRuns << "):\n";
+	for (const std::string& path : models) {
+		std::cout << path << "\n";
+		float singleThreaded = 0.0f;
+		for (unsigned int count : workerCounts) {
+			decoder.SetWorkerCount(count);
+			decoder.ResetStats();
+			float total = 0.0f;
+			for (int i = 0; i < warmRuns; i++)
+				total += TimeLoad(path).milliseconds;
+			float average = total / warmRuns;
+			if (count == 1)
+				singleThreaded = average;
+
+			TextureDecodePool::Stats stats = decoder.GetStats();
+			std::cout << "  " << std::setw(2) << count << " thread(s): " << average << " ms"
+				<< "  (decode " << stats.decodeMilliseconds / warmRuns << " ms cpu, mips " << stats.mipMilliseconds / warmRuns << " ms cpu, upload "
+				<< stats.uploadMilliseconds / warmRuns << " ms, GL thread waiting " << stats.waitMilliseconds / warmRuns << " ms)"
+				<< "  speedup " << (average > 0.0f ? singleThreaded / average : 0.0f) << "x\n";
+		}
+	}
+	decoder.SetWorkerCount(maxWorkers);
+
+	// Mip chains: MipGenerator with 1..N threads against glGenerateMipmap (timed to glFinish) on the
+	// PBR material set, then warm model loads with the driver building the chains and with the
+	// decode workers building them
+	{
+		const std::vector<std::string> materialTextures = {
+			"res/textures/pbr/rusted_iron/albedo.png",
+			"res/textures/pbr/rusted_iron/normal.png",
+			"res/textures/pbr/rusted_iron/metallic.png",
+			"res/textures/pbr/rusted_iron/roughness.png",
+			"res/textures/pbr/rusted_iron/ao.png"
+		};
+		std::cout << "\nMip generation (avg of " << warmRuns << " runs):\n";
+		for (const std::string& path : materialTextures) {
+			int width = 0, height = 0, components = 0;
+			unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &components, 0);
+			if (!pixels) {
+				std::cout << path << ": failed to load\n";
+				continue;
+			}
+			MipFilter filter = MipGenerator::FilterForPath(path);
+			const char* filterName = filter == MipFilter::Srgb ? "sRGB" : filter == MipFilter::Normal ? "normal" : "linear";
+			std::cout << path << " (" << width << "x" << height << "x" << components << ", " << filterName << ", "
+				<< MipGenerator::LevelCount(width, height) << " levels)\n";
+
+			unsigned int texture;
+			glGenTextures(1, &texture);
+			GLStateCache::Get().BindTexture(GL_TEXTURE_2D, texture);
+			GLenum format = components == 4 ? GL_RGBA : components == 3 ? GL_RGB : GL_RED;
+			glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
+			glFinish();
+			float driverTotal = 0.0f;
+			for (int i = 0; i < warmRuns; i++) {
+				Timer timer;
+				timer.start();
+				glGenerateMipmap(GL_TEXTURE_2D);
+				glFinish();
+				driverTotal += timer.elapsedMicroseconds() / 1000.0f;
+			}
+			GLStateCache::Get().ForgetTexture(texture);
+			glDeleteTextures(1, &texture);
+			std::cout << "  glGenerateMipmap:   " << driverTotal / warmRuns << " ms (GL thread)\n";
+
+			for (unsigned int count : workerCounts) {
+				float total = 0.0f;
+				for (int i = 0; i < warmRuns; i++) {
+					MipChain chain;
+					Timer timer;
+					timer.start();
+					MipGenerator::Build(pixels, width, height, components, filter, chain, count);
+					total += timer.elapsedMicroseconds() / 1000.0f;
+				}
+				std::cout << "  MipGenerator, " << std::setw(2) << count << " thread(s): " << total / warmRuns << " ms\n";
+			}
+			stbi_image_free(pixels);
+		}
+
+		for (const std::string& path : models) {
+			std::cout << path << "\n";
+			for (bool cpuMips : { false, true }) {
+				MipGenerator::SetEnabled(cpuMips);
+				decoder.ResetStats();
+				float total = 0.0f;
+				for (int i = 0; i < warmRuns; i++)
+					total += TimeLoad(path).milliseconds;
+				TextureDecodePool::Stats stats = decoder.GetStats();
+				std::cout << "  " << (cpuMips ? "MipGenerator:     " : "glGenerateMipmap: ") << total / warmRuns << " ms"
+					<< "  (mips " << stats.mipMilliseconds / warmRuns << " ms cpu on the workers, upload "
+					<< stats.uploadMilliseconds / warmRuns << " ms on the GL thread)\n";
+			}
+		}
+		MipGenerator::SetEnabled(true);
+	}
+
+	// Streaming: the model returns right away and every "frame" uploads at most budget bytes.
+	// The longest frame is what a running scene would see as a hitch.
+	TextureUploadRing uploadRing(64 << 20);
+	std::cout << "\nStreaming textures (" << (uploadRing.IsAvailable() ? "pixel buffer ring" : "client memory, no ARB_buffer_storage") << "):\n";
+	decoder.SetUploadRing(&uploadRing);
+	const std::vector<size_t> budgets = { TextureDecodePool::kNoBudget, 16u << 20, 4u << 20 };
+	for (const std::string& path : models) {
+		std::cout << path << "\n";
+		for (size_t budget : budgets) {
+			decoder.ResetStats();
+			Timer total;
+			total.start();
+			Model model(path, false);
+			int frames = 0;
+			float longestFrame = 0.0f;
+			while (decoder.GetPendingCount() > 0) {
+				Timer frame;
+				frame.start();
+				decoder.UploadReady(budget);
+				glFinish();
+				longestFrame = std::max(longestFrame, frame.elapsedMicroseconds() / 1000.0f);
+				frames++;
+			}
+			float totalMilliseconds = total.elapsedMicroseconds() / 1000.0f;
+
+			TextureDecodePool::Stats stats = decoder.GetStats();
+			std::cout << "  budget " << std::setw(9) << (budget == TextureDecodePool::kNoBudget ? std::string("unlimited") : std::to_string(budget >> 20) + " MB")
+				<< ": " << frames << " frames, longest " << longestFrame << " ms, total " << totalMilliseconds << " ms, "
+				<< (stats.uploadedBytes >> 20) << " MB uploaded\n";
+		}
+	}
+	decoder.SetUploadRing(nullptr);
+	TextureUploadRing::Stats ringStats = uploadRing.GetStats();
+	std::cout << "Ring: " << ringStats.uploads << " uploads, " << ringStats.allocationWaits << " worker waits for space\n";
+
+	// Vertex buffer size per format, a full draw fetches the same bytes, so it is also the vertex
+	// bandwidth of every draw of the model
+	std::cout << "\nVertex formats (Vertex " << sizeof(Vertex) << " bytes, PackedVertex " << sizeof(PackedVertex) << " bytes):\n";
+	for (const std::string& path : models) {
+		size_t bytes[2] = {};
+		size_t indexBytes = 0;
+		for (VertexFormat format : { VertexFormat::Float, VertexFormat::Packed }) {
+			Mesh::SetDefaultVertexFormat(format);
+			Model model(path);
+			indexBytes = 0;
+			for (const Mesh& mesh : model.GetMesh()) {
+				bytes[(int)format] += mesh.GetVertexBufferBytes();
+				indexBytes += mesh.GetIndexBufferBytes();
+			}
+		}
+		float saved = bytes[0] ? 100.0f * (1.0f - (float)bytes[1] / bytes[0]) : 0.0f;
+		std::cout << path << "\n"
+			<< "  float:  " << bytes[0] / 1024.0f << " KB vertices\n"
+			<< "  packed: " << bytes[1] / 1024.0f << " KB vertices, " << saved << "% less VRAM and vertex fetch\n"
+			<< "  (indices " << indexBytes / 1024.0f << " KB in both)\n";
+	}
+	Mesh::SetDefaultVertexFormat(VertexFormat::Float);
+
+	// Index buffer size: everything 32-bit, the index type chosen per mesh, and meshes over the
+	// 16-bit limit split (imported without the cache, which keeps the split it was stored with)
+	std::cout << "\nIndex buffers (16-bit up to " << kMaxShortIndexVertices << " vertices per mesh):\n";
+	MeshCache::Get().SetEnabled(false);
+	for (const std::string& path : models) {
+		size_t wideBytes = 0, adaptiveBytes = 0, splitBytes = 0;
+		size_t meshCount = 0, wideMeshes = 0, splitMeshCount = 0;
+		Model::SetArenaEnabled(false); // an arena uses one index type for all its meshes
+		{
+			Model model(path);
+			meshCount = model.GetMesh().size();
+			for (const Mesh& mesh : model.GetMesh()) {
+				wideBytes += mesh.GetIndexBufferBytes() / IndexTypeSize(mesh.GetIndexType()) * sizeof(uint32_t);
+				adaptiveBytes += mesh.GetIndexBufferBytes();
+				wideMeshes += mesh.GetIndexType() == GL_UNSIGNED_INT;
+			}
+		}
+		Model::SetArenaEnabled(true);
+		Model::SetSplitForShortIndices(true);
+		{
+			Model model(path);
+			splitMeshCount = model.GetMesh().size();
+			for (const Mesh& mesh : model.GetMesh())
+				splitBytes += mesh.GetIndexBufferBytes();
+		}
+		Model::SetSplitForShortIndices(false);
+		std::cout << path << "\n"
+			<< "  32-bit:   " << wideBytes / 1024.0f << " KB\n"
+			<< "  per mesh: " << adaptiveBytes / 1024.0f << " KB, " << wideMeshes << " of " << meshCount << " meshes still 32-bit\n"
+			<< "  split:    " << splitBytes / 1024.0f << " KB, " << splitMeshCount << " meshes, all 16-bit\n";
+	}
+	MeshCache::Get().SetEnabled(true);
+
+	// One shared arena per model, consecutive meshes with the same material become one
+	// glMultiDrawElementsIndirect
+	std::cout << "\nDraw calls per Model::Render() (multi-draw indirect "
+		<< (MeshArena::HasMultiDrawIndirect() ? "available" : "not available") << "):\n";
+	for (const std::string& path : models) {
+		Model model(path);
+		const MeshArena& arena = model.GetArena();
+		MeshArena::SetMultiDrawEnabled(false);
+		size_t perMesh = model.GetDrawCallCount();
+		MeshArena::SetMultiDrawEnabled(true);
+		std::cout << path << "\n"
+			<< "  " << model.GetMesh().size() << " meshes, " << arena.GetBatches().size() << " material batches, "
+			<< (arena.GetIndexType() == GL_UNSIGNED_SHORT ? 16 : 32) << "-bit indices, "
+			<< (arena.GetVertexBufferBytes() + arena.GetIndexBufferBytes()) / 1024.0f << " KB in one arena\n"
+			<< "  draw calls: " << perMesh << " per mesh -> " << model.GetDrawCallCount() << " batched\n";
+	}
+
+	// Camera flying away from each model: triangles drawn and frame time with the full meshes and
+	// with the levels SelectLods() picks for a 1 pixel error, rendered offscreen
+	{
+		const int width = 1280, height = 720, frames = 20;
+		const float fovY = glm::radians(45.0f);
+		GLStateCache& state = GLStateCache::Get();
+		unsigned int framebuffer, colorBuffer, depthBuffer;
+		glGenFramebuffers(1, &framebuffer);
+		glGenRenderbuffers(1, &colorBuffer);
+		glGenRenderbuffers(1, &depthBuffer);
+		state.BindFramebuffer(framebuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+		state.Viewport(0, 0, width, height);
+		state.Enable(GL_DEPTH_TEST);
+
+		Shader shader("res/shaders/debug_light.vs", "res/shaders/debug_light.fs");
+		FrameUniformBuffer frameUniforms;
+		frameUniforms.Attach(shader);
+		DrawUniformRing drawUniforms(1);
+		drawUniforms.Attach(shader);
+		FrameData frameData;
+		frameData.projection = glm::perspective(fovY, (float)width / height, 0.1f, 1000.0f);
+
+		std::cout << "\nLevels of detail (camera flying away, " << width << "x" << height << ", avg of " << frames << " frames):\n";
+		for (const std::string& path : models) {
+			Model model(path);
+			std::pair<glm::vec3, glm::vec3> bounds = model.CalculateAABB();
+			glm::vec3 center = 0.5f * (bounds.first + bounds.second);
+			float radius = 0.5f * glm::length(bounds.second - bounds.first);
+			size_t levels = 0;
+			for (const Mesh& mesh : model.GetMesh())
+				levels = std::max(levels, mesh.GetLodCount());
+
+			auto timeFrames = [&]() {
+				Timer timer;
+				timer.start();
+				for (int i = 0; i < frames; i++) {
+					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+					shader.Bind();
+					frameUniforms.Update(frameData);
+					drawUniforms.BeginFrame();
+					drawUniforms.Push(DrawData(glm::mat4(1.0f)));
+					model.Render(shader);
+					drawUniforms.EndFrame();
+				}
+				glFinish();
+				return timer.elapsedMicroseconds() / 1000.0f / frames;
+			};
+
+			std::cout << path << " (up to " << levels << " levels per mesh)\n"
+				<< "  distance   triangles full -> LOD    ms full -> LOD\n";
+			for (float distance = 2.0f * radius; distance <= 128.0f * radius; distance *= 2.0f) {
+				frameData.view = glm::lookAt(center + glm::vec3(0.0f, 0.0f, distance), center, glm::vec3(0.0f, 1.0f, 0.0f));
+
+				for (const Mesh& mesh : model.GetMesh())
+					mesh.SetCurrentLod(0);
+				size_t fullTriangles = model.GetRenderedTriangleCount();
+				float fullMilliseconds = timeFrames();
+
+				model.SelectLods(glm::mat4(1.0f), frameData.view, fovY, (float)height);
+				size_t lodTriangles = model.GetRenderedTriangleCount();
+				float lodMilliseconds = timeFrames();
+
+				std::cout << "  " << std::setw(6) << distance / radius << " r   " << std::setw(9) << fullTriangles << " -> " << std::setw(7) << lodTriangles
+					<< "    " << fullMilliseconds << " -> " << lodMilliseconds << "\n";
+			}
+		}
+
+		state.BindFramebuffer(0);
+		state.Disable(GL_DEPTH_TEST);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+		state.ForgetFramebuffer(framebuffer);
+		glDeleteFramebuffers(1, &framebuffer);
+	}
+
+	// RSS of one load relative to before it: the peak while loading and what stays while the model
+	// is alive, once with the CPU copies of the meshes kept and once GPU-resident only
+	std::cout << "\nMemory (RSS relative to before the load, MB):\n";
+	for (const std::string& path : models) {
+		std::cout << path << "\n";
+		for (bool fromCache : { false, true }) {
+			for (bool residentOnly : { false, true }) {
+				MeshCache::Get().SetEnabled(fromCache);
+				Model::SetGpuResidentOnly(residentOnly);
+				double baseline = (double)CurrentRss();
+				RssSampler sampler;
+				Model model(path);
+				double peak = (double)sampler.Stop();
+				double steady = (double)CurrentRss();
+				size_t cpuBytes = 0;
+				for (const Mesh& mesh : model.GetMesh())
+					cpuBytes += mesh.GetCpuBytes();
+				std::cout << "  " << (fromCache ? "cache " : "import") << ", " << (residentOnly ? "GPU-resident only" : "CPU copies kept  ")
+					<< ": peak +" << (peak - baseline) / (1 << 20) << ", steady +" << (steady - baseline) / (1 << 20)
+					<< " (mesh arrays " << cpuBytes / double(1 << 20) << ")\n";
+			}
+		}
+	}
+	MeshCache::Get().SetEnabled(true);
+	Model::SetGpuResidentOnly(false);
+
+	// Assimp import throughput against the number of threads converting the aiMeshes, the mesh
+	// cache is off so every load imports. Only the conversion is timed, Assimp's parse and the
+	// texture loads stay on the loading thread. The .obj fast path is off so Assimp reads them.
+	const unsigned int maxImportThreads = Model::GetImportThreadCount();
+	std::vector<unsigned int> importThreadCounts;
+	for (unsigned int count = 1; count < maxImportThreads; count *= 2)
+		importThreadCounts.push_back(count);
+	importThreadCounts.push_back(maxImportThreads);
+
+	std::cout << "\nImport threads (mesh conversion, avg of " << warmRuns << " imports, Mvertices/s):\n";
+	MeshCache::Get().SetEnabled(false);
+	Model::SetObjFastPath(false);
+	for (const std::string& path : models) {
+		std::cout << path << "\n";
+		for (bool fullPipeline : { false, true }) {
+			MeshOptimizer::SetEnabled(fullPipeline);
+			MeshSimplifier::SetEnabled(fullPipeline);
+			float singleThreaded = 0.0f;
+			for (unsigned int count : importThreadCounts) {
+				Model::SetImportThreadCount(count);
+				float total = 0.0f;
+				size_t vertices = 0;
+				for (int i = 0; i < warmRuns; i++) {
+					Model model(path);
+					total += model.GetConversionMilliseconds();
+					vertices = 0;
+					for (const MeshOptimizer::Report& report : model.GetOptimizationReports())
+						vertices += report.verticesBefore;
+					if (!fullPipeline) {
+						for (const Mesh& mesh : model.GetMesh())
+							vertices += mesh.GetVertexCount();
+					}
+				}
+				float average = total / warmRuns;
+				if (count == 1)
+					singleThreaded = average;
+				std::cout << "  " << (fullPipeline ? "with optimizer and LODs" : "copy only              ") << ", "
+					<< std::setw(2) << count << " thread(s): " << average << " ms, "
+					<< (average > 0.0f ? vertices / (average * 1000.0f) : 0.0f) << " Mvertices/s"
+					<< "  speedup " << (average > 0.0f ? singleThreaded / average : 0.0f) << "x\n";
+			}
+		}
+	}
+	MeshOptimizer::SetEnabled(true);
+	MeshSimplifier::SetEnabled(true);
+	Model::SetImportThreadCount(0);
+	Model::SetObjFastPath(true);
+	MeshCache::Get().SetEnabled(true);
+
+	// glTF: each model exported once to .glb by Assimp, then the same file loaded through Assimp
+	// (Model, cache, optimizer and LODs off) and through GltfModel. Textures are decoded outside
+	// the timing, both paths read and hash the same image files.
+	std::cout << "\nglTF loader (same .glb, avg of " << warmRuns << " loads, textures excluded):\n";
+	MeshCache::Get().SetEnabled(false);
+	MeshOptimizer::SetEnabled(false);
+	MeshSimplifier::SetEnabled(false);
+	for (const std::string& path : models) {
+		std::string glbPath = path.substr(0, path.find_last_of('.')) + ".glb";
+		{
+			Assimp::Importer importer;
+			const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate);
+			Assimp::Exporter exporter;
+			if (!scene || exporter.Export(scene, "glb2", glbPath) != AI_SUCCESS) {
+				std::cout << path << ": .glb export failed (" << exporter.GetErrorString() << ")\n";
+				continue;
+			}
+		}
+
+		float assimpTotal = 0.0f, gltfTotal = 0.0f;
+		size_t assimpVertices = 0, gltfVertices = 0, gltfTriangles = 0, gltfBytes = 0, primitives = 0;
+		for (int i = 0; i < warmRuns; i++) {
+			Timer timer;
+			timer.start();
+			{
+				Model model(glbPath, false);
+				glFinish();
+				assimpTotal += timer.elapsedMicroseconds() / 1000.0f;
+				assimpVertices = 0;
+				for (const Mesh& mesh : model.GetMesh())
+					assimpVertices += mesh.GetVertexCount();
+				decoder.Finish();
+			}
+
+			timer.start();
+			GltfModel gltf(glbPath, false);
+			glFinish();
+			gltfTotal += timer.elapsedMicroseconds() / 1000.0f;
+			decoder.Finish();
+			gltfVertices = gltf.GetVertexCount();
+			gltfTriangles = gltf.GetTriangleCount();
+			gltfBytes = gltf.GetBufferBytes();
+			primitives = gltf.GetPrimitiveCount();
+		}
+		float assimpAverage = assimpTotal / warmRuns, gltfAverage = gltfTotal / warmRuns;
+		std::cout << glbPath << "\n"
+			<< "  " << primitives << " primitives, " << gltfVertices << " vertices, " << gltfTriangles << " triangles, "
+			<< gltfBytes / 1024.0f << " KB uploaded from the mapping\n"
+			<< "  Assimp:    " << assimpAverage << " ms (" << assimpVertices << " vertices)\n"
+			<< "  GltfModel: " << gltfAverage << " ms, speedup " << (gltfAverage > 0.0f ? assimpAverage / gltfAverage : 0.0f) << "x\n";
+	}
+	MeshOptimizer::SetEnabled(true);
+	MeshSimplifier::SetEnabled(true);
+	MeshCache::Get().SetEnabled(true);
+
+	// OBJ: ObjParser alone (parse, then the dedupe that builds each group's vertices) with 1..N
+	// threads against Assimp's ReadFile of the same file, then whole Model loads with the fast
+	// path on and off (cache, optimizer and LODs off, textures decoded outside the timing)
+	std::cout << "\nOBJ parser (avg of " << warmRuns << " reads, MB/s of .obj text):\n";
+	MeshCache::Get().SetEnabled(false);
+	MeshOptimizer::SetEnabled(false);
+	MeshSimplifier::SetEnabled(false);
+	for (const std::string& path : models) {
+		std::cout << path << "\n";
+		float singleThreaded = 0.0f;
+		size_t fileBytes = 0;
+		for (unsigned int count : importThreadCounts) {
+			float parseTotal = 0.0f, buildTotal = 0.0f;
+			size_t groups = 0, vertices = 0;
+			bool parsed = true;
+			for (int i = 0; i < warmRuns && parsed; i++) {
+				ObjParser::Scene scene;
+				parsed = ObjParser::Parse(path, scene, count);
+				parseTotal += scene.parseMilliseconds;
+				buildTotal += scene.buildMilliseconds;
+				fileBytes = scene.bytes;
+				groups = scene.groups.size();
+				vertices = 0;
+				for (const ObjParser::Group& group : scene.groups)
+					vertices += group.vertices.size();
+			}
+			if (!parsed) {
+				std::cout << "  ObjParser failed\n";
+				break;
+			}
+			float parseAverage = parseTotal / warmRuns, buildAverage = buildTotal / warmRuns;
+			float average = parseAverage + buildAverage;
+			if (count == 1)
+				singleThreaded = average;
+			std::cout << "  ObjParser, " << std::setw(2) << count << " thread(s): parse " << parseAverage << " ms ("
+				<< (parseAverage > 0.0f ? fileBytes / (parseAverage * 1000.0f) : 0.0f) << " MB/s), build " << buildAverage << " ms, "
+				<< (average > 0.0f ? fileBytes / (average * 1000.0f) : 0.0f) << " MB/s overall, speedup "
+				<< (average > 0.0f ? singleThreaded / average : 0.0f) << "x (" << groups << " groups, " << vertices << " vertices)\n";
+		}
+
+		float assimpTotal = 0.0f;
+		for (int i = 0; i < warmRuns; i++) {
+			Timer timer;
+			timer.start();
+			Assimp::Importer importer;
+			importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+			assimpTotal += timer.elapsedMicroseconds() / 1000.0f;
+		}
+		float assimpAverage = assimpTotal / warmRuns;
+		std::cout << "  Assimp ReadFile:       " << assimpAverage << " ms ("
+			<< (assimpAverage > 0.0f ? fileBytes / (assimpAverage * 1000.0f) : 0.0f) << " MB/s)\n";
+
+		for (bool fastPath : { false, true }) {
+			Model::SetObjFastPath(fastPath);
+			float total = 0.0f;
+			for (int i = 0; i < warmRuns; i++) {
+				Timer timer;
+				timer.start();
+				Model model(path, false);
+				glFinish();
+				total += timer.elapsedMicroseconds() / 1000.0f;
+				decoder.Finish();
+			}
+			std::cout << "  Model load, " << (fastPath ? "ObjParser:" : "Assimp:   ") << " " << total / warmRuns << " ms\n";
+		}
+	}
+	Model::SetObjFastPath(true);
+	MeshOptimizer::SetEnabled(true);
+	MeshSimplifier::SetEnabled(true);
+	MeshCache::Get().SetEnabled(true);
+
+	// Two models alive at once share what they have in common, everything released is cached until
+	// it is evicted
+	std::cout << "\n";
+	TextureManager& textures = TextureManager::Get();
+	textures.ResetCounters();
+	textures.SetBudget(TextureManager::kNoBudget);
+	{
+		Model first(models[0]);
+		Model second(models[0]);
+		textures.PrintStats();
+	}
+	textures.PrintStats();
+	textures.SetBudget(0);
+	textures.PrintStats();
+
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return 0;
+}
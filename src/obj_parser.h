@@ -0,0 +1,634 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+#include "mesh_cache.h"
+
+// Wavefront OBJ / MTL reader for Model's import fast path, producing the meshes Assimp's OBJ
+// importer would (aiProcess_Triangulate | aiProcess_FlipUVs), indexed instead of one vertex per
+// face corner.
+//
+// The memory-mapped file is cut into line-aligned chunks that are parsed in parallel with a
+// Clinger fast-path float parser (exact for the usual up to 15 significant digits, strtod
+// otherwise). Polygons are fanned into triangles while parsing. A new group starts at every
+// o / g / usemtl line, empty groups are dropped. The v/vt/vn tuples of each group are then
+// deduplicated in a lock-free open-addressing table shared by all threads: a slot keeps the lowest
+// corner holding its tuple, so vertices are numbered in first-use order whatever the thread timing.
+//
+// Supported: v, vt, vn, f (with negative indices), o, g, usemtl, mtllib; in MTL newmtl, map_Kd,
+// map_Ks, map_Bump / bump, map_Ka (the last token is the file, options are skipped). Everything
+// else is ignored. Parse() fails on malformed faces or out of range indices, the caller then falls
+// back to Assimp.
+//
+// Usage:
+//   ObjParser::Scene scene;
+//   if (ObjParser::Parse("res/models/backpack/backpack.obj", scene, threadCount))
+//       for (ObjParser::Group& group : scene.groups) { ... group.vertices, group.indices ... }
+class ObjParser
+{
+public:
+	struct Material
+	{
+		std::string name;
+		std::string diffuse;  // map_Kd
+		std::string specular; // map_Ks
+		std::string bump;     // map_Bump, bump (Assimp: aiTextureType_HEIGHT)
+		std::string ambient;  // map_Ka (Assimp: aiTextureType_AMBIENT)
+	};
+
+	struct Group
+	{
+		std::string name;
+		int material = -1; // into Scene::materials
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+	};
+
+	struct Scene
+	{
+		std::vector<Group> groups;
+		std::vector<Material> materials;
+		size_t bytes = 0;                // size of the .obj file
+		float parseMilliseconds = 0.0f;  // chunked parse
+		float buildMilliseconds = 0.0f;  // merge, deduplication and vertex assembly
+	};
+
+	// Chunks smaller than this are not worth a thread
+	static constexpr size_t kMinChunkBytes = 256 << 10;
+
+	// _flipTexCoords: v = 1 - v, as aiProcess_FlipUVs
+	static bool Parse(const std::string& _path, Scene& _scene, unsigned int _threadCount, bool _flipTexCoords = true)
+	{
+		_scene = Scene();
+		MappedFile file(_path);
+		if (!file.IsOpen())
+			return false;
+		_scene.bytes = file.Size();
+		const unsigned int threadCount = std::max(1u, _threadCount);
+
+		// Line-aligned chunks, one per thread
+		auto start = std::chrono::steady_clock::now();
+		const char* data = file.Data();
+		const char* const end = data + file.Size();
+		size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, file.Size() / kMinChunkBytes));
+		std::vector<Chunk> chunks(chunkCount);
+		std::vector<const char*> bounds(chunkCount + 1, end);
+		bounds[0] = data;
+		for (size_t i = 1; i < chunkCount; i++) {
+			const char* cut = std::max(bounds[i - 1], data + file.Size() / chunkCount * i);
+			const char* newline = static_cast<const char*>(std::memchr(cut, '\n', end - cut));
+			bounds[i] = newline ? newline + 1 : end;
+		}
+		ParallelFor(chunkCount, threadCount, 1, [&](size_t _begin, size_t _end) {
+			for (size_t i = _begin; i < _end; i++)
+				ParseChunk(bounds[i], bounds[i + 1], chunks[i]);
+		});
+		_scene.parseMilliseconds = MillisecondsSince(start);
+		for (const Chunk& chunk : chunks) {
+			if (chunk.failed)
+				return false;
+		}
+
+		start = std::chrono::steady_clock::now();
+		Attributes attributes;
+		MergeAttributes(chunks, attributes, threadCount);
+
+		// Groups in file order, material libraries as they are named
+		std::vector<GroupPlan> plans(1);
+		std::vector<std::string> libraries;
+		for (size_t c = 0; c < chunks.size(); c++) {
+			size_t triangle = 0;
+			for (const Marker& marker : chunks[c].markers) {
+				plans.back().AddSegment(c, triangle, marker.triangle);
+				triangle = marker.triangle;
+				if (marker.kind == MarkerKind::Library) {
+					libraries.push_back(marker.name);
+					continue;
+				}
+				GroupPlan next;
+				next.name = marker.kind == MarkerKind::Object ? marker.name : plans.back().name;
+				next.material = marker.kind == MarkerKind::Material ? marker.name : plans.back().material;
+				if (plans.back().triangles == 0)
+					plans.back() = std::move(next);
+				else
+					plans.push_back(std::move(next));
+			}
+			plans.back().AddSegment(c, triangle, chunks[c].corners.size() / 3);
+		}
+
+		std::string directory = _path.substr(0, _path.find_last_of('/'));
+		for (const std::string& library : libraries)
+			ParseMaterials(directory + '/' + library, _scene.materials);
+
+		for (const GroupPlan& plan : plans) {
+			if (plan.triangles == 0)
+				continue;
+			Group group;
+			group.name = plan.name;
+			for (size_t m = 0; m < _scene.materials.size(); m++) {
+				if (_scene.materials[m].name == plan.material)
+					group.material = (int)m;
+			}
+			if (!BuildGroup(plan, chunks, attributes, threadCount, _flipTexCoords, group))
+				return false;
+			_scene.groups.push_back(std::move(group));
+		}
+		_scene.buildMilliseconds = MillisecondsSince(start);
+		return true;
+	}
+
+private:
+	static constexpr int32_t kMissing = INT32_MIN;
+	static constexpr uint32_t kEmptySlot = UINT32_MAX;
+	static constexpr size_t kMinItemsPerThread = 16384;
+
+	// One face corner. Indices are 0-based and absolute, or relative to the first element of the
+	// chunk (negative OBJ indices) when the matching relative bit is set.
+	struct Corner
+	{
+		int32_t position;
+		int32_t texCoord;
+		int32_t normal;
+		uint32_t relative; // bit 0: position, 1: texCoord, 2: normal
+
+		bool operator==(const Corner& _other) const
+		{
+			return position == _other.position && texCoord == _other.texCoord && normal == _other.normal;
+		}
+	};
+
+	enum class MarkerKind : uint8_t
+	{
+		Object,   // o, g
+		Material, // usemtl
+		Library   // mtllib
+	};
+
+	// State change before triangle (chunk-local index)
+	struct Marker
+	{
+		size_t triangle;
+		MarkerKind kind;
+		std::string name;
+	};
+
+	struct Chunk
+	{
+		std::vector<float> positions; // xyz
+		std::vector<float> texCoords; // uv
+		std::vector<float> normals;   // xyz
+		std::vector<Corner> corners;  // 3 per triangle
+		std::vector<Marker> markers;
+		size_t positionBase = 0, texCoordBase = 0, normalBase = 0; // elements in the chunks before
+		bool failed = false;
+	};
+
+	struct Attributes
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> texCoords;
+		std::vector<glm::vec3> normals;
+	};
+
+	struct Segment
+	{
+		size_t chunk;
+		size_t firstTriangle;
+		size_t triangleCount;
+	};
+
+	struct GroupPlan
+	{
+		std::string name;
+		std::string material;
+		std::vector<Segment> segments;
+		size_t triangles = 0;
+
+		void AddSegment(size_t _chunk, size_t _begin, size_t _end)
+		{
+			if (_end > _begin) {
+				segments.push_back({ _chunk, _begin, _end - _begin });
+				triangles += _end - _begin;
+			}
+		}
+	};
+
+	static float MillisecondsSince(std::chrono::steady_clock::time_point _start)
+	{
+		return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - _start).count();
+	}
+
+	// Calls _function(begin, end) on up to _threadCount threads (the calling one included) over
+	// even slices of [0, _count), at least _minItems items per thread
+	template <typename Function>
+	static void ParallelFor(size_t _count, unsigned int _threadCount, size_t _minItems, const Function& _function)
+	{
+		size_t threads = std::min<size_t>(_threadCount, std::max<size_t>(1, _count / std::max<size_t>(1, _minItems)));
+		if (threads <= 1) {
+			_function(0, _count);
+			return;
+		}
+		std::vector<std::thread> workers;
+		for (size_t t = 1; t < threads; t++)
+			workers.emplace_back(_function, _count * t / threads, _count * (t + 1) / threads);
+		_function(0, _count / threads);
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	static bool IsBlank(char _c) { return _c == ' ' || _c == '\t' || _c == '\r'; }
+
+	static const char* SkipBlanks(const char* _p, const char* _end)
+	{
+		while (_p < _end && IsBlank(*_p))
+			_p++;
+		return _p;
+	}
+
+	// Rest of the line without surrounding blanks
+	static std::string Name(const char* _p, const char* _lineEnd)
+	{
+		_p = SkipBlanks(_p, _lineEnd);
+		while (_lineEnd > _p && IsBlank(_lineEnd[-1]))
+			_lineEnd--;
+		return std::string(_p, _lineEnd);
+	}
+
+	static bool StartsWith(const char* _p, const char* _lineEnd, const char* _keyword)
+	{
+		size_t length = std::strlen(_keyword);
+		return (size_t)(_lineEnd - _p) > length && std::memcmp(_p, _keyword, length) == 0 && IsBlank(_p[length]);
+	}
+
+	// Decimal float, exact through the fast path when the digits fit a double's mantissa and the
+	// power of ten is exactly representable (Clinger), strtod otherwise. Null when there is no number.
+	static const char* ParseFloat(const char* _p, const char* _end, float& _value)
+	{
+		static const double kPowers[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+		_p = SkipBlanks(_p, _end);
+		const char* token = _p;
+		bool negative = false;
+		if (_p < _end && (*_p == '-' || *_p == '+'))
+			negative = *_p++ == '-';
+
+		uint64_t mantissa = 0;
+		int significant = 0, exponent = 0;
+		bool anyDigit = false;
+		for (; _p < _end && *_p >= '0' && *_p <= '9'; _p++) {
+			anyDigit = true;
+			if (significant < 19) {
+				mantissa = mantissa * 10 + (uint64_t)(*_p - '0');
+				significant += mantissa != 0;
+			}
+			else
+				exponent++;
+		}
+		if (_p < _end && *_p == '.') {
+			for (_p++; _p < _end && *_p >= '0' && *_p <= '9'; _p++) {
+				anyDigit = true;
+				if (significant < 19) {
+					mantissa = mantissa * 10 + (uint64_t)(*_p - '0');
+					significant += mantissa != 0;
+					exponent--;
+				}
+			}
+		}
+		if (anyDigit && _p < _end && (*_p == 'e' || *_p == 'E')) {
+			const char* e = _p + 1;
+			bool negativeExponent = false;
+			if (e < _end && (*e == '-' || *e == '+'))
+				negativeExponent = *e++ == '-';
+			int value = 0;
+			bool exponentDigits = false;
+			for (; e < _end && *e >= '0' && *e <= '9'; e++) {
+				exponentDigits = true;
+				value = std::min(value * 10 + (*e - '0'), 100000);
+			}
+			if (exponentDigits) {
+				exponent += negativeExponent ? -value : value;
+				_p = e;
+			}
+		}
+
+		double result;
+		if (anyDigit && mantissa < (1ull << 53) && exponent >= -22 && exponent <= 22)
+			result = exponent < 0 ? (double)mantissa / kPowers[-exponent] : (double)mantissa * kPowers[exponent];
+		else {
+			// nan, inf, long mantissas, large exponents
+			const char* tokenEnd = token;
+			while (tokenEnd < _end && !IsBlank(*tokenEnd) && *tokenEnd != '\n')
+				tokenEnd++;
+			char buffer[64];
+			size_t length = std::min<size_t>(tokenEnd - token, sizeof(buffer) - 1);
+			std::memcpy(buffer, token, length);
+			buffer[length] = '\0';
+			char* parsedEnd = nullptr;
+			double parsed = std::strtod(buffer, &parsedEnd);
+			if (parsedEnd == buffer)
+				return nullptr;
+			_value = (float)parsed;
+			return token + (parsedEnd - buffer);
+		}
+		_value = (float)(negative ? -result : result);
+		return _p;
+	}
+
+	// OBJ index (1-based, negative: from the end of what the chunk has read so far)
+	static const char* ParseIndex(const char* _p, const char* _end, size_t _localCount, int32_t& _index, bool& _relative)
+	{
+		bool negative = false;
+		if (_p < _end && *_p == '-') {
+			negative = true;
+			_p++;
+		}
+		int64_t value = 0;
+		const char* digits = _p;
+		for (; _p < _end && *_p >= '0' && *_p <= '9'; _p++)
+			value = std::min<int64_t>(value * 10 + (*_p - '0'), INT32_MAX);
+		if (_p == digits || value == 0)
+			return nullptr;
+		_relative = negative;
+		_index = negative ? (int32_t)((int64_t)_localCount - value) : (int32_t)(value - 1);
+		return _p;
+	}
+
+	static void ParseChunk(const char* _p, const char* _end, Chunk& _chunk)
+	{
+		std::vector<Corner> polygon;
+		while (_p < _end) {
+			const char* lineEnd = static_cast<const char*>(std::memchr(_p, '\n', _end - _p));
+			if (!lineEnd)
+				lineEnd = _end;
+			const char* p = SkipBlanks(_p, lineEnd);
+			_p = lineEnd + 1;
+			if (p == lineEnd)
+				continue;
+
+			if (p[0] == 'v' && lineEnd - p > 1) {
+				float values[3];
+				int count = p[1] == 't' ? 2 : 3;
+				std::vector<float>* stream = &_chunk.positions;
+				if (p[1] == 't')
+					stream = &_chunk.texCoords;
+				else if (p[1] == 'n')
+					stream = &_chunk.normals;
+				else if (!IsBlank(p[1]))
+					continue; // vp and others
+				p += IsBlank(p[1]) ? 1 : 2;
+				for (int i = 0; i < count; i++) {
+					p = ParseFloat(p, lineEnd, values[i]);
+					if (!p) {
+						if (stream == &_chunk.texCoords && i == 1) { // "vt u" has v = 0
+							values[1] = 0.0f;
+							break;
+						}
+						_chunk.failed = true;
+						return;
+					}
+				}
+				stream->insert(stream->end(), values, values + count);
+			}
+			else if (p[0] == 'f' && lineEnd - p > 1 && IsBlank(p[1])) {
+				polygon.clear();
+				p++;
+				while (true) {
+					p = SkipBlanks(p, lineEnd);
+					if (p == lineEnd)
+						break;
+					Corner corner = { kMissing, kMissing, kMissing, 0 };
+					bool relative = false;
+					p = ParseIndex(p, lineEnd, _chunk.positions.size() / 3, corner.position, relative);
+					if (!p) {
+						_chunk.failed = true;
+						return;
+					}
+					corner.relative |= relative ? 1u : 0u;
+					if (p < lineEnd && *p == '/') {
+						p++;
+						if (p < lineEnd && *p != '/') {
+							p = ParseIndex(p, lineEnd, _chunk.texCoords.size() / 2, corner.texCoord, relative);
+							if (!p) {
+								_chunk.failed = true;
+								return;
+							}
+							corner.relative |= relative ? 2u : 0u;
+						}
+						if (p < lineEnd && *p == '/') {
+							p = ParseIndex(p + 1, lineEnd, _chunk.normals.size() / 3, corner.normal, relative);
+							if (!p) {
+								_chunk.failed = true;
+								return;
+							}
+							corner.relative |= relative ? 4u : 0u;
+						}
+					}
+					polygon.push_back(corner);
+				}
+				// Fan, as aiProcess_Triangulate does for convex polygons
+				for (size_t i = 2; i < polygon.size(); i++) {
+					_chunk.corners.push_back(polygon[0]);
+					_chunk.corners.push_back(polygon[i - 1]);
+					_chunk.corners.push_back(polygon[i]);
+				}
+			}
+			else if ((p[0] == 'o' || p[0] == 'g') && (lineEnd - p == 1 || IsBlank(p[1])))
+				_chunk.markers.push_back({ _chunk.corners.size() / 3, MarkerKind::Object, Name(p + 1, lineEnd) });
+			else if (StartsWith(p, lineEnd, "usemtl"))
+				_chunk.markers.push_back({ _chunk.corners.size() / 3, MarkerKind::Material, Name(p + 6, lineEnd) });
+			else if (StartsWith(p, lineEnd, "mtllib"))
+				_chunk.markers.push_back({ _chunk.corners.size() / 3, MarkerKind::Library, Name(p + 6, lineEnd) });
+		}
+	}
+
+	// Concatenates the chunks' streams, each chunk learns where its elements start
+	static void MergeAttributes(std::vector<Chunk>& _chunks, Attributes& _attributes, unsigned int _threadCount)
+	{
+		size_t positions = 0, texCoords = 0, normals = 0;
+		for (Chunk& chunk : _chunks) {
+			chunk.positionBase = positions;
+			chunk.texCoordBase = texCoords;
+			chunk.normalBase = normals;
+			positions += chunk.positions.size() / 3;
+			texCoords += chunk.texCoords.size() / 2;
+			normals += chunk.normals.size() / 3;
+		}
+		_attributes.positions.resize(positions);
+		_attributes.texCoords.resize(texCoords);
+		_attributes.normals.resize(normals);
+		ParallelFor(_chunks.size(), _threadCount, 1, [&](size_t _begin, size_t _end) {
+			for (size_t i = _begin; i < _end; i++) {
+				Chunk& chunk = _chunks[i];
+				std::memcpy(_attributes.positions.data() + chunk.positionBase, chunk.positions.data(), chunk.positions.size() * sizeof(float));
+				std::memcpy(_attributes.texCoords.data() + chunk.texCoordBase, chunk.texCoords.data(), chunk.texCoords.size() * sizeof(float));
+				std::memcpy(_attributes.normals.data() + chunk.normalBase, chunk.normals.data(), chunk.normals.size() * sizeof(float));
+				std::vector<float>().swap(chunk.positions);
+				std::vector<float>().swap(chunk.texCoords);
+				std::vector<float>().swap(chunk.normals);
+			}
+		});
+	}
+
+	static uint32_t HashCorner(const Corner& _corner)
+	{
+		uint64_t key = (uint64_t)(uint32_t)_corner.position * 0x9E3779B97F4A7C15ull ^
+			(uint64_t)(uint32_t)_corner.texCoord * 0xC2B2AE3D27D4EB4Full ^
+			(uint64_t)(uint32_t)_corner.normal * 0x165667B19E3779F9ull;
+		return (uint32_t)(key ^ (key >> 29));
+	}
+
+	static bool BuildGroup(const GroupPlan& _plan, const std::vector<Chunk>& _chunks, const Attributes& _attributes,
+		unsigned int _threadCount, bool _flipTexCoords, Group& _group)
+	{
+		// Corners with absolute indices, checked against the streams
+		const size_t cornerCount = _plan.triangles * 3;
+		std::vector<Corner> corners(cornerCount);
+		std::vector<size_t> segmentStart(_plan.segments.size() + 1, 0);
+		for (size_t s = 0; s < _plan.segments.size(); s++)
+			segmentStart[s + 1] = segmentStart[s] + _plan.segments[s].triangleCount * 3;
+
+		std::atomic<bool> valid{ true };
+		ParallelFor(_plan.segments.size(), _threadCount, 1, [&](size_t _begin, size_t _end) {
+			for (size_t s = _begin; s < _end; s++) {
+				const Segment& segment = _plan.segments[s];
+				const Chunk& chunk = _chunks[segment.chunk];
+				const Corner* source = chunk.corners.data() + segment.firstTriangle * 3;
+				Corner* target = corners.data() + segmentStart[s];
+				for (size_t i = 0; i < segment.triangleCount * 3; i++) {
+					Corner corner = source[i];
+					if (corner.relative & 1u) corner.position += (int32_t)chunk.positionBase;
+					if (corner.relative & 2u) corner.texCoord += (int32_t)chunk.texCoordBase;
+					if (corner.relative & 4u) corner.normal += (int32_t)chunk.normalBase;
+					corner.relative = 0;
+					if (corner.position < 0 || (size_t)corner.position >= _attributes.positions.size() ||
+						(corner.texCoord != kMissing && (corner.texCoord < 0 || (size_t)corner.texCoord >= _attributes.texCoords.size())) ||
+						(corner.normal != kMissing && (corner.normal < 0 || (size_t)corner.normal >= _attributes.normals.size())))
+						valid = false;
+					target[i] = corner;
+				}
+			}
+		});
+		if (!valid)
+			return false;
+
+		// Each slot ends up with the lowest corner of its tuple
+		size_t tableSize = 1;
+		while (tableSize < cornerCount * 2)
+			tableSize <<= 1;
+		const uint32_t mask = (uint32_t)(tableSize - 1);
+		std::unique_ptr<std::atomic<uint32_t>[]> slots(new std::atomic<uint32_t>[tableSize]);
+		std::vector<uint32_t> cornerSlot(cornerCount);
+		ParallelFor(tableSize, _threadCount, kMinItemsPerThread, [&](size_t _begin, size_t _end) {
+			for (size_t i = _begin; i < _end; i++)
+				slots[i].store(kEmptySlot, std::memory_order_relaxed);
+		});
+		ParallelFor(cornerCount, _threadCount, kMinItemsPerThread, [&](size_t _begin, size_t _end) {
+			for (size_t c = _begin; c < _end; c++) {
+				const uint32_t corner = (uint32_t)c;
+				uint32_t slot = HashCorner(corners[c]) & mask;
+				while (true) {
+					uint32_t owner = slots[slot].load(std::memory_order_acquire);
+					if (owner == kEmptySlot && slots[slot].compare_exchange_strong(owner, corner, std::memory_order_acq_rel))
+						break;
+					// owner is set now, and the tuple of any corner that replaces it is the same
+					if (corners[owner] == corners[c]) {
+						while (corner < owner && !slots[slot].compare_exchange_weak(owner, corner, std::memory_order_acq_rel)) {}
+						break;
+					}
+					slot = (slot + 1) & mask;
+				}
+				cornerSlot[c] = slot;
+			}
+		});
+
+		// Vertices in first-use order
+		std::vector<uint32_t> slotVertex(tableSize);
+		std::vector<uint32_t> vertexCorner;
+		vertexCorner.reserve(cornerCount / 2);
+		for (size_t c = 0; c < cornerCount; c++) {
+			uint32_t slot = cornerSlot[c];
+			if (slots[slot].load(std::memory_order_relaxed) == (uint32_t)c) {
+				slotVertex[slot] = (uint32_t)vertexCorner.size();
+				vertexCorner.push_back((uint32_t)c);
+			}
+		}
+
+		_group.indices.resize(cornerCount);
+		ParallelFor(cornerCount, _threadCount, kMinItemsPerThread, [&](size_t _begin, size_t _end) {
+			for (size_t c = _begin; c < _end; c++)
+				_group.indices[c] = slotVertex[cornerSlot[c]];
+		});
+
+		_group.vertices.resize(vertexCorner.size()); // zeroed: missing normals / texture coordinates and tangents
+		ParallelFor(vertexCorner.size(), _threadCount, kMinItemsPerThread, [&](size_t _begin, size_t _end) {
+			for (size_t v = _begin; v < _end; v++) {
+				const Corner& corner = corners[vertexCorner[v]];
+				Vertex& vertex = _group.vertices[v];
+				vertex.position = _attributes.positions[corner.position];
+				if (corner.normal != kMissing)
+					vertex.normal = _attributes.normals[corner.normal];
+				if (corner.texCoord != kMissing) {
+					vertex.texCoords = _attributes.texCoords[corner.texCoord];
+					if (_flipTexCoords)
+						vertex.texCoords.y = 1.0f - vertex.texCoords.y;
+				}
+			}
+		});
+		return true;
+	}
+
+	static void ParseMaterials(const std::string& _path, std::vector<Material>& _materials)
+	{
+		MappedFile file(_path);
+		if (!file.IsOpen())
+			return;
+
+		const char* p = file.Data();
+		const char* end = p + file.Size();
+		while (p < end) {
+			const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+			if (!lineEnd)
+				lineEnd = end;
+			const char* line = SkipBlanks(p, lineEnd);
+			p = lineEnd + 1;
+
+			if (StartsWith(line, lineEnd, "newmtl")) {
+				_materials.emplace_back();
+				_materials.back().name = Name(line + 6, lineEnd);
+				continue;
+			}
+			if (_materials.empty())
+				continue;
+
+			std::string* map = nullptr;
+			Material& material = _materials.back();
+			if (StartsWith(line, lineEnd, "map_Kd")) map = &material.diffuse;
+			else if (StartsWith(line, lineEnd, "map_Ks")) map = &material.specular;
+			else if (StartsWith(line, lineEnd, "map_Ka")) map = &material.ambient;
+			else if (StartsWith(line, lineEnd, "map_Bump") || StartsWith(line, lineEnd, "map_bump")) map = &material.bump;
+			else if (StartsWith(line, lineEnd, "bump")) map = &material.bump;
+			if (!map)
+				continue;
+
+			// The file is the last token, options such as -bm 1 come before it
+			std::string value = Name(line, lineEnd);
+			size_t split = value.find_last_of(" \t");
+			*map = split == std::string::npos ? std::string() : value.substr(split + 1);
+		}
+	}
+};
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+// On-disk cache of linked program binaries (glGetProgramBinary / glProgramBinary).
+//
+// Every program is keyed by a 64-bit hash of its preprocessed sources (so injected #defines are
+// part of the key) together with the GL vendor, renderer and version strings. When the driver
+// rejects a cached binary (e.g. after a driver update) the caller simply falls back to compiling
+// from source and the entry is overwritten.
+//
+// Usage:
+//   ProgramBinaryCache::Get().SetEnabled(true);   // before creating any Shader
+//   ...
+//   ProgramBinaryCache::Get().PrintStats();       // after init, per program hits / misses / times
+class ProgramBinaryCache
+{
+public:
+	struct Stats
+	{
+		unsigned int hits = 0;
+		unsigned int misses = 0;
+		float hitMilliseconds = 0.0f;  // accumulated build time of all hits
+		float missMilliseconds = 0.0f; // accumulated build time of all misses (compile + link + store)
+	};
+
+	static ProgramBinaryCache& Get()
+	{
+		static ProgramBinaryCache cache;
+		return cache;
+	}
+
+	ProgramBinaryCache(const ProgramBinaryCache&) = delete;
+	ProgramBinaryCache& operator=(const ProgramBinaryCache&) = delete;
+
+	void SetEnabled(bool _enabled) { enabled = _enabled; }
+	void SetDirectory(const std::string& _directory) { directory = _directory; }
+
+	// Enabled by the user and supported by the driver (needs a current GL context)
+	bool IsActive()
+	{
+		if (!enabled)
+			return false;
+
+		if (supported < 0) {
+			GLint formats = 0;
+			if (GLEW_ARB_get_program_binary || GLEW_VERSION_4_1)
+				glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			supported = (formats > 0) ? 1 : 0;
+#ifdef _DEBUG
+			if (!supported)
+				std::cerr << "Program binary cache disabled: driver exposes no program binary formats.\n";
+#endif
+		}
+		return supported == 1;
+	}
+
+	uint64_t MakeKey(const std::string& _vertexSource, const std::string& _fragmentSource,
+		const std::string& _geometrySource)
+	{
+		if (driverSignature.empty()) {
+			auto glString = [](GLenum name) {
+				const GLubyte* str = glGetString(name);
+				return str ? std::string(reinterpret_cast<const char*>(str)) : std::string();
+			};
+			driverSignature = glString(GL_VENDOR) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION);
+		}
+
+		uint64_t hash = Hash(driverSignature);
+		hash = Hash(_vertexSource, Hash("\nvs\n", hash));
+		hash = Hash(_fragmentSource, Hash("\nfs\n", hash));
+		hash = Hash(_geometrySource, Hash("\ngs\n", hash));
+		return hash;
+	}
+
+	// Tries to initialize _program from the cached binary, returns false on a miss or driver mismatch.
+	bool Load(unsigned int _program, uint64_t _key) const
+	{
+		std::ifstream file(PathFor(_key), std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		Header header;
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!file || header.magic != kMagic || header.version != kVersion || header.key != _key || header.length == 0)
+			return false;
+
+		std::vector<char> binary(header.length);
+		file.read(binary.data(), header.length);
+		if (!file)
+			return false;
+
+		glProgramBinary(_program, header.format, binary.data(), (GLsizei)header.length);
+
+		GLint linked = GL_FALSE;
+		glGetProgramiv(_program, GL_LINK_STATUS, &linked);
+		return linked == GL_TRUE;
+	}
+
+	// Writes the binary of a successfully linked program, linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+	void Store(unsigned int _program, uint64_t _key) const
+	{
+		GLint linked = GL_FALSE, length = 0;
+		glGetProgramiv(_program, GL_LINK_STATUS, &linked);
+		glGetProgramiv(_program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (linked != GL_TRUE || length <= 0)
+			return;
+
+		std::vector<char> binary(length);
+		Header header;
+		header.key = _key;
+		glGetProgramBinary(_program, length, nullptr, &header.format, binary.data());
+		header.length = (uint32_t)length;
+
+		// Written under a unique temporary name and renamed over the entry, so a crash or another
+		// instance storing the same program never leaves a truncated file for Load() to read
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		std::ostringstream tempPath;
+		tempPath << PathFor(_key) << ".tmp" << std::hex << std::random_device()();
+		{
+			std::ofstream file(tempPath.str(), std::ios::binary | std::ios::trunc);
+			if (file.is_open()) {
+				file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+				file.write(binary.data(), length);
+				file.close();
+			}
+			if (!file) {
+#ifdef _DEBUG
+				std::cerr << "Program binary cache: failed to write " << tempPath.str() << "\n";
+#endif
+				std::filesystem::remove(tempPath.str(), error);
+				return;
+			}
+		}
+		std::filesystem::rename(tempPath.str(), PathFor(_key), error);
+		if (error) {
+#ifdef _DEBUG
+			std::cerr << "Program binary cache: failed to replace " << PathFor(_key) << ": " << error.message() << "\n";
+#endif
+			std::filesystem::remove(tempPath.str(), error);
+		}
+	}
+
+	void Record(const std::string& _label, bool _hit, float _milliseconds)
+	{
+		Stats& entry = stats[_label];
+		if (_hit) {
+			entry.hits++;
+			entry.hitMilliseconds += _milliseconds;
+		}
+		else {
+			entry.misses++;
+			entry.missMilliseconds += _milliseconds;
+		}
+	}
+
+	const std::map<std::string, Stats>& GetStats() const { return stats; }
+
+	void PrintStats() const
+	{
+		std::cout << "Program binary cache (" << (enabled ? "enabled" : "disabled") << "):\n";
+		for (const auto& [label, entry] : stats) {
+			std::cout << "  " << label << ": " << entry.hits << " hit(s) " << entry.hitMilliseconds << " ms, "
+				<< entry.misses << " miss(es) " << entry.missMilliseconds << " ms\n";
+		}
+	}
+
+private:
+	ProgramBinaryCache() = default;
+
+	struct Header
+	{
+		uint32_t magic = kMagic;
+		uint32_t version = kVersion;
+		uint64_t key = 0;
+		GLenum format = 0;
+		uint32_t length = 0;
+	};
+
+	static constexpr uint32_t kMagic = 0x42505247; // "GRPB"
+	static constexpr uint32_t kVersion = 1;
+
+	// 64-bit FNV-1a
+	static uint64_t Hash(const std::string& _data, uint64_t _hash = 14695981039346656037ull)
+	{
+		for (unsigned char c : _data) {
+			_hash ^= c;
+			_hash *= 1099511628211ull;
+		}
+		return _hash;
+	}
+
+	std::string PathFor(uint64_t _key) const
+	{
+		std::ostringstream path;
+		path << directory << '/' << std::hex << std::setw(16) << std::setfill('0') << _key << ".bin";
+		return path.str();
+	}
+
+private:
+	bool enabled = true;
+	int supported = -1; // -1 not queried yet, 0 unsupported, 1 supported
+	std::string directory = "shader_cache";
+	std::string driverSignature; // vendor, renderer and version, part of every key
+	std::map<std::string, Stats> stats; // per program label (shader file paths)
+};
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "draw_uniforms.h"
+#include "geometry_renderers.h"
+#include "gl_state_cache.h"
+#include "mesh.h"
+#include "model.h"
+#include "shader.h"
+
+// Textures a yzh:: primitive draw needs, bound through the GLStateCache before the draw.
+// id is the material part of the sort key, draws with the same id are grouped together.
+struct TextureSet
+{
+	struct Slot
+	{
+		unsigned int unit;
+		GLenum target;
+		GLuint texture;
+	};
+
+	uint32_t id = 0; // 1..0x7FFFFF, 0 means "no textures"
+	std::vector<Slot> slots;
+};
+
+// Collects the draws of a frame, sorts them by a 64-bit key and then issues them, so draws that
+// share a program and textures end up next to each other no matter in which order they were
+// submitted.
+//
+// Key layout (most significant first):
+//   63..56  pass           lower passes draw first (e.g. opaque 0, skybox 1)
+//   55..40  program        low 16 bits of the GL program id
+//   39..16  material       TextureSet::id, or 0x800000 | first texture id for Mesh draws
+//   15..0   depth bucket   front to back inside the same program and material
+//
+// Usage:
+//   RenderQueue queue;
+//   queue.Submit(0, shader, sphere, &material, RenderQueue::DepthBucket(viewDepth, farPlane), ring.Write(drawData));
+//   queue.SubmitModel(0, shader, model, Mesh::kAllTextureTypes, depth, ring.Write(drawData));
+//   queue.Execute(&ring);  // sorts, draws and clears
+class RenderQueue
+{
+public:
+	struct Stats
+	{
+		unsigned int draws = 0;
+		unsigned int programSwitches = 0;         // issued after sorting
+		unsigned int textureSwitches = 0;         // material changes issued after sorting
+		unsigned int unsortedProgramSwitches = 0; // what submission order would have cost
+		unsigned int unsortedTextureSwitches = 0;
+	};
+
+	static constexpr GLintptr kNoDrawData = -1;
+
+	static uint64_t MakeKey(uint32_t _pass, uint32_t _program, uint32_t _material, uint32_t _depthBucket)
+	{
+		return ((uint64_t)(_pass & 0xFF) << 56) |
+			((uint64_t)(_program & 0xFFFF) << 40) |
+			((uint64_t)(_material & 0xFFFFFF) << 16) |
+			(uint64_t)(_depthBucket & 0xFFFF);
+	}
+
+	// Quantizes a positive view-space depth into the 16-bit bucket of the key
+	static uint32_t DepthBucket(float _viewDepth, float _farPlane)
+	{
+		float normalized = std::clamp(_viewDepth / _farPlane, 0.0f, 1.0f);
+		return (uint32_t)(normalized * 65535.0f);
+	}
+
+	void Submit(uint32_t _pass, Shader& _shader, yzh::GeometryShape& _shape, const TextureSet* _textures,
+		uint32_t _depthBucket, GLintptr _drawDataOffset = kNoDrawData)
+	{
+		DrawItem item;
+		item.shader = &_shader;
+		item.shape = &_shape;
+		item.textures = _textures;
+		item.drawDataOffset = _drawDataOffset;
+		item.material = _textures ? _textures->id : 0;
+		items.push_back(item);
+		keys.push_back(MakeKey(_pass, _shader.GetID(), item.material, _depthBucket));
+	}
+
+	void Submit(uint32_t _pass, Shader& _shader, const Mesh& _mesh, uint32_t _textureTypeMask,
+		uint32_t _depthBucket, GLintptr _drawDataOffset = kNoDrawData)
+	{
+		DrawItem item;
+		item.shader = &_shader;
+		item.mesh = &_mesh;
+		item.textureTypeMask = _textureTypeMask;
+		item.drawDataOffset = _drawDataOffset;
+		item.material = _mesh.textures.empty() ? 0 : (0x800000 | (_mesh.textures[0].id & 0x7FFFFF));
+		items.push_back(item);
+		keys.push_back(MakeKey(_pass, _shader.GetID(), item.material, _depthBucket));
+	}
+
+	// Every mesh of the model as its own item, all sharing one draw data slice
+	void SubmitModel(uint32_t _pass, Shader& _shader, const Model& _model, uint32_t _textureTypeMask,
+		uint32_t _depthBucket, GLintptr _drawDataOffset = kNoDrawData)
+	{
+		for (const Mesh& mesh : _model.GetMesh())
+			Submit(_pass, _shader, mesh, _textureTypeMask, _depthBucket, _drawDataOffset);
+	}
+
+	// Sorts the submitted draws, issues them and clears the queue. _drawUniforms binds the
+	// per-draw slices written at submit time, it may be null when no item has draw data.
+	void Execute(DrawUniformRing* _drawUniforms)
+	{
+		stats = Stats();
+		stats.draws = (unsigned int)items.size();
+		CountSwitches(Identity(items.size()), stats.unsortedProgramSwitches, stats.unsortedTextureSwitches);
+
+		const std::vector<uint32_t>& sorted = SortedOrder();
+		CountSwitches(sorted, stats.programSwitches, stats.textureSwitches);
+
+		GLStateCache& state = GLStateCache::Get();
+		const Shader* boundShader = nullptr;
+		const TextureSet* boundTextures = nullptr;
+		for (uint32_t index : sorted) {
+			const DrawItem& item = items[index];
+			if (item.shader != boundShader) {
+				item.shader->Bind();
+				boundShader = item.shader;
+			}
+			if (item.drawDataOffset != kNoDrawData && _drawUniforms)
+				_drawUniforms->BindSlice(item.drawDataOffset);
+
+			if (item.mesh) {
+				item.mesh->Render(*item.shader, item.textureTypeMask); // binds from its cached binding table
+				boundTextures = nullptr;
+			}
+			else {
+				if (item.textures && item.textures != boundTextures) {
+					for (const TextureSet::Slot& slot : item.textures->slots)
+						state.BindTexture(slot.unit, slot.target, slot.texture);
+					boundTextures = item.textures;
+				}
+				item.shape->Render();
+			}
+		}
+
+		items.clear();
+		keys.clear();
+	}
+
+	// Statistics of the last Execute()
+	const Stats& GetStats() const { return stats; }
+
+private:
+	struct DrawItem
+	{
+		Shader* shader = nullptr;
+		const Mesh* mesh = nullptr;
+		uint32_t textureTypeMask = Mesh::kAllTextureTypes;
+		yzh::GeometryShape* shape = nullptr;
+		const TextureSet* textures = nullptr;
+		GLintptr drawDataOffset = kNoDrawData;
+		uint32_t material = 0;
+	};
+
+	const std::vector<uint32_t>& Identity(size_t _count)
+	{
+		order.resize(_count);
+		for (uint32_t i = 0; i < (uint32_t)_count; i++)
+			order[i] = i;
+		return order;
+	}
+
+	// LSD radix sort of the item indices by key, 8 bits per pass. Passes in which every key has
+	// the same byte are skipped, so only the bytes that actually differ cost anything.
+	const std::vector<uint32_t>& SortedOrder()
+	{
+		const size_t count = keys.size();
+		Identity(count);
+		scratch.resize(count);
+
+		for (int shift = 0; shift < 64; shift += 8) {
+			uint32_t histogram[256] = {};
+			for (uint32_t index : order)
+				histogram[(keys[index] >> shift) & 0xFF]++;
+			if (count == 0 || histogram[(keys[order[0]] >> shift) & 0xFF] == count)
+				continue;
+
+			uint32_t offset = 0;
+			for (uint32_t& bucket : histogram) {
+				uint32_t size = bucket;
+				bucket = offset;
+				offset += size;
+			}
+			for (uint32_t index : order)
+				scratch[histogram[(keys[index] >> shift) & 0xFF]++] = index;
+			order.swap(scratch);
+		}
+		return order;
+	}
+
+	void CountSwitches(const std::vector<uint32_t>& _order, unsigned int& _programSwitches, unsigned int& _textureSwitches) const
+	{
+		const Shader* shader = nullptr;
+		uint32_t material = ~0u;
+		for (uint32_t index : _order) {
+			const DrawItem& item = items[index];
+			if (item.shader != shader) {
+				_programSwitches++;
+				shader = item.shader;
+			}
+			if (item.material != material) {
+				if (item.material != 0)
+					_textureSwitches++;
+				material = item.material;
+			}
+		}
+	}
+
+private:
+	std::vector<DrawItem> items;
+	std::vector<uint64_t> keys;     // parallel to items
+	std::vector<uint32_t> order;    // item indices, sorted by key after SortedOrder()
+	std::vector<uint32_t> scratch;
+	Stats stats;
+};
\ No newline at end of file
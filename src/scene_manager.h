@@ -13,6 +13,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <GLFW/glfw3.h>
 #include "camera.h"
+#include "gl_state_cache.h"
+#include "texture_manager.h"
 
 // A utility class holding window pointer & camera object
 // 
@@ -56,8 +58,8 @@ public:
 	}
 
 	// Utility functions
-	void Enable(GLenum content) { glEnable(content); }
-	void Disable(GLenum content) { glDisable(content); }
+	void Enable(GLenum content) { GLStateCache::Get().Enable(content); }
+	void Disable(GLenum content) { GLStateCache::Get().Disable(content); }
 	unsigned int LoadTexture(const std::string& path, bool isHDR = false);
 	void UpdateDeltaTime(); // to calculate deltaTima each frame
 	void CheckFramebufferStatus(unsigned int fbo, const std::string& framebufferName);
@@ -131,7 +133,7 @@ void SceneManager::framebuffer_size_callback(GLFWwindow* window, int width, int
 {
 	// make sure the viewport matches the new window dimensions; note that SCR_WIDTH and 
 	// SCR_HEIGHT will be significantly larger than specified on retina displays.
-	glViewport(0, 0, width, height);
+	GLStateCache::Get().Viewport(0, 0, width, height);
 	this->SCR_WIDTH = width;
 	this->SCR_HEIGHT = height;
 }
@@ -199,63 +201,16 @@ void SceneManager::ProcessInput()
 		camera->ProcessKeyboard(RIGHT, deltaTime);
 }
 
-// Utility function for loading a 2D texture from file
+// Utility function for loading a 2D texture from file, shared through the TextureManager
 // Loading HDR texture when isHDR is true
 unsigned int SceneManager::LoadTexture(const std::string& path, bool isHDR)
 {
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-
-	int width, height, nrComponents;
-	void* data;
-
-	// Using stbi_load or stbi_loadf for different texture type
-	if (!isHDR) {
-		data = stbi_load(path.c_str(), &width, &height, &nrComponents, 0);
-	}
-	else {
-		stbi_set_flip_vertically_on_load(true);
-		data = stbi_loadf(path.c_str(), &width, &height, &nrComponents, 0);
-	}
-
-	if (data) {
-		GLenum format;
-		GLenum dataType = (isHDR) ? GL_FLOAT : GL_UNSIGNED_BYTE; // Set GL_FLOAT or GL_UNSIGNED_BYTE for different texture data type
-		GLint internalFormat; // Using 16-bit float format for HDR, otherwise internalFormat equals to format
-
-		if (nrComponents == 1) format = internalFormat = GL_RED;
-		else if (nrComponents == 3) format = internalFormat = GL_RGB;
-		else if (nrComponents == 4) format = internalFormat = GL_RGBA;
-		else std::cerr << "Invalid texture format: Unsupported number of components!\n";
-
-		if (isHDR) internalFormat = GL_RGB16F;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, dataType, data);
-		if (!isHDR)
-			glGenerateMipmap(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		if (!isHDR)
-			stbi_image_free(data);
-		else
-			stbi_image_free((float*)data);
-	}
-	else {
-		std::cerr << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-		return -1;
-	}
-
-	return textureID;
+	return TextureManager::Get().Acquire(path, isHDR);
 }
 
 void SceneManager::CheckFramebufferStatus(unsigned int fbo, const std::string& framebufferName)
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	GLStateCache::Get().BindFramebuffer(fbo);
 	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
 	if (status != GL_FRAMEBUFFER_COMPLETE) {
 		std::cerr << "Framebuffer (" << framebufferName << ") with ID (" << fbo << ") is not complete! Error code: " << status << std::endl;
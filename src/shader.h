@@ -1,14 +1,107 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
-#include <sstream>
+#include <optional>
 #include <string>
+#include <tuple>
+#include <type_traits>
 #include <unordered_set>
+#include <vector>
 
 #include <GL/glew.h>
+#include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include "gl_state_cache.h"
+#include "program_binary_cache.h"
+
+// KHR_parallel_shader_compile is newer than the bundled GLEW headers
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRY* PFNMAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+
+// 32-bit FNV-1a hash used as the key of the uniform location table.
+// _hash continues a previous hash, which lets array element names be hashed piece by piece.
+constexpr uint32_t HashUniformName(const char* _name, uint32_t _hash = 2166136261u)
+{
+	while (*_name) {
+		_hash ^= static_cast<uint8_t>(*_name++);
+		_hash *= 16777619u;
+	}
+	return _hash;
+}
+
+// Hash of "_baseName[_index]" without building the string.
+constexpr uint32_t HashUniformElement(const char* _baseName, int _index)
+{
+	char digits[11] = {};
+	int count = 0;
+	do {
+		digits[count++] = static_cast<char>('0' + _index % 10);
+		_index /= 10;
+	} while (_index > 0);
+
+	uint32_t hash = HashUniformName("[", HashUniformName(_baseName));
+	while (count > 0) {
+		hash ^= static_cast<uint8_t>(digits[--count]);
+		hash *= 16777619u;
+	}
+	return HashUniformName("]", hash);
+}
+
+// A uniform name together with its precomputed hash. Built from a string literal it can be
+// a constexpr value, so the per-draw setters neither allocate nor hash anything at runtime.
+//
+// Usage:
+//   constexpr UniformName u_model("model");
+//   constexpr auto u_lightPositions = MakeUniformArray<4>("lightPositions");
+//   shader.Set(u_model, model);
+//   shader.Set(u_lightPositions[i], lightPositions[i]);
+struct UniformName
+{
+	constexpr UniformName() = default;
+	constexpr UniformName(const char* _name)
+		: name(_name), hash(HashUniformName(_name)) {}
+	constexpr UniformName(const char* _baseName, int _index)
+		: name(_baseName), index(_index), hash(HashUniformElement(_baseName, _index)) {}
+	// Keeps _name.c_str(), so the string has to outlive the handle; temporaries are rejected
+	explicit UniformName(const std::string& _name)
+		: UniformName(_name.c_str()) {}
+	UniformName(std::string&&) = delete;
+
+	// Only used to print warnings, so the allocation never happens on the regular path
+	std::string ToString() const
+	{
+		return (index < 0) ? std::string(name) : std::string(name) + "[" + std::to_string(index) + "]";
+	}
+
+	const char* name = "";
+	int index = -1; // element index for array uniforms, -1 otherwise
+	uint32_t hash = HashUniformName("");
+};
+
+// Precomputes the handles of every element of a uniform array, e.g. lightPositions[0..N-1].
+template <size_t N>
+constexpr std::array<UniformName, N> MakeUniformArray(const char* _baseName)
+{
+	std::array<UniformName, N> names{};
+	for (size_t i = 0; i < N; i++)
+		names[i] = UniformName(_baseName, static_cast<int>(i));
+	return names;
+}
+
+// Permutation defines of a shader variant, as (name, value) pairs.
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
 // The Shader class encapsulates OpenGL shader programs.
 // It provides functionalities for creating, compiling, and linking shaders,
 // as well as setting uniform variables.
@@ -16,10 +109,14 @@
 // Usage Example:
 // Shader shader("vertexShaderPath", "fragmentShaderPath");
 // Shader shader("vertexShaderPath", "fragmentShaderPath", "geometryShaderPath");
+// Shader shader("vertexShaderPath", "fragmentShaderPath", ShaderDefines{ { "NR_LIGHTS", "4" }, { "TEXTURED", "1" } });
 // 
 // shader.Bind();
 // shader.SetVec3("some_uniform", glm::vec3(1.0f, 0.0f, 0.0f));
 // shader.Unbind();
+//
+// All active uniform locations are cached right after linking, so the setters never query the driver.
+// Linked programs are stored in the ProgramBinaryCache and reloaded from disk on the next launch.
 // ------------------
 class Shader
 {
@@ -28,28 +125,98 @@ public:
 
 	Shader(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, const std::string& geometryShaderPath = "")
 	{
-		const auto& [vertexSource, fragmentSource, geometrySource] = ParseShader(vertexShaderPath, fragmentShaderPath, geometryShaderPath);
-		m_rendererID = CreateShader(vertexSource, fragmentSource, geometrySource);
+		Build(vertexShaderPath, fragmentShaderPath, geometryShaderPath, ShaderDefines());
+	}
 
-#ifdef _DEBUG
-		std::cout << "successfully create and compile shader: \n" << vertexShaderPath <<
-			"\n" << fragmentShaderPath << "\n" << geometryShaderPath;
-#endif 
+	// Builds one permutation of a shader pair, every (name, value) in _defines becomes
+	// "#define name value" right after the #version line of each stage.
+	Shader(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, const ShaderDefines& _defines)
+	{
+		Build(vertexShaderPath, fragmentShaderPath, "", _defines);
 	}
 
 	~Shader()
 	{
+		if (m_pending)
+			DeleteShaderObjects();
+		GLStateCache::Get().ForgetProgram(m_rendererID);
 		glDeleteProgram(m_rendererID);
 	}
 
+	// Async build mode: while enabled, constructors only submit compile and link work to the driver
+	// and return immediately, so several programs can compile while the caller keeps loading assets.
+	// Completion is polled with IsReady() or forced with WaitUntilReady() (Bind() and the uniform setters also wait).
+	//
+	// Usage:
+	//   Shader::SetAsyncBuild(true);
+	//   Shader a(...), b(...);          // both are compiling now
+	//   LoadTextures();                 // overlaps with the driver compiling a and b
+	//   Shader::SetAsyncBuild(false);
+	//   if (a.IsReady()) { a.Bind(); ... }
+	static void SetAsyncBuild(bool _async) { AsyncBuildFlag() = _async; }
+	static bool IsAsyncBuild() { return AsyncBuildFlag(); }
+
+	// True when the driver exposes KHR/ARB_parallel_shader_compile, i.e. IsReady() never blocks.
+	// The first call also lets the driver use as many compiler threads as it wants
+	// (glMaxShaderCompilerThreadsKHR), which is what makes the submitted builds run in parallel.
+	static bool HasParallelCompile()
+	{
+		static int supported = -1;
+		if (supported < 0) {
+			supported = 0;
+			const char* threadsProc = nullptr;
+			GLint count = 0;
+			glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+			for (GLint i = 0; i < count && !supported; i++) {
+				const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, (GLuint)i));
+				if (extension && std::strcmp(extension, "GL_KHR_parallel_shader_compile") == 0)
+					threadsProc = "glMaxShaderCompilerThreadsKHR";
+				else if (extension && std::strcmp(extension, "GL_ARB_parallel_shader_compile") == 0)
+					threadsProc = "glMaxShaderCompilerThreadsARB";
+				supported = threadsProc ? 1 : 0;
+			}
+
+			// Not in the bundled GLEW headers, so the entry point is loaded through GLFW
+			auto maxCompilerThreads = threadsProc ? reinterpret_cast<PFNMAXSHADERCOMPILERTHREADSPROC>(glfwGetProcAddress(threadsProc)) : nullptr;
+			if (maxCompilerThreads)
+				maxCompilerThreads(0xFFFFFFFFu); // implementation-defined maximum
+		}
+		return supported == 1;
+	}
+
+	// Non-blocking when parallel compile is available: polls GL_COMPLETION_STATUS_KHR and finishes
+	// the build (error check, binary cache store, uniform table) once the link is done.
+	// Without the extension any status query blocks, so the build is simply finished here.
+	bool IsReady() const
+	{
+		if (!m_pending)
+			return true;
+
+		if (HasParallelCompile()) {
+			GLint completed = GL_FALSE;
+			glGetProgramiv(m_rendererID, GL_COMPLETION_STATUS_KHR, &completed);
+			if (completed == GL_FALSE)
+				return false;
+		}
+		FinishBuild();
+		return true;
+	}
+
+	void WaitUntilReady() const
+	{
+		if (m_pending)
+			FinishBuild();
+	}
+
 	void Bind() const
 	{
-		glUseProgram(m_rendererID);
+		WaitUntilReady();
+		GLStateCache::Get().UseProgram(m_rendererID); // no-op when already current
 	}
 
 	void Unbind() const
 	{
-		glUseProgram(0);
+		GLStateCache::Get().UseProgram(0);
 	}
 
 	unsigned int GetID() const
@@ -57,84 +224,89 @@ public:
 		return m_rendererID;
 	}
 
-	void SetVec3(const std::string& _name, const glm::vec3& value)
+	// Unique per built program, unlike GetID() which the driver reuses after a program is deleted.
+	// Caches derived from a program (e.g. Mesh binding tables) key on this to never go stale.
+	uint64_t GetGeneration() const
 	{
-		GLint location = glGetUniformLocation(m_rendererID, _name.c_str());
-
-#ifdef _DEBUG
-		if (location == -1 && warnedUniforms.find(_name) == warnedUniforms.end()) {
-			std::cerr << "Warning: Uniform '" << _name << "' not found or shader program not linked.\n";
-			warnedUniforms.insert(_name);
-		}
-#endif
-		glUniform3fv(location, 1, &value[0]);
+		return m_generation;
 	}
 
-	void SetVec3(const std::string& _name, float _x, float _y, float _z)
+	// Returns the location of a uniform from the table built right after linking.
+	// No driver query happens here, resolve the location once outside the render loop
+	// and pass it to the location based setters below for the per-draw hot path.
+	//
+	// Usage:
+	//   GLint modelLocation = shader.GetUniformLocation("model");
+	//   shader.SetMat4(modelLocation, model); // inside the draw loop
+	//
+	// A build still in flight is finished first, otherwise the table would be empty.
+	GLint GetUniformLocation(UniformName _name)
 	{
-		glm::vec3 value(_x, _y, _z);
-		GLint location = glGetUniformLocation(m_rendererID, _name.c_str());
+		WaitUntilReady();
+		GLint location = FindUniformLocation(_name);
 
 #ifdef _DEBUG
-		if (location == -1 && warnedUniforms.find(_name) == warnedUniforms.end()) {
-			std::cerr << "Warning: Uniform '" << _name << "' not found or shader program not linked.\n";
-			warnedUniforms.insert(_name);
+		if (location == -1 && warnedUniforms.find(_name.hash) == warnedUniforms.end()) {
+			std::cerr << "Warning: Uniform '" << _name.ToString() << "' not found or shader program not linked.\n";
+			warnedUniforms.insert(_name.hash);
 		}
 #endif
-		glUniform3fv(location, 1, &value[0]);
+		return location;
 	}
 
-	void SetVec2(const std::string& _name, const glm::vec2& value)
+	// Sets a uniform of any supported type (int, bool, float, glm::vec2/3/4, glm::mat3/4).
+	// With a constexpr UniformName this is a table probe plus the glUniform* call, nothing else.
+	template <typename T>
+	void Set(UniformName _name, const T& _value)
 	{
-		GLint location = glGetUniformLocation(m_rendererID, _name.c_str());
-
-#ifdef _DEBUG
-		if (location == -1 && warnedUniforms.find(_name) == warnedUniforms.end()) {
-			std::cerr << "Warning: Uniform '" << _name << "' not found or shader program not linked.\n";
-			warnedUniforms.insert(_name);
-		}
-#endif
-		glUniform2fv(location, 1, &value[0]);
+		GLint location = GetUniformLocation(_name);
+
+		if constexpr (std::is_same_v<T, int> || std::is_same_v<T, bool>)
+			SetInt(location, static_cast<int>(_value));
+		else if constexpr (std::is_same_v<T, float>)
+			SetFloat(location, _value);
+		else if constexpr (std::is_same_v<T, glm::vec2>)
+			SetVec2(location, _value);
+		else if constexpr (std::is_same_v<T, glm::vec3>)
+			SetVec3(location, _value);
+		else if constexpr (std::is_same_v<T, glm::vec4>)
+			SetVec4(location, _value);
+		else if constexpr (std::is_same_v<T, glm::mat3>)
+			SetMat3(location, _value);
+		else if constexpr (std::is_same_v<T, glm::mat4>)
+			SetMat4(location, _value);
+		else
+			static_assert(sizeof(T) == 0, "Shader::Set: unsupported uniform type");
 	}
 
-	void SetMat4(const std::string& _name, const glm::mat4& _mat)
+	void SetVec3(UniformName _name, const glm::vec3& value)
 	{
-		GLint location = glGetUniformLocation(m_rendererID, _name.c_str());
-
-#ifdef _DEBUG
-		if (location == -1 && warnedUniforms.find(_name) == warnedUniforms.end()) {
-			std::cerr << "Warning: Uniform '" << _name << "' not found or shader program not linked.\n";
-			warnedUniforms.insert(_name);
-		}
-#endif
-		glUniformMatrix4fv(location, 1, GL_FALSE, &_mat[0][0]);
+		SetVec3(GetUniformLocation(_name), value);
 	}
 
-	void SetMat3(const std::string& _name, const glm::mat3& _mat)
+	void SetVec3(UniformName _name, float _x, float _y, float _z)
 	{
-		GLint location = glGetUniformLocation(m_rendererID, _name.c_str());
+		SetVec3(GetUniformLocation(_name), glm::vec3(_x, _y, _z));
+	}
 
-#ifdef _DEBUG
-		if (location == -1 && warnedUniforms.find(_name) == warnedUniforms.end()) {
-			std::cerr << "Warning: Uniform '" << _name << "' not found or shader program not linked.\n";
-			warnedUniforms.insert(_name);
-		}
-#endif
+	void SetVec2(UniformName _name, const glm::vec2& value)
+	{
+		SetVec2(GetUniformLocation(_name), value);
+	}
 
-		glUniformMatrix3fv(location, 1, GL_FALSE, &_mat[0][0]);
+	void SetMat4(UniformName _name, const glm::mat4& _mat)
+	{
+		SetMat4(GetUniformLocation(_name), _mat);
 	}
 
-	void SetFloat(const std::string& _name, float _value)
+	void SetMat3(UniformName _name, const glm::mat3& _mat)
 	{
-		GLint location = glGetUniformLocation(m_rendererID, _name.c_str());
+		SetMat3(GetUniformLocation(_name), _mat);
+	}
 
-#ifdef _DEBUG
-		if (location == -1 && warnedUniforms.find(_name) == warnedUniforms.end()) {
-			std::cerr << "Warning: Uniform '" << _name << "' not found or shader program not linked.\n";
-			warnedUniforms.insert(_name);
-		}
-#endif
-		glUniform1f(location, _value);
+	void SetFloat(UniformName _name, float _value)
+	{
+		SetFloat(GetUniformLocation(_name), _value);
 	}
 
 	
@@ -147,19 +319,25 @@ public:
     // @param _name The name of the uniform variable in the shader.
     // @param _value The integer or boolean value to set the uniform variable to.
     //
-	void SetInt(const std::string& _name, int _value)
+	void SetInt(UniformName _name, int _value)
 	{
-		GLint location = glGetUniformLocation(m_rendererID, _name.c_str());
-
-#ifdef _DEBUG
-		if (location == -1 && warnedUniforms.find(_name) == warnedUniforms.end()) {
-			std::cerr << "Warning: Uniform '" << _name << "' not found or shader program not linked.\n";
-			warnedUniforms.insert(_name);
-		}
-#endif
-		glUniform1i(location, _value);
+		SetInt(GetUniformLocation(_name), _value);
 	}
 
+	// Location based setters, used together with GetUniformLocation() on the hot path.
+	void SetVec4(GLint _location, const glm::vec4& value) { UniformCallCounter()++; glUniform4fv(_location, 1, &value[0]); }
+	void SetVec3(GLint _location, const glm::vec3& value) { UniformCallCounter()++; glUniform3fv(_location, 1, &value[0]); }
+	void SetVec2(GLint _location, const glm::vec2& value) { UniformCallCounter()++; glUniform2fv(_location, 1, &value[0]); }
+	void SetMat4(GLint _location, const glm::mat4& _mat) { UniformCallCounter()++; glUniformMatrix4fv(_location, 1, GL_FALSE, &_mat[0][0]); }
+	void SetMat3(GLint _location, const glm::mat3& _mat) { UniformCallCounter()++; glUniformMatrix3fv(_location, 1, GL_FALSE, &_mat[0][0]); }
+	void SetFloat(GLint _location, float _value) { UniformCallCounter()++; glUniform1f(_location, _value); }
+	void SetInt(GLint _location, int _value) { UniformCallCounter()++; glUniform1i(_location, _value); }
+
+	// Number of glUniform* calls issued through the setters of all Shaders, reset once per frame
+	// by the demos to show how many uploads a frame costs.
+	static unsigned int GetUniformCallCount() { return UniformCallCounter(); }
+	static void ResetUniformCallCount() { UniformCallCounter() = 0; }
+
 	void SetUniformBlock(const std::string& _name, const int bindingPoint) const
 	{
 		unsigned int blockIndex = glGetUniformBlockIndex(m_rendererID, _name.c_str());
@@ -172,21 +350,48 @@ public:
 	}
 
 private:
+	// Compile/link work submitted to the driver but not finished yet (see FinishBuild)
+	struct PendingBuild
+	{
+		unsigned int vs = 0, fs = 0, gs = 0;
+		bool storeBinary = false; // store the linked binary in the ProgramBinaryCache
+		uint64_t key = 0;         // ProgramBinaryCache key
+		std::string label;
+		std::chrono::high_resolution_clock::time_point start;
+
+		float ElapsedMilliseconds() const
+		{
+			return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+	};
+
+	// One entry of the uniform location table
+	struct UniformSlot
+	{
+		uint32_t hash = 0;
+		GLint location = -1; // -1 marks an empty slot
+		std::string name;
+	};
+
 	unsigned int CompileShader(unsigned int type, const std::string& source)
 	{
 		unsigned int id = glCreateShader(type);
 		const char* src = source.c_str();
 		glShaderSource(id, 1, &src, nullptr);
 		glCompileShader(id);
+		return id;
+	}
 
-#ifdef _DEBUG
+	// Queried only once the link has finished, so submitting a build never waits on the compiler
+	void CheckCompileErrors(unsigned int id, unsigned int type) const
+	{
 		int result;
 		glGetShaderiv(id, GL_COMPILE_STATUS, &result);
 
 		if (result == GL_FALSE) {
 			int length;
 			glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
-			std::vector<char> message(length);
+			std::vector<char> message(std::max(length, 1));
 			glGetShaderInfoLog(id, length, &length, message.data());
 			std::string errorMessage = "Failed to compile ";
 
@@ -197,53 +402,141 @@ private:
 			
 			errorMessage += " shader: ";
 			errorMessage += message.data();
-			glDeleteShader(id);
 
 			std::cout << errorMessage << "\n";
 		}
+	}
+
+	void Build(const std::string& vertexShaderPath, const std::string& fragmentShaderPath,
+		const std::string& geometryShaderPath, const ShaderDefines& _defines)
+	{
+		const auto& [vertexSource, fragmentSource, geometrySource] = ParseShader(vertexShaderPath, fragmentShaderPath, geometryShaderPath, _defines);
+
+		std::string label = vertexShaderPath + " | " + fragmentShaderPath + (geometryShaderPath.empty() ? "" : " | " + geometryShaderPath);
+		for (const auto& [name, value] : _defines)
+			label += " " + name + "=" + value;
+		m_rendererID = BuildProgram(vertexSource, fragmentSource, geometrySource, label);
+		m_generation = ++GenerationCounter();
+
+#ifdef _DEBUG
+		std::cout << "successfully create and compile shader: \n" << vertexShaderPath <<
+			"\n" << fragmentShaderPath << "\n" << geometryShaderPath;
 #endif 
-		return id;
 	}
 
 	std::tuple<std::string, std::string, std::string> ParseShader(const std::string& vertexShaderPath,
-		const std::string& fragmentShaderPath, const std::string& geometryShaderPath)
+		const std::string& fragmentShaderPath, const std::string& geometryShaderPath, const ShaderDefines& _defines)
 	{
-		std::ifstream vShaderFile(vertexShaderPath);
-		std::ifstream fShaderFile(fragmentShaderPath);
+		std::string vertexSource = LoadShaderSource(vertexShaderPath, _defines);
+		std::string fragmentSource = LoadShaderSource(fragmentShaderPath, _defines);
+		std::string geometrySource;
+		if (!geometryShaderPath.empty())
+			geometrySource = LoadShaderSource(geometryShaderPath, _defines);
 
-		std::stringstream vShaderStream, fShaderStream, gShaderStream;
+		return std::make_tuple(vertexSource, fragmentSource, geometrySource);
+	}
+
+	// Reads one stage with its #include files expanded and the permutation defines injected.
+	std::string LoadShaderSource(const std::string& _path, const ShaderDefines& _defines)
+	{
+		std::unordered_set<std::string> included;
+		std::string source = ResolveIncludes(_path, included);
+		if (_defines.empty())
+			return source;
+
+		// #version has to stay the first directive, so the defines go right after it
+		std::string defineBlock;
+		for (const auto& [name, value] : _defines)
+			defineBlock += "#define " + name + " " + value + "\n";
+
+		size_t insertAt = 0;
+		size_t version = source.find("#version");
+		if (version != std::string::npos) {
+			insertAt = source.find('\n', version);
+			if (insertAt == std::string::npos) {
+				source += '\n';
+				insertAt = source.size();
+			}
+			else
+				insertAt++;
+		}
+		source.insert(insertAt, defineBlock);
+		return source;
+	}
+
+	// Expands #include "file" directives recursively. Paths are relative to the including file and
+	// every file is pasted at most once per stage, so shared headers need no include guards.
+	std::string ResolveIncludes(const std::string& _path, std::unordered_set<std::string>& _included)
+	{
+		std::ifstream file(_path);
 
 #ifdef  _DEBUG
-		if (!vShaderFile.is_open())  
-			std::cerr << "failed to open vertex shader file: " << vertexShaderPath; 
-		
-		if (!fShaderFile.is_open())
-			std::cerr << "failed to open fragment shader file: " << fragmentShaderPath;
+		if (!file.is_open())
+			std::cerr << "failed to open shader file: " << _path << "\n";
 #endif 
 
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
-
-		if (!geometryShaderPath.empty()) {
-			std::ifstream gShaderFile(geometryShaderPath);
-#ifdef _DEBUG
-			if (!gShaderFile.is_open())
-				std::cerr << "failed to open geometry shader file: " << geometryShaderPath;
-#endif
-			gShaderStream << gShaderFile.rdbuf();
-			gShaderFile.close();
+		std::string directory = _path.substr(0, _path.find_last_of("/\\") + 1);
+		std::string source, line;
+		while (std::getline(file, line)) {
+			size_t first = line.find_first_not_of(" \t");
+			if (first != std::string::npos && line.compare(first, 8, "#include") == 0) {
+				size_t open = line.find('"', first + 8);
+				size_t close = (open == std::string::npos) ? std::string::npos : line.find('"', open + 1);
+				if (close != std::string::npos) {
+					std::string includePath = std::filesystem::path(directory + line.substr(open + 1, close - open - 1)).lexically_normal().generic_string();
+					if (_included.insert(includePath).second)
+						source += ResolveIncludes(includePath, _included);
+					continue;
+				}
+			}
+			source += line;
+			source += '\n';
 		}
+		return source;
+	}
 
-		vShaderFile.close();
-		fShaderFile.close();
+	// Loads the program from the binary cache when possible, otherwise submits compile and link work.
+	// Outside of async build mode the build is finished right away. Hit/miss counts and times are
+	// recorded under _label.
+	unsigned int BuildProgram(const std::string& vertexShader, const std::string& fragmentShader,
+		const std::string& geometryShader, const std::string& _label)
+	{
+		PendingBuild pending;
+		pending.label = _label;
+		pending.start = std::chrono::high_resolution_clock::now();
+
+		ProgramBinaryCache& cache = ProgramBinaryCache::Get();
+		pending.storeBinary = cache.IsActive();
+		if (pending.storeBinary) {
+			pending.key = cache.MakeKey(vertexShader, fragmentShader, geometryShader);
+			unsigned int program = glCreateProgram();
+			if (cache.Load(program, pending.key)) {
+				cache.Record(_label, true, pending.ElapsedMilliseconds());
+				m_rendererID = program;
+				CacheUniformLocations();
+				return program;
+			}
+			glDeleteProgram(program);
+		}
 
-		return std::make_tuple(vShaderStream.str(), fShaderStream.str(), gShaderStream.str());
+		unsigned int program = CreateShader(vertexShader, fragmentShader, geometryShader, pending);
+		m_rendererID = program;
+		m_pending = std::move(pending);
+		if (!IsAsyncBuild())
+			FinishBuild();
+		return program;
 	}
 
+	// Compiles and links without querying any status, the shader objects are kept in _pending
+	// until FinishBuild() so their logs can still be read.
 	unsigned int CreateShader(const std::string& vertexShader,
-		const std::string& fragmentShader, const std::string& geometryShader)
+		const std::string& fragmentShader, const std::string& geometryShader, PendingBuild& _pending)
 	{
+		HasParallelCompile(); // sets up the compiler threads before the first submission
 		unsigned int program = glCreateProgram();
+		if (_pending.storeBinary)
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 		unsigned int vs = CompileShader(GL_VERTEX_SHADER, vertexShader);
 		unsigned int fs = CompileShader(GL_FRAGMENT_SHADER, fragmentShader);
 
@@ -255,17 +548,150 @@ private:
 		glAttachShader(program, vs);
 		glAttachShader(program, fs);
 		glLinkProgram(program);
-		glValidateProgram(program);
-
-		glDeleteShader(vs);
-		glDeleteShader(fs);
-		if (gs!=0)
-			glDeleteShader(gs);
 
+		_pending.vs = vs;
+		_pending.fs = fs;
+		_pending.gs = gs;
 		return program;
 	}
 
+	// Blocks until the link is done (immediate if IsReady() already saw it complete), then reports
+	// errors, stores the binary and builds the uniform location table.
+	void FinishBuild() const
+	{
+		PendingBuild& pending = *m_pending;
+
+#ifdef _DEBUG
+		CheckCompileErrors(pending.vs, GL_VERTEX_SHADER);
+		CheckCompileErrors(pending.fs, GL_FRAGMENT_SHADER);
+		if (pending.gs != 0)
+			CheckCompileErrors(pending.gs, GL_GEOMETRY_SHADER);
+#endif
+		glValidateProgram(m_rendererID);
+		DeleteShaderObjects();
+
+		if (pending.storeBinary) {
+			ProgramBinaryCache& cache = ProgramBinaryCache::Get();
+			cache.Store(m_rendererID, pending.key);
+			cache.Record(pending.label, false, pending.ElapsedMilliseconds());
+		}
+
+		CacheUniformLocations();
+		m_pending.reset();
+	}
+
+	void DeleteShaderObjects() const
+	{
+		glDeleteShader(m_pending->vs);
+		glDeleteShader(m_pending->fs);
+		if (m_pending->gs != 0)
+			glDeleteShader(m_pending->gs);
+	}
+
+	static bool& AsyncBuildFlag()
+	{
+		static bool async = false;
+		return async;
+	}
+
+	static uint64_t& GenerationCounter()
+	{
+		static uint64_t generation = 0;
+		return generation;
+	}
+
+	static unsigned int& UniformCallCounter()
+	{
+		static unsigned int count = 0;
+		return count;
+	}
+
+	// Enumerates every active uniform once after linking and stores its location in a flat
+	// open-addressing table keyed by the FNV-1a hash of its name. Array uniforms are registered
+	// both by their base name and by every "name[i]" element. The names are kept in the slots,
+	// so two names with the same hash just probe on instead of returning each other's location.
+	void CacheUniformLocations() const
+	{
+		GLint count = 0, maxLength = 0;
+		glGetProgramiv(m_rendererID, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(m_rendererID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+		std::vector<std::pair<std::string, GLint>> entries;
+		std::vector<char> nameBuffer(std::max(maxLength, 1));
+		for (GLint i = 0; i < count; i++) {
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(m_rendererID, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+			std::string name(nameBuffer.data(), length);
+
+			GLint location = glGetUniformLocation(m_rendererID, name.c_str());
+			if (location == -1)
+				continue; // members of uniform blocks have no location
+
+			// Arrays are reported as "name[0]", register the base name and all the elements
+			if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+				std::string baseName = name.substr(0, name.size() - 3);
+				entries.emplace_back(baseName, location);
+				for (GLint element = 0; element < size; element++) {
+					std::string elementName = baseName + "[" + std::to_string(element) + "]";
+					entries.emplace_back(elementName, glGetUniformLocation(m_rendererID, elementName.c_str()));
+				}
+			}
+			else
+				entries.emplace_back(name, location);
+		}
+
+		// Keep the load factor at or below 0.5 so probe sequences stay short
+		size_t capacity = 16;
+		while (capacity < entries.size() * 2)
+			capacity *= 2;
+		m_uniformSlots.assign(capacity, UniformSlot());
+
+		for (const auto& [name, location] : entries) {
+			uint32_t hash = HashUniformName(name.c_str());
+			size_t mask = capacity - 1;
+			size_t index = hash & mask;
+			while (m_uniformSlots[index].location != -1)
+				index = (index + 1) & mask;
+			m_uniformSlots[index] = { hash, location, name };
+		}
+	}
+
+	GLint FindUniformLocation(const UniformName& _name) const
+	{
+		if (m_uniformSlots.empty())
+			return -1;
+
+		size_t mask = m_uniformSlots.size() - 1;
+		for (size_t index = _name.hash & mask; ; index = (index + 1) & mask) {
+			const UniformSlot& slot = m_uniformSlots[index];
+			if (slot.location == -1)
+				return -1;
+			if (slot.hash == _name.hash && SlotMatches(slot, _name))
+				return slot.location;
+		}
+	}
+
+	// Compares the stored name with _name, "base[index]" for array elements, without allocating
+	static bool SlotMatches(const UniformSlot& _slot, const UniformName& _name)
+	{
+		size_t baseLength = std::strlen(_name.name);
+		if (_slot.name.compare(0, baseLength, _name.name) != 0)
+			return false;
+		if (_name.index < 0)
+			return _slot.name.size() == baseLength;
+
+		char element[16] = { '[' };
+		char* end = std::to_chars(element + 1, element + sizeof(element) - 2, _name.index).ptr;
+		*end = ']';
+		return _slot.name.compare(baseLength, std::string::npos, element, end + 1 - element) == 0;
+	}
+
 private:
 	unsigned int m_rendererID; // Unique identifier for the OpenGL shader program
-	std::unordered_set<std::string> warnedUniforms; // Set to keep track of uniform variables that have already triggered a warning
+	uint64_t m_generation = 0; // see GetGeneration()
+	mutable std::optional<PendingBuild> m_pending; // set while an async build is still in flight, finished by const Bind() too
+	mutable std::vector<UniformSlot> m_uniformSlots; // Uniform location table filled by CacheUniformLocations()
+	std::unordered_set<uint32_t> warnedUniforms; // Name hashes of uniform variables that have already triggered a warning
 };
\ No newline at end of file
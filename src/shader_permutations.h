@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "shader.h"
+
+// Where the shading normal of a PBR permutation comes from, values match NORMAL_SOURCE_* in the shaders
+enum class NormalSource : uint8_t
+{
+	Vertex = 0,         // interpolated vertex normal
+	MapDerivatives = 1, // normal map, TBN rebuilt per fragment from dFdx/dFdy
+	VertexTangent = 2   // normal map, TBN interpolated from vertex tangents (see TangentGenerator)
+};
+
+// Permutation key of the PBR shaders (see the define lists at the top of pbr_ibl_diffuse.fs and pbr_ibl.vert).
+// Every field turns into a #define, so dead branches and the light loop bound are compile-time constants.
+struct PbrPermutation
+{
+	int lightCount = 4;
+	bool textured = false;
+	NormalSource normalSource = NormalSource::Vertex;
+	bool iblDiffuse = true;
+	bool packedVertex = false; // Mesh uploaded as PackedVertex (VertexFormat::Packed)
+	bool metallicRoughnessPacked = false; // metallic in B, roughness in G of one texture (glTF, see GltfModel)
+
+	uint32_t Pack() const
+	{
+		return (uint32_t)(lightCount & 0xFF) |
+			((uint32_t)textured << 8) |
+			((uint32_t)normalSource << 9) |
+			((uint32_t)iblDiffuse << 12) |
+			((uint32_t)packedVertex << 13) |
+			((uint32_t)metallicRoughnessPacked << 14);
+	}
+
+	ShaderDefines ToDefines() const
+	{
+		return {
+			{ "NR_LIGHTS", std::to_string(lightCount) },
+			{ "TEXTURED", textured ? "1" : "0" },
+			{ "NORMAL_MAP_SOURCE", std::to_string((int)normalSource) },
+			{ "IBL_DIFFUSE", iblDiffuse ? "1" : "0" },
+			{ "PACKED_VERTEX", packedVertex ? "1" : "0" },
+			{ "METALLIC_ROUGHNESS_PACKED", metallicRoughnessPacked ? "1" : "0" }
+		};
+	}
+};
+
+// Lazily compiled variants of one shader pair. Each permutation is built once, on its first Get(),
+// and then handed out from the table, so choosing a variant per draw is a single hash lookup.
+//
+// Usage:
+//   ShaderPermutationTable pbrShaders("res/shaders/pbr_ibl.vert", "res/shaders/pbr_ibl_diffuse.fs");
+//   PbrPermutation textured;
+//   textured.textured = true;
+//   Shader& shader = pbrShaders.Get(textured);
+class ShaderPermutationTable
+{
+public:
+	ShaderPermutationTable(const std::string& _vertexShaderPath, const std::string& _fragmentShaderPath)
+		: vertexShaderPath(_vertexShaderPath), fragmentShaderPath(_fragmentShaderPath) {}
+
+	ShaderPermutationTable(const ShaderPermutationTable&) = delete;
+	ShaderPermutationTable& operator=(const ShaderPermutationTable&) = delete;
+
+	Shader& Get(const PbrPermutation& _permutation)
+	{
+		uint32_t key = _permutation.Pack();
+		auto it = variants.find(key);
+		if (it == variants.end())
+			it = variants.emplace(key, std::make_unique<Shader>(vertexShaderPath, fragmentShaderPath, _permutation.ToDefines())).first;
+		return *it->second;
+	}
+
+	size_t Size() const { return variants.size(); }
+
+private:
+	std::string vertexShaderPath;
+	std::string fragmentShaderPath;
+	std::unordered_map<uint32_t, std::unique_ptr<Shader>> variants; // keyed by PbrPermutation::Pack()
+};
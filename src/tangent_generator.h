@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Per-vertex tangent frames for normal mapping, computed once at load / bake time so the fragment
+// shader no longer rebuilds them from screen-space derivatives (NormalSource::VertexTangent).
+//
+// Follows the MikkTSpace conventions: every triangle corner contributes its texture-space tangent
+// and bitangent projected onto the plane of the vertex normal, normalized and weighted by the
+// corner angle; the tangent is then orthogonalized against the normal and the bitangent is stored
+// as cross(normal, tangent) * sign, sign being the handedness of the UV mapping. Unlike the
+// reference implementation vertices are not split where the frames of their triangles disagree,
+// meshes keep their vertex and index counts. Corners with degenerate UVs contribute nothing, a vertex
+// left without a tangent gets any unit vector perpendicular to its normal.
+//
+// Vertices are interleaved floats in the layout of Vertex (mesh.h): position, normal, texCoords,
+// tangent, bitangent, stride in floats.
+//
+// Usage:
+//   TangentGenerator::Generate(&vertices[0].position.x, sizeof(Vertex) / sizeof(float), vertices.size(),
+//       indices.data(), indices.size());
+//   std::vector<unsigned int> triangles = TangentGenerator::StripToTriangles(stripIndices);
+class TangentGenerator
+{
+public:
+	static constexpr size_t kPositionOffset = 0;
+	static constexpr size_t kNormalOffset = 3;
+	static constexpr size_t kTexCoordsOffset = 6;
+	static constexpr size_t kTangentOffset = 8;
+	static constexpr size_t kBitangentOffset = 11;
+	static constexpr size_t kMinStride = 14;
+
+	// Meshes imported without tangents get generated ones (see Model), on by default
+	static void SetEnabled(bool _enabled) { EnabledFlag() = _enabled; }
+	static bool IsEnabled() { return EnabledFlag(); }
+
+	// _indices is a triangle list, overwrites the tangent and bitangent of every vertex
+	static void Generate(float* _vertices, size_t _stride, size_t _vertexCount, const unsigned int* _indices, size_t _indexCount)
+	{
+		std::vector<glm::vec3> tangents(_vertexCount, glm::vec3(0.0f)), bitangents(_vertexCount, glm::vec3(0.0f));
+		auto position = [&](unsigned int i) { return glm::vec3(_vertices[i * _stride + kPositionOffset], _vertices[i * _stride + kPositionOffset + 1], _vertices[i * _stride + kPositionOffset + 2]); };
+		auto normal = [&](unsigned int i) { return glm::vec3(_vertices[i * _stride + kNormalOffset], _vertices[i * _stride + kNormalOffset + 1], _vertices[i * _stride + kNormalOffset + 2]); };
+		auto texCoords = [&](unsigned int i) { return glm::vec2(_vertices[i * _stride + kTexCoordsOffset], _vertices[i * _stride + kTexCoordsOffset + 1]); };
+
+		for (size_t triangle = 0; triangle + 2 < _indexCount; triangle += 3) {
+			const unsigned int corners[3] = { _indices[triangle], _indices[triangle + 1], _indices[triangle + 2] };
+			if (corners[0] >= _vertexCount || corners[1] >= _vertexCount || corners[2] >= _vertexCount)
+				continue;
+			const glm::vec3 p0 = position(corners[0]), p1 = position(corners[1]), p2 = position(corners[2]);
+			const glm::vec2 uv0 = texCoords(corners[0]), uv1 = texCoords(corners[1]), uv2 = texCoords(corners[2]);
+
+			// Solve [e1 e2] = [T B] * [duv1 duv2], the 1 / determinant only scales, its sign is kept
+			const glm::vec3 e1 = p1 - p0, e2 = p2 - p0;
+			const glm::vec2 duv1 = uv1 - uv0, duv2 = uv2 - uv0;
+			const float determinant = duv1.x * duv2.y - duv2.x * duv1.y;
+			if (std::fabs(determinant) <= 1e-20f)
+				continue;
+			const float orientation = determinant > 0.0f ? 1.0f : -1.0f;
+			const glm::vec3 faceTangent = (e1 * duv2.y - e2 * duv1.y) * orientation;
+			const glm::vec3 faceBitangent = (e2 * duv1.x - e1 * duv2.x) * orientation;
+
+			for (int corner = 0; corner < 3; corner++) {
+				const unsigned int vertex = corners[corner];
+				const glm::vec3 n = normal(vertex);
+				const glm::vec3 toNext = position(corners[(corner + 1) % 3]) - position(vertex);
+				const glm::vec3 toPrevious = position(corners[(corner + 2) % 3]) - position(vertex);
+				const float edgeLengths = glm::length(toNext) * glm::length(toPrevious);
+				if (edgeLengths <= 0.0f)
+					continue;
+				const float angle = std::acos(glm::clamp(glm::dot(toNext, toPrevious) / edgeLengths, -1.0f, 1.0f));
+
+				glm::vec3 t = faceTangent - n * glm::dot(n, faceTangent);
+				glm::vec3 b = faceBitangent - n * glm::dot(n, faceBitangent);
+				const float tLength = glm::length(t), bLength = glm::length(b);
+				if (tLength > 0.0f)
+					tangents[vertex] += t * (angle / tLength);
+				if (bLength > 0.0f)
+					bitangents[vertex] += b * (angle / bLength);
+			}
+		}
+
+		for (size_t i = 0; i < _vertexCount; i++) {
+			float* vertex = _vertices + i * _stride;
+			glm::vec3 n = normal((unsigned int)i);
+			const float normalLength = glm::length(n);
+			n = normalLength > 0.0f ? n / normalLength : glm::vec3(0.0f, 0.0f, 1.0f);
+			glm::vec3 t = tangents[i] - n * glm::dot(n, tangents[i]);
+			const float length = glm::length(t);
+			t = length > 1e-12f ? t / length : AnyPerpendicular(n);
+			const float sign = glm::dot(glm::cross(n, t), bitangents[i]) < 0.0f ? -1.0f : 1.0f;
+			const glm::vec3 b = glm::cross(n, t) * sign;
+			for (int axis = 0; axis < 3; axis++) {
+				vertex[kTangentOffset + axis] = t[axis];
+				vertex[kBitangentOffset + axis] = b[axis];
+			}
+		}
+	}
+
+	static void Generate(float* _vertices, size_t _stride, size_t _vertexCount, const std::vector<unsigned int>& _indices)
+	{
+		Generate(_vertices, _stride, _vertexCount, _indices.data(), _indices.size());
+	}
+
+	// Triangle list of a GL_TRIANGLE_STRIP, degenerate triangles (restarts by repeated indices) dropped
+	static std::vector<unsigned int> StripToTriangles(const std::vector<unsigned int>& _strip)
+	{
+		std::vector<unsigned int> triangles;
+		triangles.reserve(_strip.size() >= 2 ? (_strip.size() - 2) * 3 : 0);
+		for (size_t i = 2; i < _strip.size(); i++) {
+			unsigned int a = _strip[i - 2], b = _strip[i - 1], c = _strip[i];
+			if (a == b || b == c || a == c)
+				continue;
+			if (i % 2 == 1)
+				std::swap(a, b); // every other triangle is wound the other way
+			triangles.insert(triangles.end(), { a, b, c });
+		}
+		return triangles;
+	}
+
+private:
+	static bool& EnabledFlag()
+	{
+		static bool enabled = true;
+		return enabled;
+	}
+
+	static glm::vec3 AnyPerpendicular(const glm::vec3& _n)
+	{
+		const glm::vec3 axis = std::fabs(_n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		return glm::normalize(glm::cross(_n, axis));
+	}
+};
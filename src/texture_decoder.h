@@ -0,0 +1,419 @@
+#pragma once
+
+#ifndef STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "gl_state_cache.h"
+#include "mip_generator.h"
+#include "texture_upload_ring.h"
+
+// Sets repeating, trilinear sampling on the bound GL_TEXTURE_2D. _levelCount: levels uploaded
+// already, 0 lets the driver build the mip chain.
+inline void ConfigureTexture2D(int _levelCount = 0)
+{
+	if (_levelCount > 0)
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, _levelCount - 1);
+	else
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+// Uploads 8-bit pixels into _textureID as a repeating 2D texture, the rest of the mip chain from
+// _mips (see MipGenerator) or, when it is null, built by the driver
+inline void UploadTexture2D(unsigned int _textureID, int _width, int _height, int _components, const unsigned char* _data, const MipChain* _mips)
+{
+	GLenum format = GL_RED;
+	if (_components == 1) format = GL_RED;
+	if (_components == 3) format = GL_RGB;
+	if (_components == 4) format = GL_RGBA;
+
+	GLStateCache::Get().BindTexture(GL_TEXTURE_2D, _textureID);
+	if (!_mips) {
+		glTexImage2D(GL_TEXTURE_2D, 0, format, _width, _height, 0, format, GL_UNSIGNED_BYTE, _data);
+		ConfigureTexture2D();
+		return;
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // tightly packed rows, small levels are not 4-byte aligned
+	glTexImage2D(GL_TEXTURE_2D, 0, format, _width, _height, 0, format, GL_UNSIGNED_BYTE, _data);
+	for (size_t i = 0; i < _mips->levels.size(); i++) {
+		const MipChain::Level& level = _mips->levels[i];
+		glTexImage2D(GL_TEXTURE_2D, (GLint)i + 1, format, level.width, level.height, 0, format, GL_UNSIGNED_BYTE, _mips->pixels.data() + level.offset);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	ConfigureTexture2D((int)_mips->levels.size() + 1);
+}
+
+// Uploads 8-bit pixels into _textureID as a mipmapped, repeating 2D texture. The mip chain is built
+// by MipGenerator on all hardware threads when it is enabled, by the driver otherwise.
+inline void UploadTexture2D(unsigned int _textureID, int _width, int _height, int _components, const unsigned char* _data,
+	MipFilter _filter = MipFilter::Linear)
+{
+	if (!MipGenerator::IsEnabled()) {
+		UploadTexture2D(_textureID, _width, _height, _components, _data, nullptr);
+		return;
+	}
+	MipChain mips;
+	MipGenerator::Build(_data, _width, _height, _components, _filter, mips, std::max(1u, std::thread::hardware_concurrency()));
+	UploadTexture2D(_textureID, _width, _height, _components, _data, &mips);
+}
+
+// Worker pool that decodes image files (stbi_load) off the GL thread. Decoded images wait in a
+// queue until the GL thread drains it with UploadReady() or Finish(), which only do the uploads.
+//
+// The texture name is created up front, so a Texture can be handed out before its pixels arrive.
+// Decoding uses the global stbi_set_flip_vertically_on_load() state at decode time, Finish()
+// before changing it.
+//
+// With MipGenerator enabled the workers also build each image's mip chain (filtered by the
+// MipFilter given to Enqueue()), so the GL thread only uploads levels and never runs
+// glGenerateMipmap.
+//
+// With a TextureUploadRing attached the workers copy the decoded pixels (mip chain included) into
+// the ring's mapped pixel buffer and the GL thread uploads from there, so no upload reads client
+// memory.
+// UploadReady() takes a byte budget, the images over it wait for the next call.
+//
+// Usage:
+//   TextureDecodePool& decoder = TextureDecodePool::Get();
+//   decoder.SetUploadRing(&ring);  // optional
+//   glGenTextures(1, &id);
+//   decoder.Enqueue(id, "res/models/nanosuit/arm_dif.png");            // MipFilter::Auto, by file name
+//   decoder.Enqueue(id, "res/textures/brick_n.png", MipFilter::Normal);
+//   ...
+//   decoder.Finish();               // blocking, e.g. at the end of a model load
+//   decoder.UploadReady(8 << 20);   // or non-blocking, once per frame, at most ~8 MB
+class TextureDecodePool
+{
+public:
+	struct Stats
+	{
+		unsigned int decoded = 0;
+		unsigned int failed = 0;
+		float decodeMilliseconds = 0.0f; // summed over all workers
+		float mipMilliseconds = 0.0f;    // MipGenerator, summed over all workers
+		float uploadMilliseconds = 0.0f; // GL thread
+		float waitMilliseconds = 0.0f;   // GL thread idle in Finish(), waiting for a worker
+		size_t uploadedBytes = 0;
+		unsigned int budgetLimitedCalls = 0; // UploadReady() calls that left decoded images for later
+	};
+
+	static constexpr size_t kNoBudget = SIZE_MAX;
+
+	static TextureDecodePool& Get()
+	{
+		static TextureDecodePool pool;
+		return pool;
+	}
+
+	TextureDecodePool(const TextureDecodePool&) = delete;
+	TextureDecodePool& operator=(const TextureDecodePool&) = delete;
+
+	~TextureDecodePool()
+	{
+		StopWorkers();
+		for (Decoded& image : decoded)
+			stbi_image_free(image.pixels);
+	}
+
+	// Number of decode threads, defaults to the number of hardware threads. Takes effect for the
+	// next Enqueue(), jobs already queued are finished by the current workers first.
+	void SetWorkerCount(unsigned int _count)
+	{
+		StopWorkers();
+		workerCount = std::max(1u, _count);
+	}
+
+	unsigned int GetWorkerCount() const { return workerCount; }
+
+	// Pixel buffer ring the workers decode into, null to upload from client memory. Not owned,
+	// detach it before destroying the ring.
+	void SetUploadRing(TextureUploadRing* _ring)
+	{
+		Finish();
+		std::lock_guard<std::mutex> lock(mutex);
+		ring = (_ring && _ring->IsAvailable()) ? _ring : nullptr;
+	}
+
+	void Enqueue(unsigned int _textureID, const std::string& _filename, MipFilter _filter = MipFilter::Auto)
+	{
+		Enqueue(_textureID, _filename, std::vector<unsigned char>(), _filter);
+	}
+
+	// Decodes the file contents _encoded that were already read (e.g. for hashing), _filename is
+	// only used for messages and MipFilter::Auto
+	void Enqueue(unsigned int _textureID, const std::string& _filename, std::vector<unsigned char> _encoded, MipFilter _filter = MipFilter::Auto)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (workers.empty())
+				StartWorkers();
+			jobs.push_back({ _textureID, _filename, std::move(_encoded), _filter });
+			pending++;
+		}
+		jobReady.notify_one();
+	}
+
+	// Uploads images decoded so far without waiting, until _byteBudget bytes of pixels have been
+	// uploaded (at least one image per call, so an image over the budget still gets through).
+	// Returns how many were uploaded.
+	size_t UploadReady(size_t _byteBudget = kNoBudget)
+	{
+		RetireRing();
+
+		std::deque<Decoded> ready;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			size_t bytes = 0;
+			while (!decoded.empty()) {
+				size_t size = decoded.front().Bytes();
+				if (!ready.empty() && bytes + size > _byteBudget) {
+					stats.budgetLimitedCalls++;
+					break;
+				}
+				bytes += size;
+				ready.push_back(std::move(decoded.front()));
+				decoded.pop_front();
+			}
+		}
+		for (Decoded& image : ready)
+			Upload(image);
+		return ready.size();
+	}
+
+	// Uploads images as they are decoded until every enqueued file is done
+	void Finish()
+	{
+		while (true) {
+			std::deque<Decoded> ready;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				if (pending == 0)
+					return;
+				if (decoded.empty()) {
+					// Workers may be waiting for ring space, keep retiring finished uploads while waiting
+					auto start = std::chrono::steady_clock::now();
+					while (!decodedReady.wait_for(lock, std::chrono::milliseconds(1), [this]() { return !decoded.empty(); })) {
+						lock.unlock();
+						RetireRing();
+						lock.lock();
+					}
+					stats.waitMilliseconds += MillisecondsSince(start);
+				}
+				ready.swap(decoded);
+			}
+			for (Decoded& image : ready)
+				Upload(image);
+			RetireRing();
+		}
+	}
+
+	// GL thread. Called once the last pending file has been uploaded (from UploadReady() / Finish()),
+	// e.g. to do work that has to wait until no upload targets a texture any more
+	void SetDrainedCallback(std::function<void()> _callback) { drainedCallback = std::move(_callback); }
+
+	// Files enqueued but not uploaded yet
+	size_t GetPendingCount()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return pending;
+	}
+
+	Stats GetStats()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return stats;
+	}
+
+	void ResetStats()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stats = Stats();
+	}
+
+private:
+	TextureDecodePool() : workerCount(std::max(1u, std::thread::hardware_concurrency())) {}
+
+	struct Job
+	{
+		unsigned int textureID;
+		std::string filename;
+		std::vector<unsigned char> encoded; // file contents, empty to read the file
+		MipFilter filter = MipFilter::Auto;
+	};
+
+	struct Decoded
+	{
+		unsigned int textureID = 0;
+		std::string filename;
+		int width = 0, height = 0, components = 0;
+		unsigned char* pixels = nullptr; // null when decoding failed or the pixels are in the ring
+		MipChain mips;                   // levels 1..n, released once copied into the ring
+		size_t mipBytes = 0;
+		bool hasMips = false;            // built by MipGenerator, else the driver builds them
+		int levelCount = 1;
+		bool inRing = false;
+		size_t ringOffset = 0;
+
+		size_t Bytes() const { return (size_t)width * height * components + mipBytes; }
+	};
+
+	static float MillisecondsSince(std::chrono::steady_clock::time_point _start)
+	{
+		return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - _start).count();
+	}
+
+	// Called with mutex held
+	void StartWorkers()
+	{
+		stopping = false;
+		for (unsigned int i = 0; i < workerCount; i++)
+			workers.emplace_back(&TextureDecodePool::WorkerLoop, this);
+	}
+
+	void StopWorkers()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		jobReady.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+		workers.clear();
+	}
+
+	void WorkerLoop()
+	{
+		while (true) {
+			Job job;
+			TextureUploadRing* uploadRing = nullptr;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				jobReady.wait(lock, [this]() { return stopping || !jobs.empty(); });
+				if (jobs.empty())
+					return;
+				job = std::move(jobs.front());
+				jobs.pop_front();
+				uploadRing = ring;
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			Decoded image;
+			image.textureID = job.textureID;
+			image.filename = std::move(job.filename);
+			if (job.encoded.empty())
+				image.pixels = stbi_load(image.filename.c_str(), &image.width, &image.height, &image.components, 0);
+			else
+				image.pixels = stbi_load_from_memory(job.encoded.data(), (int)job.encoded.size(), &image.width, &image.height, &image.components, 0);
+
+			float milliseconds = MillisecondsSince(start);
+
+			// One thread per image, the pool's workers already run in parallel
+			float mipMilliseconds = 0.0f;
+			if (image.pixels && MipGenerator::IsEnabled()) {
+				auto mipStart = std::chrono::steady_clock::now();
+				MipFilter filter = job.filter == MipFilter::Auto ? MipGenerator::FilterForPath(image.filename) : job.filter;
+				MipGenerator::Build(image.pixels, image.width, image.height, image.components, filter, image.mips);
+				image.hasMips = true;
+				image.levelCount = (int)image.mips.levels.size() + 1;
+				image.mipBytes = image.mips.Bytes();
+				mipMilliseconds = MillisecondsSince(mipStart);
+			}
+
+			char* memory = nullptr;
+			if (image.pixels && uploadRing && uploadRing->Allocate(image.Bytes(), image.ringOffset, memory)) {
+				size_t levelZeroBytes = image.Bytes() - image.mipBytes;
+				std::memcpy(memory, image.pixels, levelZeroBytes);
+				if (image.mipBytes != 0)
+					std::memcpy(memory + levelZeroBytes, image.mips.pixels.data(), image.mipBytes);
+				stbi_image_free(image.pixels);
+				image.pixels = nullptr;
+				image.mips = MipChain();
+				image.inRing = true;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stats.decodeMilliseconds += milliseconds;
+				stats.mipMilliseconds += mipMilliseconds;
+				decoded.push_back(std::move(image));
+			}
+			decodedReady.notify_one();
+		}
+	}
+
+	void Upload(Decoded& _image)
+	{
+		auto start = std::chrono::steady_clock::now();
+		bool loaded = _image.pixels != nullptr || _image.inRing;
+		if (_image.inRing) {
+			ring->Upload(_image.textureID, _image.width, _image.height, _image.components, _image.ringOffset, _image.levelCount);
+			ConfigureTexture2D(_image.hasMips ? _image.levelCount : 0);
+		}
+		else if (loaded) {
+			UploadTexture2D(_image.textureID, _image.width, _image.height, _image.components, _image.pixels, _image.hasMips ? &_image.mips : nullptr);
+			stbi_image_free(_image.pixels);
+		}
+		else {
+			std::cout << "Texture failed to load at path: " << _image.filename << std::endl;
+		}
+		float milliseconds = MillisecondsSince(start);
+
+		bool drained = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stats.uploadMilliseconds += milliseconds;
+			if (loaded) {
+				stats.decoded++;
+				stats.uploadedBytes += _image.Bytes();
+			}
+			else
+				stats.failed++;
+			drained = --pending == 0;
+		}
+		if (drained && drainedCallback)
+			drainedCallback();
+	}
+
+	void RetireRing()
+	{
+		if (ring)
+			ring->Retire();
+	}
+
+private:
+	std::mutex mutex;
+	std::condition_variable jobReady;
+	std::condition_variable decodedReady;
+	std::deque<Job> jobs;
+	std::deque<Decoded> decoded;
+	size_t pending = 0; // enqueued, not uploaded yet
+	std::vector<std::thread> workers;
+	unsigned int workerCount = 1;
+	bool stopping = false;
+	TextureUploadRing* ring = nullptr;
+	std::function<void()> drainedCallback;
+	Stats stats;
+};
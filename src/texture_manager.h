@@ -0,0 +1,301 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "gl_state_cache.h"
+#include "texture_decoder.h"
+
+// The one place 2D textures are loaded from files.
+//
+// A texture is found by its canonical path first and by a hash of the file contents second, so the
+// same image reached through different paths (or copied next to several models) is loaded once.
+// Acquire() hands out the GL texture id and adds a reference, Release() drops it. Textures without
+// references stay resident for later hits until the resident size exceeds the VRAM budget, then
+// the least recently released ones are deleted.
+//
+// Usage:
+//   TextureManager& textures = TextureManager::Get();
+//   textures.SetBudget(256 << 20);
+//   unsigned int albedo = textures.Acquire("res/textures/pbr/rusted_iron/albedo.png");
+//   unsigned int diffuse = textures.AcquireAsync(path); // decoded on the TextureDecodePool
+//   ...
+//   textures.Release(albedo);
+class TextureManager
+{
+public:
+	struct Stats
+	{
+		unsigned int pathHits = 0;    // found by canonical path
+		unsigned int contentHits = 0; // new path, same file contents
+		unsigned int misses = 0;      // decoded and uploaded
+		unsigned int evictions = 0;
+		size_t residentBytes = 0;     // estimated VRAM of all live textures, mip chains included
+		size_t residentCount = 0;
+		size_t unreferencedCount = 0; // resident, kept only as cache
+	};
+
+	static constexpr size_t kNoBudget = SIZE_MAX;
+
+	static TextureManager& Get()
+	{
+		static TextureManager manager;
+		return manager;
+	}
+
+	TextureManager(const TextureManager&) = delete;
+	TextureManager& operator=(const TextureManager&) = delete;
+
+	// Loads the file now (8-bit, mipmapped, or 16-bit float RGB without mips when _isHDR), returns 0
+	// when it cannot be loaded. The mip filter follows the file name (MipGenerator::FilterForPath()).
+	unsigned int Acquire(const std::string& _path, bool _isHDR = false)
+	{
+		return Load(_path, _isHDR, false, MipFilter::Auto);
+	}
+
+	// Like Acquire() for 8-bit textures, but the decode (and the mip chain) runs on the
+	// TextureDecodePool. The id is valid right away, its pixels arrive with
+	// TextureDecodePool::UploadReady() / Finish(). _filter applies to the first load of the file.
+	unsigned int AcquireAsync(const std::string& _path, MipFilter _filter = MipFilter::Auto)
+	{
+		return Load(_path, false, true, _filter);
+	}
+
+	void Release(unsigned int _id)
+	{
+		auto it = entries.find(_id);
+		if (it == entries.end() || it->second.refCount == 0)
+			return;
+		Entry& entry = it->second;
+		if (--entry.refCount == 0) {
+			entry.lruPosition = lru.insert(lru.end(), _id);
+			stats.unreferencedCount++;
+			Trim();
+		}
+	}
+
+	// Upper bound of resident bytes, unreferenced textures are evicted to stay under it
+	void SetBudget(size_t _bytes)
+	{
+		budget = _bytes;
+		Trim();
+	}
+
+	size_t GetBudget() const { return budget; }
+
+	// Evicts least recently released textures until the resident size fits the budget. Waits for a
+	// moment without pending decodes, so no upload targets a deleted texture: while decodes are
+	// pending it returns at once and runs again when the TextureDecodePool drains.
+	void Trim()
+	{
+		if (TextureDecodePool::Get().GetPendingCount() > 0)
+			return;
+		while (stats.residentBytes > budget && !lru.empty())
+			Evict(lru.front());
+	}
+
+	const Stats& GetStats() const { return stats; }
+
+	float GetHitRate() const
+	{
+		unsigned int hits = stats.pathHits + stats.contentHits;
+		unsigned int total = hits + stats.misses;
+		return total ? (float)hits / total : 0.0f;
+	}
+
+	void ResetCounters()
+	{
+		stats.pathHits = stats.contentHits = stats.misses = stats.evictions = 0;
+	}
+
+	void PrintStats() const
+	{
+		std::cout << "Texture manager: " << stats.residentCount << " resident (" << stats.unreferencedCount << " unreferenced), "
+			<< (stats.residentBytes >> 20) << " MB, hit rate " << GetHitRate() * 100.0f << "% ("
+			<< stats.pathHits << " path, " << stats.contentHits << " content, " << stats.misses << " misses), "
+			<< stats.evictions << " evictions\n";
+	}
+
+private:
+	TextureManager()
+	{
+		TextureDecodePool::Get().SetDrainedCallback([this]() { Trim(); });
+	}
+
+	struct Entry
+	{
+		uint64_t contentKey = 0;
+		size_t bytes = 0;
+		unsigned int refCount = 0;
+		std::vector<std::string> paths; // canonical paths that lead here
+		std::list<unsigned int>::iterator lruPosition;
+	};
+
+	static std::string CanonicalPath(const std::string& _path)
+	{
+		std::error_code error;
+		std::filesystem::path canonical = std::filesystem::weakly_canonical(_path, error);
+		if (error)
+			canonical = std::filesystem::path(_path).lexically_normal();
+		return canonical.generic_string();
+	}
+
+	// 64-bit FNV-1a
+	static uint64_t Hash(const std::vector<unsigned char>& _data, uint64_t _hash = 14695981039346656037ull)
+	{
+		for (unsigned char c : _data) {
+			_hash ^= c;
+			_hash *= 1099511628211ull;
+		}
+		return _hash;
+	}
+
+	static bool ReadFile(const std::string& _path, std::vector<unsigned char>& _data)
+	{
+		std::ifstream file(_path, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+			return false;
+		std::streamsize size = file.tellg();
+		file.seekg(0);
+		_data.resize((size_t)size);
+		return size > 0 && file.read(reinterpret_cast<char*>(_data.data()), size);
+	}
+
+	unsigned int Load(const std::string& _path, bool _isHDR, bool _async, MipFilter _filter)
+	{
+		std::string canonical = CanonicalPath(_path);
+		auto byPathIt = byPath.find(canonical);
+		if (byPathIt != byPath.end()) {
+			stats.pathHits++;
+			return AddReference(byPathIt->second);
+		}
+
+		std::vector<unsigned char> encoded;
+		if (!ReadFile(_path, encoded)) {
+			std::cerr << "Texture failed to load at path: " << _path << std::endl;
+			return 0;
+		}
+
+		uint64_t contentKey = Hash(encoded) ^ (_isHDR ? 0x9E3779B97F4A7C15ull : 0);
+		auto byContentIt = byContent.find(contentKey);
+		if (byContentIt != byContent.end()) {
+			stats.contentHits++;
+			byPath[canonical] = byContentIt->second;
+			entries[byContentIt->second].paths.push_back(canonical);
+			return AddReference(byContentIt->second);
+		}
+
+		int width = 0, height = 0, components = 0;
+		if (!stbi_info_from_memory(encoded.data(), (int)encoded.size(), &width, &height, &components)) {
+			std::cerr << "Texture failed to load at path: " << _path << std::endl;
+			return 0;
+		}
+
+		unsigned int textureID;
+		glGenTextures(1, &textureID);
+		if (_async)
+			TextureDecodePool::Get().Enqueue(textureID, _path, std::move(encoded), _filter);
+		else if (!Upload(textureID, _path, encoded, _isHDR, _filter)) {
+			GLStateCache::Get().ForgetTexture(textureID);
+			glDeleteTextures(1, &textureID);
+			return 0;
+		}
+		stats.misses++;
+
+		Entry& entry = entries[textureID];
+		entry.contentKey = contentKey;
+		entry.bytes = _isHDR ? (size_t)width * height * 3 * 2 : (size_t)width * height * components * 4 / 3;
+		entry.refCount = 1;
+		entry.paths.push_back(canonical);
+		byPath[canonical] = textureID;
+		byContent[contentKey] = textureID;
+		stats.residentBytes += entry.bytes;
+		stats.residentCount++;
+		Trim();
+		return textureID;
+	}
+
+	bool Upload(unsigned int _textureID, const std::string& _path, const std::vector<unsigned char>& _encoded, bool _isHDR, MipFilter _filter)
+	{
+		int width, height, nrComponents;
+		if (!_isHDR) {
+			unsigned char* data = stbi_load_from_memory(_encoded.data(), (int)_encoded.size(), &width, &height, &nrComponents, 0);
+			if (!data) {
+				std::cerr << "Texture failed to load at path: " << _path << std::endl;
+				return false;
+			}
+			UploadTexture2D(_textureID, width, height, nrComponents, data,
+				_filter == MipFilter::Auto ? MipGenerator::FilterForPath(_path) : _filter);
+			stbi_image_free(data);
+			return true;
+		}
+
+		// Equirectangular maps are stored top-down, as SceneManager::LoadTexture always flipped them.
+		// The flip is thread-local: the global flag is read by the TextureDecodePool workers mid-decode.
+		// stb has no way to drop the override again, so this thread decodes unflipped afterwards.
+		stbi_set_flip_vertically_on_load_thread(1);
+		float* data = stbi_loadf_from_memory(_encoded.data(), (int)_encoded.size(), &width, &height, &nrComponents, 0);
+		stbi_set_flip_vertically_on_load_thread(0);
+		if (!data) {
+			std::cerr << "Texture failed to load at path: " << _path << std::endl;
+			return false;
+		}
+		GLenum format = GL_RGB;
+		if (nrComponents == 1) format = GL_RED;
+		else if (nrComponents == 4) format = GL_RGBA;
+
+		GLStateCache::Get().BindTexture(GL_TEXTURE_2D, _textureID);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, format, GL_FLOAT, data);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // no mip chain
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		stbi_image_free(data);
+		return true;
+	}
+
+	unsigned int AddReference(unsigned int _id)
+	{
+		Entry& entry = entries[_id];
+		if (entry.refCount++ == 0) {
+			lru.erase(entry.lruPosition);
+			stats.unreferencedCount--;
+		}
+		return _id;
+	}
+
+	void Evict(unsigned int _id)
+	{
+		auto it = entries.find(_id);
+		Entry& entry = it->second;
+		for (const std::string& path : entry.paths)
+			byPath.erase(path);
+		byContent.erase(entry.contentKey);
+		lru.erase(entry.lruPosition);
+		stats.residentBytes -= entry.bytes;
+		stats.residentCount--;
+		stats.unreferencedCount--;
+		stats.evictions++;
+		entries.erase(it);
+
+		GLStateCache::Get().ForgetTexture(_id);
+		glDeleteTextures(1, &_id);
+	}
+
+private:
+	std::unordered_map<std::string, unsigned int> byPath;  // canonical path -> texture id
+	std::unordered_map<uint64_t, unsigned int> byContent;  // content hash -> texture id
+	std::unordered_map<unsigned int, Entry> entries;       // texture id -> entry
+	std::list<unsigned int> lru;                           // unreferenced textures, least recently released first
+	size_t budget = kNoBudget;
+	Stats stats;
+};
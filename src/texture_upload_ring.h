@@ -0,0 +1,217 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <mutex>
+
+#include <GL/glew.h>
+
+#include "gl_state_cache.h"
+
+// Ring of persistently mapped pixel-unpack buffer memory for texture uploads.
+//
+// Decode workers reserve a range with Allocate() and write pixels into it directly, from any
+// thread. The GL thread then calls Upload(), which issues glTexSubImage2D from the buffer offset
+// (the copy into the texture happens on the GPU timeline, not from client memory) and fences the
+// range. Retire() hands the range back once its fence has signaled, Allocate() blocks while the
+// ring is full.
+//
+// Needs ARB_buffer_storage (or GL 4.4), check IsAvailable() after construction.
+//
+// Usage:
+//   TextureUploadRing ring(64 << 20);
+//   // worker:    ring.Allocate(bytes, offset, memory); memcpy(memory, pixels, bytes);
+//   // GL thread: ring.Upload(texture, width, height, components, offset);
+//   //            ring.Retire(); // once per frame
+class TextureUploadRing
+{
+public:
+	struct Stats
+	{
+		unsigned int uploads = 0;
+		size_t uploadedBytes = 0;
+		unsigned int allocationWaits = 0; // Allocate() calls that had to wait for free space
+	};
+
+	explicit TextureUploadRing(size_t _capacity)
+		: capacity(_capacity)
+	{
+		if (!(GLEW_ARB_buffer_storage || GLEW_VERSION_4_4)) {
+#ifdef _DEBUG
+			std::cerr << "TextureUploadRing: ARB_buffer_storage not available, uploads stay on client memory.\n";
+#endif
+			return;
+		}
+
+		glGenBuffers(1, &pbo);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)capacity, nullptr, flags);
+		mapped = static_cast<char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)capacity, flags));
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		if (!mapped) {
+#ifdef _DEBUG
+			std::cerr << "TextureUploadRing: persistent mapping failed, uploads stay on client memory.\n";
+#endif
+			glDeleteBuffers(1, &pbo);
+			pbo = 0;
+		}
+	}
+
+	~TextureUploadRing()
+	{
+		for (Range& range : ranges) {
+			if (range.fence)
+				glDeleteSync(range.fence);
+		}
+		if (mapped) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		if (pbo)
+			glDeleteBuffers(1, &pbo);
+	}
+
+	TextureUploadRing(const TextureUploadRing&) = delete;
+	TextureUploadRing& operator=(const TextureUploadRing&) = delete;
+
+	bool IsAvailable() const { return mapped != nullptr; }
+	size_t GetCapacity() const { return capacity; }
+
+	// Any thread. Reserves _bytes of the ring and returns where to write them, waits while the ring
+	// is full. Returns false when the ring is unavailable or _bytes can never fit.
+	bool Allocate(size_t _bytes, size_t& _offset, char*& _memory)
+	{
+		size_t size = Align(_bytes);
+		if (!mapped || size >= capacity)
+			return false;
+
+		std::unique_lock<std::mutex> lock(mutex);
+		size_t offset = 0;
+		if (!Fits(size, offset)) {
+			stats.allocationWaits++;
+			spaceFreed.wait(lock, [&]() { return Fits(size, offset); });
+		}
+		ranges.push_back({ offset, size, nullptr });
+		head = offset + size;
+		_offset = offset;
+		_memory = mapped + offset;
+		return true;
+	}
+
+	// GL thread. Uploads the pixels at _offset (written through Allocate()) into the first
+	// _levelCount levels of the already created _textureID and fences the range. The levels follow
+	// each other tightly packed, each half the size of the one before (GL's rule, as MipChain).
+	void Upload(unsigned int _textureID, int _width, int _height, int _components, size_t _offset, int _levelCount = 1)
+	{
+		GLenum format = GL_RED;
+		if (_components == 1) format = GL_RED;
+		if (_components == 3) format = GL_RGB;
+		if (_components == 4) format = GL_RGBA;
+
+		GLStateCache::Get().BindTexture(GL_TEXTURE_2D, _textureID);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // tightly packed rows, as decoded
+		size_t levelOffset = _offset;
+		for (int level = 0, width = _width, height = _height; level < _levelCount; level++) {
+			// With the PBO bound the pointer is an offset into it, so storage and pixels come in one
+			// transfer (a nullptr here would be offset 0, i.e. another image's bytes)
+			glTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, format, GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(levelOffset));
+			levelOffset += (size_t)width * height * _components;
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush(); // Retire() polls without a flush, an unsubmitted fence would never signal
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for (Range& range : ranges) {
+			if (range.offset == _offset && !range.fence) {
+				range.fence = fence;
+				stats.uploads++;
+				stats.uploadedBytes += range.size;
+				return;
+			}
+		}
+		glDeleteSync(fence); // not a live range, nothing to release later
+	}
+
+	// GL thread. Releases the ranges at the front of the ring whose uploads the GPU has finished.
+	void Retire()
+	{
+		bool freed = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			while (!ranges.empty() && ranges.front().fence) {
+				GLenum result = glClientWaitSync(ranges.front().fence, 0, 0);
+				if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+					break;
+				glDeleteSync(ranges.front().fence);
+				ranges.pop_front();
+				freed = true;
+			}
+		}
+		if (freed)
+			spaceFreed.notify_all();
+	}
+
+	Stats GetStats()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return stats;
+	}
+
+	void ResetStats()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stats = Stats();
+	}
+
+private:
+	struct Range
+	{
+		size_t offset;
+		size_t size;
+		GLsync fence; // null until uploaded
+	};
+
+	static constexpr size_t kAlignment = 16;
+
+	static size_t Align(size_t _bytes) { return (_bytes + kAlignment - 1) / kAlignment * kAlignment; }
+
+	// Called with mutex held. Live ranges sit between tail (oldest) and head, a range that does not
+	// fit before the end of the buffer starts again at 0.
+	bool Fits(size_t _size, size_t& _offset)
+	{
+		if (ranges.empty()) {
+			_offset = 0;
+			return _size < capacity;
+		}
+		size_t tail = ranges.front().offset;
+		if (head > tail) {
+			if (head + _size <= capacity) {
+				_offset = head;
+				return true;
+			}
+			_offset = 0;
+			return _size < tail;
+		}
+		_offset = head;
+		return head + _size < tail;
+	}
+
+private:
+	unsigned int pbo = 0;
+	char* mapped = nullptr;
+	size_t capacity = 0;
+	size_t head = 0;
+	std::deque<Range> ranges; // in allocation order
+	std::mutex mutex;
+	std::condition_variable spaceFreed;
+	Stats stats;
+};